@@ -0,0 +1,162 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// ===| Sample Statistics |=====================================================================
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+	// Nearest-rank percentile on an already sorted array
+	size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+	return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+SampleStats SummarizeSamples(std::vector<double> samples) {
+	SampleStats stats;
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+	stats.count = samples.size();
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.median = Percentile(samples, 0.5);
+	stats.p99 = Percentile(samples, 0.99);
+	stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	return stats;
+}
+
+void WriteStatsJson(std::ostream& out, const SampleStats& stats) {
+	out << "{\"count\": " << stats.count
+		<< ", \"min\": " << stats.min
+		<< ", \"median\": " << stats.median
+		<< ", \"p99\": " << stats.p99
+		<< ", \"max\": " << stats.max
+		<< ", \"mean\": " << stats.mean << "}";
+}
+
+// ===| Frame Timer |===========================================================================
+
+FrameTimer::FrameTimer(int warmupFrames, int initialQueries)
+	: warmupFrames(warmupFrames) {
+	queries.resize(std::max(initialQueries, 1));
+	for (PendingQuery& q : queries)
+		glGenQueries(1, &q.query);
+}
+
+FrameTimer::~FrameTimer() {
+	for (PendingQuery& q : queries)
+		glDeleteQueries(1, &q.query);
+}
+
+void FrameTimer::CollectQueries(bool wait) {
+	for (PendingQuery& q : queries) {
+		if (!q.inFlight)
+			continue;
+
+		if (!wait) {
+			GLint available = 0;
+			glGetQueryObjectiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				continue;
+		}
+
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(q.query, GL_QUERY_RESULT, &elapsedNs);
+		if (q.recorded)
+			gpuFrameMs.push_back(elapsedNs / 1.0e6);
+		q.inFlight = false;
+	}
+}
+
+size_t FrameTimer::AcquireQuery() {
+	CollectQueries(false);
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		size_t slot = (activeQuery + 1 + i) % queries.size();
+		if (!queries[slot].inFlight)
+			return slot;
+	}
+
+	// Every query is still in flight: the GPU is further behind than the ring is deep.
+	// Grow the ring rather than block on the oldest result.
+	PendingQuery q;
+	glGenQueries(1, &q.query);
+	queries.push_back(q);
+	return queries.size() - 1;
+}
+
+void FrameTimer::BeginFrame() {
+	recording = frameIndex >= warmupFrames;
+
+	activeQuery = AcquireQuery();
+	queries[activeQuery].inFlight = true;
+	queries[activeQuery].recorded = recording;
+	glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery].query);
+	gpuQueryOpen = true;
+
+	std::fill(std::begin(sectionAccum), std::end(sectionAccum), 0.0);
+	frameStart = Clock::now();
+	lastMark = frameStart;
+}
+
+void FrameTimer::Mark(FrameSection section) {
+	Clock::time_point now = Clock::now();
+	sectionAccum[static_cast<int>(section)] += std::chrono::duration<double, std::milli>(now - lastMark).count();
+	lastMark = now;
+}
+
+void FrameTimer::EndGpuFrame() {
+	if (gpuQueryOpen) {
+		glEndQuery(GL_TIME_ELAPSED);
+		gpuQueryOpen = false;
+	}
+}
+
+void FrameTimer::EndFrame() {
+	EndGpuFrame();
+
+	Clock::time_point now = Clock::now();
+	if (recording) {
+		cpuFrameMs.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+		for (int i = 0; i < static_cast<int>(FrameSection::Count); ++i)
+			sectionMs[i].push_back(sectionAccum[i]);
+	}
+	++frameIndex;
+}
+
+void FrameTimer::Finish() {
+	EndGpuFrame();
+	CollectQueries(true);
+}
+
+double FrameTimer::TotalCpuSeconds() const {
+	return std::accumulate(cpuFrameMs.begin(), cpuFrameMs.end(), 0.0) / 1000.0;
+}
+
+double FrameTimer::TotalGpuSeconds() const {
+	return std::accumulate(gpuFrameMs.begin(), gpuFrameMs.end(), 0.0) / 1000.0;
+}
+
+void FrameTimer::WriteJson(std::ostream& out, const std::string& extraFields) const {
+	static const char* sectionNames[] = { "clear", "draw", "present" };
+	static_assert(sizeof(sectionNames) / sizeof(sectionNames[0]) == static_cast<size_t>(FrameSection::Count),
+		"every FrameSection needs a name");
+
+	out << "{\n";
+	if (!extraFields.empty())
+		out << extraFields << ",\n";
+	out << "  \"frames\": " << cpuFrameMs.size() << ",\n";
+	out << "  \"warmup_frames\": " << warmupFrames << ",\n";
+	out << "  \"gpu_queries\": " << queries.size() << ",\n";
+	out << "  \"cpu_frame_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(cpuFrameMs));
+	out << ",\n  \"gpu_frame_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(gpuFrameMs));
+	for (int i = 0; i < static_cast<int>(FrameSection::Count); ++i) {
+		out << ",\n  \"cpu_" << sectionNames[i] << "_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(sectionMs[i]));
+	}
+	out << "\n}\n";
+}
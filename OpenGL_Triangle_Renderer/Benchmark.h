@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ===| Sample Statistics |=====================================================================
+
+struct SampleStats {
+	size_t count = 0;
+	double min = 0.0;
+	double median = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+	double mean = 0.0;
+};
+
+SampleStats SummarizeSamples(std::vector<double> samples);
+
+// Writes {"count":..,"min":..,"median":..,"p99":..,"max":..,"mean":..}
+void WriteStatsJson(std::ostream& out, const SampleStats& stats);
+
+// ===| Frame Timer |===========================================================================
+//
+// CPU time is measured with steady_clock, per frame and per section of the frame.
+// GPU time is measured with GL_TIME_ELAPSED queries kept in a ring: a query is only read back
+// once GL_QUERY_RESULT_AVAILABLE says so, and the ring grows instead of waiting if the GPU
+// falls further behind than expected, so timing never stalls the pipeline.
+
+enum class FrameSection {
+	Clear,
+	Draw,
+	Present,
+	Count
+};
+
+class FrameTimer {
+public:
+	explicit FrameTimer(int warmupFrames = 0, int initialQueries = 4);
+	~FrameTimer();
+
+	FrameTimer(const FrameTimer&) = delete;
+	FrameTimer& operator=(const FrameTimer&) = delete;
+
+	void BeginFrame();
+	void Mark(FrameSection section);   // CPU time since the previous mark is charged to section
+	void EndGpuFrame();                // call before the swap, so the query brackets only GL work
+	void EndFrame();
+
+	// Blocks until every outstanding query is resolved; only call once the run is over.
+	void Finish();
+
+	size_t RecordedFrames() const { return cpuFrameMs.size(); }
+	double TotalCpuSeconds() const;
+	double TotalGpuSeconds() const;
+	const std::vector<double>& CpuFrameMs() const { return cpuFrameMs; }
+	const std::vector<double>& GpuFrameMs() const { return gpuFrameMs; }
+
+	void WriteJson(std::ostream& out, const std::string& extraFields = "") const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct PendingQuery {
+		unsigned int query = 0;
+		bool inFlight = false;
+		bool recorded = false;   // false for warmup frames
+	};
+
+	void CollectQueries(bool wait);
+	size_t AcquireQuery();
+
+	int warmupFrames;
+	int frameIndex = 0;
+	bool recording = false;
+
+	Clock::time_point frameStart;
+	Clock::time_point lastMark;
+	double sectionAccum[static_cast<int>(FrameSection::Count)] = {};
+
+	std::vector<PendingQuery> queries;
+	size_t activeQuery = 0;
+	bool gpuQueryOpen = false;
+
+	std::vector<double> cpuFrameMs;
+	std::vector<double> gpuFrameMs;
+	std::vector<double> sectionMs[static_cast<int>(FrameSection::Count)];
+};
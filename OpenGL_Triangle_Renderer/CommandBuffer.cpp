@@ -0,0 +1,153 @@
+#include "CommandBuffer.h"
+#include "RenderQueue.h"
+#include "StateCache.h"
+
+#include <cstring>
+
+// ===| Payloads |==============================================================================
+
+struct CommandHeader {
+	CommandType type;
+	uint16_t size;   // payload bytes following the header
+};
+
+struct BindTextureCommand {
+	unsigned int unit;
+	GLenum target;
+	unsigned int texture;
+};
+
+struct VertexAttrib4fCommand {
+	unsigned int location;
+	float values[4];
+};
+
+struct VertexAttrib4NubCommand {
+	unsigned int location;
+	uint32_t rgba;   // r in the low byte
+};
+
+struct DrawElementsCommand {
+	GLenum mode;
+	GLsizei count;
+	GLenum indexType;
+	uint32_t indexOffset;
+	GLsizei instanceCount;   // 0 = not instanced
+	unsigned int conditionQuery;
+};
+
+static_assert(sizeof(CommandHeader) == 4, "command headers are 4 bytes");
+
+// ===| Recording |=============================================================================
+
+template <class Payload>
+void CommandBuffer::Append(CommandType type, const Payload& payload) {
+	static_assert(sizeof(Payload) % 4 == 0, "payloads keep the stream 4-byte aligned");
+
+	CommandHeader header = { type, static_cast<uint16_t>(sizeof(Payload)) };
+	const size_t offset = bytes.size();
+	bytes.resize(offset + sizeof(header) + sizeof(Payload));
+	std::memcpy(bytes.data() + offset, &header, sizeof(header));
+	std::memcpy(bytes.data() + offset + sizeof(header), &payload, sizeof(Payload));
+	++commandCount;
+}
+
+void CommandBuffer::Clear() {
+	bytes.clear();
+	commandCount = 0;
+}
+
+void CommandBuffer::UseProgram(unsigned int program) {
+	Append(CommandType::UseProgram, program);
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vao) {
+	Append(CommandType::BindVertexArray, vao);
+}
+
+void CommandBuffer::BindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+	Append(CommandType::BindTexture, BindTextureCommand{ unit, target, texture });
+}
+
+void CommandBuffer::SetPass(bool transparent) {
+	Append(CommandType::SetPass, static_cast<uint32_t>(transparent));
+}
+
+void CommandBuffer::VertexAttrib4f(unsigned int location, const float values[4]) {
+	VertexAttrib4fCommand command;
+	command.location = location;
+	std::memcpy(command.values, values, sizeof(command.values));
+	Append(CommandType::VertexAttrib4f, command);
+}
+
+void CommandBuffer::VertexAttrib4Nub(unsigned int location, uint32_t rgba) {
+	Append(CommandType::VertexAttrib4Nub, VertexAttrib4NubCommand{ location, rgba });
+}
+
+void CommandBuffer::DrawElements(GLenum mode, GLsizei count, GLenum indexType, size_t indexOffset, GLsizei instanceCount,
+	unsigned int conditionQuery) {
+	Append(CommandType::DrawElements,
+		DrawElementsCommand{ mode, count, indexType, static_cast<uint32_t>(indexOffset), instanceCount, conditionQuery });
+}
+
+// ===| Replay |================================================================================
+
+template <class Payload>
+static Payload readPayload(const unsigned char* data) {
+	Payload payload;
+	std::memcpy(&payload, data, sizeof(payload));
+	return payload;
+}
+
+void CommandBuffer::Replay() const {
+	const unsigned char* cursor = bytes.data();
+	const unsigned char* end = cursor + bytes.size();
+
+	while (cursor < end) {
+		CommandHeader header;
+		std::memcpy(&header, cursor, sizeof(header));
+		const unsigned char* payload = cursor + sizeof(header);
+		cursor = payload + header.size;
+
+		switch (header.type) {
+		case CommandType::UseProgram:
+			glState.UseProgram(readPayload<unsigned int>(payload));
+			break;
+		case CommandType::BindVertexArray:
+			glState.BindVertexArray(readPayload<unsigned int>(payload));
+			break;
+		case CommandType::BindTexture: {
+			const BindTextureCommand command = readPayload<BindTextureCommand>(payload);
+			glState.BindTexture(command.unit, command.target, command.texture);
+			break;
+		}
+		case CommandType::SetPass:
+			ApplyPassState(readPayload<uint32_t>(payload) != 0);
+			break;
+		case CommandType::VertexAttrib4f: {
+			const VertexAttrib4fCommand command = readPayload<VertexAttrib4fCommand>(payload);
+			glVertexAttrib4fv(command.location, command.values);
+			break;
+		}
+		case CommandType::VertexAttrib4Nub: {
+			const VertexAttrib4NubCommand command = readPayload<VertexAttrib4NubCommand>(payload);
+			glVertexAttrib4Nub(command.location, command.rgba & 0xFF, (command.rgba >> 8) & 0xFF,
+				(command.rgba >> 16) & 0xFF, command.rgba >> 24);
+			break;
+		}
+		case CommandType::DrawElements: {
+			const DrawElementsCommand command = readPayload<DrawElementsCommand>(payload);
+			const void* indices = reinterpret_cast<const void*>(static_cast<uintptr_t>(command.indexOffset));
+			if (command.conditionQuery)
+				glBeginConditionalRender(command.conditionQuery, GL_QUERY_NO_WAIT);
+			if (command.instanceCount > 0)
+				glDrawElementsInstanced(command.mode, command.count, command.indexType, indices, command.instanceCount);
+			else
+				glDrawElements(command.mode, command.count, command.indexType, indices);
+			if (command.conditionQuery)
+				glEndConditionalRender();
+			break;
+		}
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===| Command Buffer |========================================================================
+//
+// A linear, append-only list of compact GL commands. Recording touches no GL state, so any
+// thread can fill its own buffer; the thread owning the context then replays the buffers in
+// order with Replay(), which is the only place the commands reach GL (through glState).
+//
+// Each command is a 4-byte header (type, payload size) followed by a 4-byte aligned payload.
+// Clear() keeps the storage, so a buffer reused every frame stops allocating after warmup.
+
+enum class CommandType : uint16_t {
+	UseProgram,
+	BindVertexArray,
+	BindTexture,
+	SetPass,
+	VertexAttrib4f,
+	VertexAttrib4Nub,
+	DrawElements,
+};
+
+class CommandBuffer {
+public:
+	void Clear();
+
+	void UseProgram(unsigned int program);
+	void BindVertexArray(unsigned int vao);
+	void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+	// Depth/blend state of the opaque or transparent pass (see ApplyPassState)
+	void SetPass(bool transparent);
+	void VertexAttrib4f(unsigned int location, const float values[4]);
+	void VertexAttrib4Nub(unsigned int location, uint32_t rgba);
+	// conditionQuery != 0 draws under glBeginConditionalRender(conditionQuery, GL_QUERY_NO_WAIT)
+	void DrawElements(GLenum mode, GLsizei count, GLenum indexType, size_t indexOffset, GLsizei instanceCount = 0,
+		unsigned int conditionQuery = 0);
+
+	size_t CommandCount() const { return commandCount; }
+	size_t SizeBytes() const { return bytes.size(); }
+
+	// GL thread only
+	void Replay() const;
+
+private:
+	template <class Payload>
+	void Append(CommandType type, const Payload& payload);
+
+	std::vector<unsigned char> bytes;
+	size_t commandCount = 0;
+};
@@ -0,0 +1,316 @@
+#include "Culling.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CULL_TARGET_AVX2
+#else
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// ===| Frustum |===============================================================================
+
+Frustum Frustum::FromMatrix(const Mat4& viewProj) {
+	// Row r of the matrix is (m[r], m[4 + r], m[8 + r], m[12 + r]); each plane is row 3 +/- row r
+	const float* m = viewProj.m;
+	Frustum frustum;
+	for (int axis = 0; axis < 3; ++axis) {
+		for (int side = 0; side < 2; ++side) {
+			const float sign = side == 0 ? 1.0f : -1.0f;
+			float* plane = frustum.planes[axis * 2 + side];
+			for (int k = 0; k < 4; ++k)
+				plane[k] = m[k * 4 + 3] + sign * m[k * 4 + axis];
+
+			const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			for (int k = 0; k < 4; ++k)
+				plane[k] /= length;
+		}
+	}
+	return frustum;
+}
+
+// ===| Bounds (Structure of Arrays) |==========================================================
+
+void BoundsSoA::Resize(size_t count) {
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+void BoundsSoA::Set(size_t i, float centerX, float centerY, float centerZ, float sphereRadius) {
+	x[i] = centerX;
+	y[i] = centerY;
+	z[i] = centerZ;
+	radius[i] = sphereRadius;
+}
+
+// ===| Sphere Tests |==========================================================================
+
+static bool cpuHasAvx2() {
+#if defined(CULL_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5));
+#elif defined(CULL_X86)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+CullSimd BestCullSimd() {
+#ifdef CULL_X86
+	static const CullSimd best = cpuHasAvx2() ? CullSimd::AVX2 : CullSimd::SSE;
+	return best;
+#else
+	return CullSimd::Scalar;
+#endif
+}
+
+const char* CullSimdName(CullSimd simd) {
+	switch (simd) {
+	case CullSimd::SSE:  return "sse";
+	case CullSimd::AVX2: return "avx2";
+	default:             return "scalar";
+	}
+}
+
+static size_t cullScalar(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end,
+	const uint32_t* ids, uint32_t* out) {
+	size_t visible = 0;
+	for (size_t i = begin; i < end; ++i) {
+		bool inside = true;
+		for (const float* plane : frustum.planes) {
+			const float distance = plane[0] * bounds.x[i] + plane[1] * bounds.y[i] + plane[2] * bounds.z[i] + plane[3];
+			inside &= distance >= -bounds.radius[i];
+		}
+		out[visible] = ids ? ids[i] : static_cast<uint32_t>(i);
+		visible += inside;
+	}
+	return visible;
+}
+
+#ifdef CULL_X86
+static size_t cullSSE(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end,
+	const uint32_t* ids, uint32_t* out) {
+	__m128 planes[6][4];
+	for (int p = 0; p < 6; ++p) {
+		for (int k = 0; k < 4; ++k)
+			planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+	}
+
+	size_t visible = 0;
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		const __m128 x = _mm_loadu_ps(&bounds.x[i]);
+		const __m128 y = _mm_loadu_ps(&bounds.y[i]);
+		const __m128 z = _mm_loadu_ps(&bounds.z[i]);
+		const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(planes[p][0], x), planes[p][3]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][1], y));
+			distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][2], z));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		// Branchless compaction: always write, only advance for visible lanes
+		const int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane) {
+			out[visible] = ids ? ids[i + lane] : static_cast<uint32_t>(i + lane);
+			visible += (mask >> lane) & 1;
+		}
+	}
+	return visible + cullScalar(frustum, bounds, i, end, ids, out + visible);
+}
+
+CULL_TARGET_AVX2
+static size_t cullAVX2(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end,
+	const uint32_t* ids, uint32_t* out) {
+	__m256 planes[6][4];
+	for (int p = 0; p < 6; ++p) {
+		for (int k = 0; k < 4; ++k)
+			planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+	}
+
+	size_t visible = 0;
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		const __m256 x = _mm256_loadu_ps(&bounds.x[i]);
+		const __m256 y = _mm256_loadu_ps(&bounds.y[i]);
+		const __m256 z = _mm256_loadu_ps(&bounds.z[i]);
+		const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], y));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+
+		const int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; ++lane) {
+			out[visible] = ids ? ids[i + lane] : static_cast<uint32_t>(i + lane);
+			visible += (mask >> lane) & 1;
+		}
+	}
+	return visible + cullScalar(frustum, bounds, i, end, ids, out + visible);
+}
+#endif
+
+size_t CullSpheres(CullSimd simd, const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end,
+	const uint32_t* ids, uint32_t* out) {
+#ifdef CULL_X86
+	if (simd == CullSimd::AVX2 && BestCullSimd() == CullSimd::AVX2)
+		return cullAVX2(frustum, bounds, begin, end, ids, out);
+	if (simd != CullSimd::Scalar)
+		return cullSSE(frustum, bounds, begin, end, ids, out);
+#endif
+	return cullScalar(frustum, bounds, begin, end, ids, out);
+}
+
+// ===| Bounding Volume Hierarchy |=============================================================
+
+void BoundingVolumeHierarchy::BuildNode(const BoundsSoA& source, uint32_t node, uint32_t first, uint32_t count,
+	unsigned int leafSize) {
+
+	float boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+	float boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+	float centerMin[3] = { INFINITY, INFINITY, INFINITY };
+	float centerMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+	const std::vector<float>* axes[3] = { &source.x, &source.y, &source.z };
+
+	for (uint32_t i = first; i < first + count; ++i) {
+		const uint32_t id = ids[i];
+		for (int axis = 0; axis < 3; ++axis) {
+			const float center = (*axes[axis])[id];
+			boundsMin[axis] = std::min(boundsMin[axis], center - source.radius[id]);
+			boundsMax[axis] = std::max(boundsMax[axis], center + source.radius[id]);
+			centerMin[axis] = std::min(centerMin[axis], center);
+			centerMax[axis] = std::max(centerMax[axis], center);
+		}
+	}
+
+	Node& self = nodes[node];
+	std::copy(boundsMin, boundsMin + 3, self.min);
+	std::copy(boundsMax, boundsMax + 3, self.max);
+	self.left = 0;
+	self.first = first;
+	self.count = count;
+
+	// Median split on the axis where the centers spread the most
+	int axis = 0;
+	for (int k = 1; k < 3; ++k) {
+		if (centerMax[k] - centerMin[k] > centerMax[axis] - centerMin[axis])
+			axis = k;
+	}
+	if (count <= leafSize || centerMax[axis] <= centerMin[axis])
+		return;
+
+	const std::vector<float>& key = *axes[axis];
+	const uint32_t middle = first + count / 2;
+	std::nth_element(ids.begin() + first, ids.begin() + middle, ids.begin() + first + count,
+		[&key](uint32_t a, uint32_t b) { return key[a] < key[b]; });
+
+	// push_back may move the nodes: self is not used past this point
+	const uint32_t left = static_cast<uint32_t>(nodes.size());
+	nodes[node].left = left;
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	BuildNode(source, left, first, middle - first, leafSize);
+	BuildNode(source, left + 1, middle, first + count - middle, leafSize);
+}
+
+void BoundingVolumeHierarchy::Build(const BoundsSoA& bounds, unsigned int leafSize) {
+	const size_t count = bounds.Count();
+	ids.resize(count);
+	std::iota(ids.begin(), ids.end(), 0u);
+
+	nodes.clear();
+	nodes.reserve(2 * (count / std::max(leafSize, 1u)) + 1);
+	nodes.push_back(Node());
+	BuildNode(bounds, 0, 0, static_cast<uint32_t>(count), std::max(leafSize, 1u));
+
+	sorted.Resize(count);
+	for (size_t i = 0; i < count; ++i)
+		sorted.Set(i, bounds.x[ids[i]], bounds.y[ids[i]], bounds.z[ids[i]], bounds.radius[ids[i]]);
+}
+
+enum class Containment { Outside, Intersecting, Inside };
+
+static Containment classifyBox(const Frustum& frustum, const float min[3], const float max[3]) {
+	Containment result = Containment::Inside;
+	for (const float* plane : frustum.planes) {
+		float center = plane[3];
+		float extent = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			center += plane[k] * (min[k] + max[k]) * 0.5f;
+			extent += std::fabs(plane[k]) * (max[k] - min[k]) * 0.5f;
+		}
+		if (center + extent < 0.0f)
+			return Containment::Outside;
+		if (center - extent < 0.0f)
+			result = Containment::Intersecting;
+	}
+	return result;
+}
+
+void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) {
+	const auto start = std::chrono::steady_clock::now();
+	CullFrameStats stats;
+
+	visible.resize(ids.size());
+	size_t visibleCount = 0;
+
+	stack.clear();
+	if (!nodes.empty())
+		stack.push_back(0);
+
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		++stats.nodesVisited;
+
+		const Containment containment = classifyBox(frustum, node.min, node.max);
+		if (containment == Containment::Outside)
+			continue;
+
+		if (containment == Containment::Inside) {
+			std::copy(ids.begin() + node.first, ids.begin() + node.first + node.count, visible.begin() + visibleCount);
+			visibleCount += node.count;
+		}
+		else if (node.left == 0) {
+			visibleCount += CullSpheres(simd, frustum, sorted, node.first, node.first + node.count,
+				ids.data(), visible.data() + visibleCount);
+			stats.objectsTested += node.count;
+		}
+		else {
+			stack.push_back(node.left + 1);
+			stack.push_back(node.left);
+		}
+	}
+
+	visible.resize(visibleCount);
+	stats.visible = visibleCount;
+	stats.culled = ids.size() - visibleCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastFrame = stats;
+	AppendHistory(history, stats);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MathUtil.h"
+
+// ===| Frustum |===============================================================================
+
+struct Frustum {
+	// a, b, c, d with a*x + b*y + c*z + d >= 0 inside; normals are unit length
+	float planes[6][4];
+
+	// Gribb/Hartmann plane extraction from a GL view-projection matrix (world space planes)
+	static Frustum FromMatrix(const Mat4& viewProj);
+};
+
+// ===| Bounds (Structure of Arrays) |==========================================================
+//
+// One array per component so a SIMD register holds the same component of 4 or 8 objects.
+
+struct BoundsSoA {
+	std::vector<float> x, y, z, radius;   // bounding spheres
+
+	size_t Count() const { return x.size(); }
+	void Resize(size_t count);
+	void Set(size_t i, float centerX, float centerY, float centerZ, float sphereRadius);
+};
+
+// ===| Sphere Tests |==========================================================================
+//
+// Writes the ids of visible spheres in [begin, end) to out and returns how many there were.
+// ids maps positions to the ids written (NULL = the positions themselves); out must have room
+// for end - begin entries.
+
+enum class CullSimd {
+	Scalar,
+	SSE,    // 4 spheres per instruction
+	AVX2,   // 8 spheres per instruction
+};
+
+// Widest path this CPU supports (AVX2 is checked at run time)
+CullSimd BestCullSimd();
+const char* CullSimdName(CullSimd simd);
+
+size_t CullSpheres(CullSimd simd, const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end,
+	const uint32_t* ids, uint32_t* out);
+
+// ===| Bounding Volume Hierarchy |=============================================================
+//
+// Binary tree of AABBs over the spheres, built once for static objects. Traversal drops nodes
+// outside the frustum, accepts nodes fully inside without testing their objects, and tests the
+// objects of straddling leaves with the SIMD path. Leaves hold contiguous ranges of a copy of
+// the bounds reordered into tree order.
+
+struct CullFrameStats {
+	size_t visible = 0;
+	size_t culled = 0;
+	size_t nodesVisited = 0;
+	size_t objectsTested = 0;   // objects that needed a sphere test
+	double milliseconds = 0.0;
+};
+
+class BoundingVolumeHierarchy {
+public:
+	void Build(const BoundsSoA& bounds, unsigned int leafSize = 16);
+
+	void SetSimd(CullSimd newSimd) { simd = newSimd; }
+	CullSimd Simd() const { return simd; }
+
+	// Fills visible with the ids (indices into the bounds given to Build) of visible objects
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+	size_t NodeCount() const { return nodes.size(); }
+	const CullFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<CullFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	struct Node {
+		float min[3];
+		float max[3];
+		uint32_t left;    // index of the left child (right is left + 1), 0 for leaves
+		uint32_t first;   // objects of the whole subtree, contiguous in tree order
+		uint32_t count;
+	};
+
+	void BuildNode(const BoundsSoA& source, uint32_t node, uint32_t first, uint32_t count, unsigned int leafSize);
+
+	std::vector<Node> nodes;
+	BoundsSoA sorted;
+	std::vector<uint32_t> ids;   // tree order -> original index
+	CullSimd simd = BestCullSimd();
+
+	std::vector<uint32_t> stack;
+
+	CullFrameStats lastFrame;
+	std::vector<CullFrameStats> history;
+};
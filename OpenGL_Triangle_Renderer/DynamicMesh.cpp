@@ -0,0 +1,89 @@
+#include "DynamicMesh.h"
+#include "Instancing.h"
+#include "StateCache.h"
+
+#include <cmath>
+#include <cstring>
+
+DynamicMesh::DynamicMesh(const Mesh& source, const GpuMesh& staticMesh, const VertexLayout& layout, StreamPolicy policy)
+	: basePositions(source.positions),
+	colors(source.colors),
+	texcoords(source.texcoords),
+	positions(source.positions),
+	packed(static_cast<size_t>(layout.Stride()) * source.VertexCount()),
+	layout(layout),
+	stream(GL_ARRAY_BUFFER, static_cast<size_t>(layout.Stride()) * source.VertexCount() + layout.Stride(), 3, policy),
+	indexCount(staticMesh.indexCount),
+	indexType(staticMesh.indexType) {
+
+	glGenVertexArrays(1, &vao);
+	glState.BindVertexArray(vao);
+	glState.BindBuffer(GL_ARRAY_BUFFER, stream.Buffer());
+	layout.Apply();
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, staticMesh.EBO);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+DynamicMesh::~DynamicMesh() {
+	glState.OnVertexArrayDeleted(vao);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void DynamicMesh::AttachInstances(unsigned int instanceBuffer) {
+	glState.BindVertexArray(vao);
+	AttachInstanceAttributes(instanceBuffer);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DynamicMesh::Simulate(double time, std::vector<float>& out) const {
+	// "Simulation": a travelling ripple across the mesh
+	const float t = static_cast<float>(time);
+	out.resize(basePositions.size());
+	for (size_t i = 0; i < basePositions.size(); i += 3) {
+		const float x = basePositions[i];
+		const float y = basePositions[i + 1];
+		out[i] = x + 0.02f * std::sin(9.0f * y + 2.0f * t);
+		out[i + 1] = y + 0.02f * std::sin(7.0f * x + 3.0f * t);
+		out[i + 2] = basePositions[i + 2];
+	}
+}
+
+void DynamicMesh::Update(double time) {
+	Simulate(time, positions);
+	Stream(positions);
+}
+
+void DynamicMesh::Update(const std::vector<float>& simulatedPositions) {
+	Stream(simulatedPositions.size() == basePositions.size() ? simulatedPositions : basePositions);
+}
+
+void DynamicMesh::Stream(const std::vector<float>& simulatedPositions) {
+	VertexStreams streams;
+	streams.count = simulatedPositions.size() / 3;
+	streams.positions = simulatedPositions.data();
+	streams.colors = colors.size() == simulatedPositions.size() ? colors.data() : nullptr;
+	streams.texcoords = texcoords.size() * 3 == simulatedPositions.size() * 2 ? texcoords.data() : nullptr;
+
+	// Offsets are a multiple of the stride, so they translate to a whole base vertex
+	const unsigned int stride = layout.Stride();
+	size_t offset = 0;
+	PackVertices(layout, streams, packed.data());
+
+	// Mapped stream memory is typically write-combined: one sequential copy beats packing the
+	// attributes into it with strided partial writes
+	void* dst = stream.Map(packed.size(), stride, &offset);
+	if (dst) {
+		std::memcpy(dst, packed.data(), packed.size());
+		stream.Unmap();
+	}
+	baseVertex = static_cast<GLint>(offset / stride);
+}
+
+void DynamicMesh::Draw(GLsizei instanceCount) const {
+	if (instanceCount > 0)
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, indexType, (void*)0, instanceCount, baseVertex);
+	else
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, (void*)0, baseVertex);
+}
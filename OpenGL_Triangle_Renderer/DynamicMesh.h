@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "Mesh.h"
+#include "StreamingBuffer.h"
+#include "VertexLayout.h"
+
+// ===| Dynamic Mesh |==========================================================================
+//
+// Mesh whose vertices are recomputed on the CPU every frame (a stand-in for simulation output)
+// and streamed through a StreamingBuffer. Topology is fixed, so the static mesh's element
+// buffer is reused; the VAO points at the start of the stream buffer and each frame's data is
+// selected with the base vertex of glDrawElementsBaseVertex, so nothing is re-specified.
+
+class DynamicMesh {
+public:
+	DynamicMesh(const Mesh& source, const GpuMesh& staticMesh, const VertexLayout& layout, StreamPolicy policy);
+	~DynamicMesh();
+
+	DynamicMesh(const DynamicMesh&) = delete;
+	DynamicMesh& operator=(const DynamicMesh&) = delete;
+
+	// Adds per-instance attributes from an instance buffer (see Instancing.h)
+	void AttachInstances(unsigned int instanceBuffer);
+
+	// Simulates the vertices for this frame, packs them into the vertex layout in system memory
+	// and copies the result into mapped stream memory with one sequential write
+	void Update(double time);
+	// Streams vertex positions simulated elsewhere (see Simulation.h) instead
+	void Update(const std::vector<float>& simulatedPositions);
+
+	// The simulation alone: the mesh's positions at time. Only reads the base positions, so any
+	// thread may call it while the mesh is drawn.
+	void Simulate(double time, std::vector<float>& out) const;
+	size_t PositionCount() const { return basePositions.size(); }
+	void Draw(GLsizei instanceCount) const;
+
+	// Call once the frame's draws are submitted
+	void EndFrame() { stream.EndFrame(); }
+
+	unsigned int VAO() const { return vao; }
+	const StreamingBuffer& Stream() const { return stream; }
+
+private:
+	void Stream(const std::vector<float>& simulatedPositions);
+
+	std::vector<float> basePositions;
+	std::vector<float> colors;
+	std::vector<float> texcoords;
+	std::vector<float> positions;
+	std::vector<unsigned char> packed;
+	VertexLayout layout;
+	StreamingBuffer stream;
+
+	unsigned int vao = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLint baseVertex = 0;
+};
@@ -0,0 +1,310 @@
+#include "FrameCapture.h"
+#include "FrameHistory.h"
+#include "Headless.h"
+#include "StateCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// ===| Frame Capture |=========================================================================
+
+const char* CaptureFormatName(CaptureFormat format) {
+	switch (format) {
+	case CaptureFormat::Frames: return "ppm_frames";
+	case CaptureFormat::Raw:    return "raw_rgb24";
+	case CaptureFormat::Y4M:    return "y4m";
+	case CaptureFormat::Pipe:   return "pipe_rgb24";
+	}
+	return "unknown";
+}
+
+FrameCapture::FrameCapture(int width, int height, CaptureFormat format, const std::string& target, int ringSize, int fps)
+	: width(std::max(width, 1)), height(std::max(height, 1)), format(format), target(target), fps(std::max(fps, 1)) {
+
+	switch (format) {
+	case CaptureFormat::Frames:
+		std::filesystem::create_directories(target);
+		break;
+	case CaptureFormat::Raw:
+	case CaptureFormat::Y4M:
+		out = std::fopen(target.c_str(), "wb");
+		break;
+	case CaptureFormat::Pipe:
+#ifdef _WIN32
+		out = _popen(target.c_str(), "wb");
+#else
+		// An encoder that exits early must fail the write, not kill the renderer
+		std::signal(SIGPIPE, SIG_IGN);
+		out = popen(target.c_str(), "w");
+#endif
+		break;
+	}
+	if (format != CaptureFormat::Frames && !out) {
+		std::cout << "ERROR::CAPTURE::CANNOT_OPEN " << target << "\n";
+		return;
+	}
+	if (format == CaptureFormat::Y4M)
+		std::fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", this->width, this->height, this->fps);
+
+	const GLsizeiptr frameBytes = static_cast<GLsizeiptr>(this->width) * this->height * 4;
+	slots.resize(static_cast<size_t>(std::min(std::max(ringSize, 2), 8)));
+	for (Slot& slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+		glState.BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+	}
+	glState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	ok = true;
+	writer = std::thread(&FrameCapture::WriterMain, this);
+}
+
+FrameCapture::~FrameCapture() {
+	Finish();
+}
+
+void FrameCapture::Capture(unsigned int framebuffer) {
+	if (!ok || finished)
+		return;
+	const auto start = std::chrono::steady_clock::now();
+	CaptureFrameStats frameStats;
+
+	// Earlier frames the GPU has copied, oldest first; the slot about to be reused is the oldest
+	for (size_t k = 0; k < slots.size(); ++k) {
+		const size_t slot = (nextSlot + k) % slots.size();
+		if (slots[slot].frame >= 0 && !Collect(slot, false, frameStats))
+			break;
+	}
+	// The ring wrapped onto a copy still in flight: this is the only place the GL thread waits
+	if (slots[nextSlot].frame >= 0)
+		Collect(nextSlot, true, frameStats);
+
+	Slot& slot = slots[nextSlot];
+	glState.BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glState.BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	// Left bound, every later glReadPixels into client memory would write into the buffer
+	glState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frame++;
+	nextSlot = (nextSlot + 1) % slots.size();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		frameStats.backlog = queue.size();
+		if (frameStats.stallMilliseconds > 0.0)
+			++stats.stalls;
+	}
+	frameStats.issueMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastFrame = frameStats;
+	AppendHistory(history, frameStats);
+}
+
+bool FrameCapture::Collect(size_t index, bool wait, CaptureFrameStats& frameStats) {
+	Slot& slot = slots[index];
+	GLenum status = glClientWaitSync(slot.fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (!wait)
+			return false;
+		const auto waitStart = std::chrono::steady_clock::now();
+		do {
+			status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		} while (status == GL_TIMEOUT_EXPIRED);
+		frameStats.stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	// The worker holds at most a ring's worth of frames; past that, wait for it to catch up
+	const size_t frameBytes = static_cast<size_t>(width) * height * 4;
+	std::vector<unsigned char> data;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (queue.size() >= slots.size()) {
+			const auto waitStart = std::chrono::steady_clock::now();
+			drained.wait(lock, [this]() { return queue.size() < slots.size(); });
+			frameStats.stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+		}
+		if (!spare.empty()) {
+			data = std::move(spare.back());
+			spare.pop_back();
+		}
+	}
+	data.resize(frameBytes);
+
+	glState.BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frameBytes), GL_MAP_READ_BIT);
+	if (mapped) {
+		std::memcpy(data.data(), mapped, frameBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else {
+		std::cout << "ERROR::CAPTURE::MAP_FAILED frame " << slot.frame << "\n";
+	}
+	glState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	++frameStats.mapped;
+	frameStats.latencyFrames = std::max(frameStats.latencyFrames, static_cast<unsigned int>(frame - slot.frame));
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Pending pending;
+		pending.frame = slot.frame;
+		pending.rgba = std::move(data);
+		queue.push_back(std::move(pending));
+	}
+	wake.notify_one();
+	slot.frame = -1;
+	return true;
+}
+
+void FrameCapture::Finish() {
+	if (finished)
+		return;
+	finished = true;
+	if (!ok)
+		return;
+
+	// Everything still in flight, oldest first
+	CaptureFrameStats frameStats;
+	for (size_t k = 0; k < slots.size(); ++k) {
+		const size_t slot = (nextSlot + k) % slots.size();
+		if (slots[slot].frame >= 0)
+			Collect(slot, true, frameStats);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+
+	if (out) {
+#ifdef _WIN32
+		format == CaptureFormat::Pipe ? _pclose(out) : std::fclose(out);
+#else
+		format == CaptureFormat::Pipe ? pclose(out) : std::fclose(out);
+#endif
+		out = nullptr;
+	}
+	for (Slot& slot : slots)
+		glDeleteBuffers(1, &slot.buffer);
+}
+
+CaptureStats FrameCapture::Stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+// ===| Writer Thread |=========================================================================
+
+void FrameCapture::WriterMain() {
+	std::vector<unsigned char> scratch;
+	for (;;) {
+		Pending pending;
+		bool failed;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty())
+				return;
+			pending = std::move(queue.front());
+			queue.pop_front();
+			failed = stats.failed;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		size_t bytes = 0;
+		const bool written = !failed && Write(pending, scratch, bytes);
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.writeMilliseconds += ms;
+			if (written) {
+				++stats.framesWritten;
+				stats.bytesWritten += bytes;
+			}
+			else if (!stats.failed) {
+				std::cout << "ERROR::CAPTURE::WRITE_FAILED frame " << pending.frame << ", dropping the rest\n";
+				stats.failed = true;
+			}
+			spare.push_back(std::move(pending.rgba));
+		}
+		drained.notify_all();
+	}
+}
+
+// BT.601 full range, the matrix of Y4M's C420jpeg, in 8.8 fixed point
+static unsigned char lumaOf(int r, int g, int b) {
+	return static_cast<unsigned char>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+bool FrameCapture::Write(const Pending& pending, std::vector<unsigned char>& scratch, size_t& bytes) {
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	const unsigned char* rgba = pending.rgba.data();
+
+	if (format == CaptureFormat::Y4M) {
+		const int chromaWidth = (width + 1) / 2;
+		const int chromaHeight = (height + 1) / 2;
+		const size_t lumaSize = static_cast<size_t>(width) * height;
+		const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+		scratch.resize(lumaSize + 2 * chromaSize);
+		unsigned char* luma = scratch.data();
+		unsigned char* cb = luma + lumaSize;
+		unsigned char* cr = cb + chromaSize;
+
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* src = rgba + (height - 1 - y) * rowBytes;
+			for (int x = 0; x < width; ++x, src += 4)
+				luma[static_cast<size_t>(y) * width + x] = lumaOf(src[0], src[1], src[2]);
+		}
+		// Chroma from the mean of each 2x2 block, edge pixels repeated for odd sizes
+		for (int cy = 0; cy < chromaHeight; ++cy) {
+			for (int cx = 0; cx < chromaWidth; ++cx) {
+				int r = 0, g = 0, b = 0;
+				for (int dy = 0; dy < 2; ++dy) {
+					const int y = std::min(cy * 2 + dy, height - 1);
+					for (int dx = 0; dx < 2; ++dx) {
+						const unsigned char* src = rgba + (height - 1 - y) * rowBytes + std::min(cx * 2 + dx, width - 1) * 4;
+						r += src[0];
+						g += src[1];
+						b += src[2];
+					}
+				}
+				// r, g, b are sums of four, so the shift is 10 rather than 8; the 128 offset is added
+				// before it to keep the value positive, and pure blue or red rounds up to 256
+				const size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+				cb[i] = static_cast<unsigned char>(std::min((-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10, 255));
+				cr[i] = static_cast<unsigned char>(std::min((128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10, 255));
+			}
+		}
+
+		bytes = 6 + scratch.size();
+		return std::fwrite("FRAME\n", 1, 6, out) == 6 && std::fwrite(scratch.data(), 1, scratch.size(), out) == scratch.size();
+	}
+
+	// RGB24, top row first
+	scratch.resize(static_cast<size_t>(width) * height * 3);
+	for (int y = 0; y < height; ++y) {
+		const unsigned char* src = rgba + (height - 1 - y) * rowBytes;
+		unsigned char* dst = scratch.data() + static_cast<size_t>(y) * width * 3;
+		for (int x = 0; x < width; ++x, src += 4, dst += 3) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+	bytes = scratch.size();
+
+	if (format == CaptureFormat::Frames) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame_%05ld.ppm", pending.frame);
+		return WritePPM((std::filesystem::path(target) / name).string(), width, height, scratch.data());
+	}
+	return std::fwrite(scratch.data(), 1, scratch.size(), out) == scratch.size();
+}
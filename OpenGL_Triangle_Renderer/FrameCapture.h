@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ===| Frame Capture |=========================================================================
+//
+// Reads rendered frames back without stalling the GL thread, and encodes and writes them on a
+// worker thread:
+//   1. Capture() issues glReadPixels into the next pixel pack buffer of a small ring and puts a
+//      fence behind it; the call returns at once, the copy happens on the GPU timeline,
+//   2. later Capture() calls map the buffers whose fences have signaled, oldest first, copy the
+//      pixels out and unmap them. Only when the ring wraps onto a buffer still in flight does
+//      the GL thread wait, so a frame is mapped at most ringSize frames after it was rendered,
+//   3. the worker flips the rows, converts and writes the frame: one PPM per frame, one raw
+//      RGB24 stream, a Y4M (4:2:0) video, or raw RGB24 piped into an encoder's stdin. At most
+//      ringSize frames wait for it; beyond that Capture() waits too, so memory and latency stay
+//      bounded when the disk or encoder cannot keep up.
+// Frames keep the size the capture was created with.
+
+enum class CaptureFormat : uint8_t {
+	Frames,   // DIR/frame_NNNNN.ppm
+	Raw,      // rgb24, top row first, frames back to back
+	Y4M,      // YUV4MPEG2, BT.601 full range, 4:2:0
+	Pipe      // rgb24 into the stdin of a shell command
+};
+
+const char* CaptureFormatName(CaptureFormat format);
+
+struct CaptureFrameStats {
+	double issueMilliseconds = 0.0;   // CPU time in Capture(): readback, maps and copies
+	double stallMilliseconds = 0.0;   // part of it spent waiting on a fence or the worker
+	unsigned int mapped = 0;          // earlier frames mapped during this call
+	unsigned int latencyFrames = 0;   // largest frames between readback and map among them
+	size_t backlog = 0;               // frames waiting for the worker afterwards
+};
+
+struct CaptureStats {
+	size_t framesWritten = 0;
+	size_t bytesWritten = 0;
+	double writeMilliseconds = 0.0;   // worker time: conversion plus writing
+	size_t stalls = 0;                // Capture() calls that had to wait
+	bool failed = false;              // a write failed; later frames are dropped
+};
+
+class FrameCapture {
+public:
+	// target: the directory for Frames, the file for Raw and Y4M, the command for Pipe.
+	// ringSize is clamped to [2, 8]; fps only goes into the Y4M header.
+	FrameCapture(int width, int height, CaptureFormat format, const std::string& target, int ringSize = 3, int fps = 60);
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// False when the output could not be opened; Capture() then does nothing
+	bool Ok() const { return ok; }
+
+	// Once per frame, after drawing: reads framebuffer (0 = the window's back buffer)
+	void Capture(unsigned int framebuffer);
+	// Maps every frame still in flight, waits for the worker to write them and closes the output
+	void Finish();
+
+	CaptureFormat Format() const { return format; }
+	int RingSize() const { return static_cast<int>(slots.size()); }
+	CaptureStats Stats() const;
+	const CaptureFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<CaptureFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	struct Slot {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		long frame = -1;          // frame read into it, -1 when free
+	};
+
+	struct Pending {
+		long frame = 0;
+		std::vector<unsigned char> rgba;   // bottom row first, as GL reads it
+	};
+
+	bool Collect(size_t slot, bool wait, CaptureFrameStats& frameStats);
+	void WriterMain();
+	bool Write(const Pending& pending, std::vector<unsigned char>& scratch, size_t& bytes);
+
+	int width;
+	int height;
+	CaptureFormat format;
+	std::string target;
+	int fps;
+	bool ok = false;
+	bool finished = false;
+
+	std::vector<Slot> slots;
+	size_t nextSlot = 0;
+	long frame = 0;
+	std::FILE* out = nullptr;
+
+	std::thread writer;
+	mutable std::mutex mutex;
+	std::condition_variable wake;        // worker: a frame was queued or the capture finished
+	std::condition_variable drained;     // GL thread: a frame was written
+	std::deque<Pending> queue;
+	std::vector<std::vector<unsigned char>> spare;   // recycled frame buffers
+	bool stopping = false;
+	CaptureStats stats;
+
+	CaptureFrameStats lastFrame;
+	std::vector<CaptureFrameStats> history;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// ===| Frame History |=========================================================================
+//
+// Per-frame statistics are kept for the reports printed and written at the end of a run. A
+// window may stay open for as long as the user likes, so a history holds at most
+// historyFrames entries: once full, the oldest half is dropped in one go, which keeps the cost
+// per frame constant. A run of known length raises the limit to its frame count up front, so a
+// benchmark never trims and its reports can skip the warmup by index, in step with the frame
+// timer. LastFrameStats() never depends on the history.
+
+const size_t MIN_HISTORY_FRAMES = 32768;
+
+// Set once, before any thread that records history starts
+inline size_t historyFrames = MIN_HISTORY_FRAMES;
+
+// Makes every history keep at least frames entries
+inline void ReserveHistoryFrames(size_t frames) {
+	historyFrames = std::max(frames, MIN_HISTORY_FRAMES);
+}
+
+template <class T>
+void AppendHistory(std::vector<T>& history, const T& frame) {
+	if (history.size() >= historyFrames)
+		history.erase(history.begin(), history.begin() + historyFrames / 2);
+	history.push_back(frame);
+}
@@ -0,0 +1,182 @@
+#include "FramePacer.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#endif
+
+// ===| Frame Pacing |==========================================================================
+
+static double milliseconds(std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+const char* PacingModeName(PacingMode mode) {
+	switch (mode) {
+	case PacingMode::Driver:   return "driver";
+	case PacingMode::Uncapped: return "uncapped";
+	case PacingMode::Vsync:    return "vsync";
+	case PacingMode::Limit:    return "limit";
+	}
+	return "unknown";
+}
+
+FramePacer::FramePacer(GLFWwindow* window, PacingMode mode, double targetFps, int maxFramesInFlight)
+	: mode(mode), spinMargin(std::chrono::milliseconds(1)) {
+
+	if (window && mode != PacingMode::Driver)
+		glfwSwapInterval(mode == PacingMode::Vsync ? 1 : 0);
+
+	if (mode == PacingMode::Limit) {
+		targetMilliseconds = 1000.0 / std::max(targetFps, 1.0);
+		period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(targetMilliseconds));
+#ifdef _WIN32
+		// The default timer resolution (~15.6 ms) would make every sleep overshoot a frame
+		timeBeginPeriod(1);
+#endif
+	}
+	else if (mode == PacingMode::Vsync && window) {
+		GLFWmonitor* monitor = glfwGetWindowMonitor(window);
+		if (!monitor)
+			monitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* videoMode = monitor ? glfwGetVideoMode(monitor) : NULL;
+		if (videoMode && videoMode->refreshRate > 0)
+			targetMilliseconds = 1000.0 / videoMode->refreshRate;
+	}
+
+	fences.resize(static_cast<size_t>(std::max(maxFramesInFlight, 0)), nullptr);
+}
+
+FramePacer::~FramePacer() {
+	for (GLsync fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+	}
+#ifdef _WIN32
+	if (mode == PacingMode::Limit)
+		timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::BeginFrame() {
+	current = PacingFrameStats();
+	if (fences.empty())
+		return;
+
+	// The slot about to be reused holds the fence of the frame maxFramesInFlight back
+	GLsync& fence = fences[nextFence];
+	if (!fence)
+		return;
+
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		const Clock::time_point start = Clock::now();
+		do {
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		} while (status == GL_TIMEOUT_EXPIRED);
+		current.fenceWaitMilliseconds = milliseconds(Clock::now() - start);
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void FramePacer::EndFrame() {
+	if (!fences.empty()) {
+		fences[nextFence] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		nextFence = (nextFence + 1) % fences.size();
+	}
+
+	Clock::time_point now = Clock::now();
+	if (mode == PacingMode::Limit) {
+		Limit(now);
+		now = Clock::now();
+	}
+
+	// The first frame after a restart has nothing to measure its interval against
+	if (lastPoint != Clock::time_point()) {
+		current.intervalMilliseconds = milliseconds(now - lastPoint);
+		lastFrame = current;
+		AppendHistory(history, current);
+	}
+	lastPoint = now;
+}
+
+void FramePacer::Limit(Clock::time_point now) {
+	if (deadline == Clock::time_point())
+		deadline = now;
+	deadline += period;
+
+	if (now >= deadline) {
+		// Late: keep the cadence if the miss is small, restart it otherwise
+		current.lateMilliseconds = milliseconds(now - deadline);
+		if (now - deadline > period)
+			deadline = now;
+		return;
+	}
+
+	// Sleep most of the way; the OS wakes threads late by a varying amount, which the margin
+	// tracks: it jumps up to cover the latest oversleep and decays slowly back down
+	const Clock::time_point wake = deadline - spinMargin;
+	if (wake > now) {
+		std::this_thread::sleep_until(wake);
+		const Clock::time_point woke = Clock::now();
+		current.sleepMilliseconds = milliseconds(woke - now);
+		const Clock::duration oversleep = woke > wake ? woke - wake : Clock::duration::zero();
+		spinMargin = std::max(spinMargin * 15 / 16, oversleep * 3 / 2);
+		spinMargin = std::min(std::max(spinMargin, Clock::duration(std::chrono::microseconds(100))),
+			Clock::duration(std::chrono::milliseconds(4)));
+		now = woke;
+	}
+
+	// Spin the rest: yielding keeps worker threads running on a machine with few cores
+	const Clock::time_point spinStart = now;
+	while (now < deadline) {
+		std::this_thread::yield();
+		now = Clock::now();
+	}
+	current.spinMilliseconds = milliseconds(now - spinStart);
+	current.lateMilliseconds = milliseconds(now - deadline);
+}
+
+PacingJitter FramePacer::Jitter(size_t skipFrames) const {
+	PacingJitter jitter;
+	jitter.targetMilliseconds = targetMilliseconds;
+	const size_t first = std::min(skipFrames, history.size());
+	jitter.frames = history.size() - first;
+	if (jitter.frames == 0)
+		return jitter;
+
+	double sum = 0.0;
+	for (size_t i = first; i < history.size(); ++i)
+		sum += history[i].intervalMilliseconds;
+	jitter.meanInterval = sum / jitter.frames;
+
+	const double expected = targetMilliseconds > 0.0 ? targetMilliseconds : jitter.meanInterval;
+	double squares = 0.0, errors = 0.0;
+	for (size_t i = first; i < history.size(); ++i) {
+		const double interval = history[i].intervalMilliseconds;
+		squares += (interval - jitter.meanInterval) * (interval - jitter.meanInterval);
+		errors += std::abs(interval - expected);
+		if (interval > expected * 1.5)
+			++jitter.missed;
+	}
+	jitter.stdDev = std::sqrt(squares / jitter.frames);
+	jitter.meanError = errors / jitter.frames;
+	return jitter;
+}
+
+void FramePacer::ClearHistory() {
+	history.clear();
+	lastPoint = Clock::time_point();
+	deadline = Clock::time_point();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===| Frame Pacing |==========================================================================
+//
+// Decides when a frame may start and when the next one is due:
+//   - Driver leaves the swap interval at whatever the driver defaults to (the old behavior),
+//   - Uncapped sets a swap interval of 0 and runs as fast as the GPU allows,
+//   - Vsync sets a swap interval of 1, so the swap holds frames to the display's refresh,
+//   - Limit sets a swap interval of 0 and holds a target period on the CPU: it sleeps until
+//     shortly before the deadline, then spins the rest of the way. The spin margin follows how
+//     late the OS has been waking the thread, so the sleep never overshoots the deadline.
+//     A frame that misses its deadline by more than a period restarts the cadence instead of
+//     rushing the next ones to catch up.
+// Independently of the mode, a limit on frames in flight puts a fence behind every frame and
+// waits, before starting a new frame, on the fence of the frame that many frames back. That
+// bounds how far the CPU runs ahead of the GPU, and with it the input latency.
+// Every frame records its interval since the previous one; their spread is the jitter.
+
+enum class PacingMode : uint8_t {
+	Driver,
+	Uncapped,
+	Vsync,
+	Limit
+};
+
+const char* PacingModeName(PacingMode mode);
+
+struct PacingFrameStats {
+	double intervalMilliseconds = 0.0;    // since the previous frame's pacing point
+	double sleepMilliseconds = 0.0;       // limiter: time the thread slept
+	double spinMilliseconds = 0.0;        // limiter: time spun after waking up
+	double lateMilliseconds = 0.0;        // limiter: how far past its deadline the frame ended
+	double fenceWaitMilliseconds = 0.0;   // waiting on the frame maxFramesInFlight back
+};
+
+struct PacingJitter {
+	size_t frames = 0;
+	double targetMilliseconds = 0.0;      // 0 when the mode has no target period
+	double meanInterval = 0.0;
+	double stdDev = 0.0;                  // standard deviation of the intervals
+	double meanError = 0.0;               // mean |interval - target|, or |interval - mean| without one
+	size_t missed = 0;                    // intervals longer than 1.5 targets (or 1.5 means)
+};
+
+class FramePacer {
+public:
+	// window: NULL when nothing is presented (headless), the swap interval is then left alone.
+	// targetFps only matters for Limit; maxFramesInFlight 0 = no limit.
+	FramePacer(GLFWwindow* window, PacingMode mode, double targetFps = 60.0, int maxFramesInFlight = 0);
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// Before drawing: waits until fewer than maxFramesInFlight frames are still on the GPU
+	void BeginFrame();
+	// After the swap: fences the frame, holds the limiter's cadence and records the interval
+	void EndFrame();
+
+	PacingMode Mode() const { return mode; }
+	int MaxFramesInFlight() const { return static_cast<int>(fences.size()); }
+	bool BoundsFramesInFlight() const { return !fences.empty(); }
+	// Limit: the target period; Vsync: the monitor's refresh period when known; otherwise 0
+	double TargetMilliseconds() const { return targetMilliseconds; }
+
+	PacingJitter Jitter(size_t skipFrames = 0) const;
+	const PacingFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<PacingFrameStats>& History() const { return history; }
+	// Also restarts the cadence, so a pause between runs is not counted as an interval
+	void ClearHistory();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void Limit(Clock::time_point now);
+
+	PacingMode mode;
+	double targetMilliseconds = 0.0;
+	Clock::duration period = Clock::duration::zero();
+	Clock::duration spinMargin;
+
+	std::vector<GLsync> fences;   // one per frame in flight
+	size_t nextFence = 0;
+
+	Clock::time_point lastPoint;
+	Clock::time_point deadline;
+	PacingFrameStats current;
+
+	PacingFrameStats lastFrame;
+	std::vector<PacingFrameStats> history;
+};
@@ -0,0 +1,46 @@
+#include "GLExtensions.h"
+
+#include <cstring>
+
+GLExtensions glExt;
+
+bool HasGLExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (ext && std::strcmp(ext, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static bool versionAtLeast(int major, int minor) {
+	return glExt.majorVersion > major || (glExt.majorVersion == major && glExt.minorVersion >= minor);
+}
+
+void LoadGLExtensions(GLADloadproc load) {
+	glExt = GLExtensions();
+	glGetIntegerv(GL_MAJOR_VERSION, &glExt.majorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &glExt.minorVersion);
+
+	// Program binaries: also requires at least one binary format, some drivers expose none
+	if (versionAtLeast(4, 1) || HasGLExtension("GL_ARB_get_program_binary")) {
+		glExt.GetProgramBinary = (PFN_glGetProgramBinary)load("glGetProgramBinary");
+		glExt.ProgramBinary = (PFN_glProgramBinary)load("glProgramBinary");
+		glExt.ProgramParameteri = (PFN_glProgramParameteri)load("glProgramParameteri");
+
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		glExt.programBinary = formats > 0 && glExt.GetProgramBinary && glExt.ProgramBinary && glExt.ProgramParameteri;
+	}
+
+	if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+		glExt.MaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreadsKHR)load("glMaxShaderCompilerThreadsKHR");
+	else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+		glExt.MaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreadsKHR)load("glMaxShaderCompilerThreadsARB");
+	glExt.parallelShaderCompile = glExt.MaxShaderCompilerThreads != nullptr;
+
+	glExt.textureCompressionS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc")
+		|| HasGLExtension("GL_EXT_texture_compression_dxt1");
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// ===| Optional GL Entry Points |==============================================================
+//
+// glad is generated for the GL 3.3 core profile only. Features from newer versions or from
+// extensions are loaded here at runtime and used only when the driver reports them.
+
+// GL 4.1 / ARB_get_program_binary
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// EXT_texture_compression_s3tc (core in no GL version, supported nearly everywhere on desktop)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+typedef void (APIENTRYP PFN_glGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFN_glProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFN_glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFN_glMaxShaderCompilerThreadsKHR)(GLuint count);
+
+struct GLExtensions {
+	int majorVersion = 0;
+	int minorVersion = 0;
+
+	bool programBinary = false;
+	PFN_glGetProgramBinary GetProgramBinary = nullptr;
+	PFN_glProgramBinary ProgramBinary = nullptr;
+	PFN_glProgramParameteri ProgramParameteri = nullptr;
+
+	// Compiles/links run on driver threads; GL_COMPLETION_STATUS_KHR polls without blocking
+	bool parallelShaderCompile = false;
+	PFN_glMaxShaderCompilerThreadsKHR MaxShaderCompilerThreads = nullptr;
+
+	// BC1 (DXT1) textures: 4 bits per pixel instead of RGBA8's 32
+	bool textureCompressionS3TC = false;
+};
+
+// Filled in by LoadGLExtensions(); must be called after gladLoadGLLoader with a current context.
+extern GLExtensions glExt;
+
+void LoadGLExtensions(GLADloadproc load);
+bool HasGLExtension(const char* name);
@@ -0,0 +1,133 @@
+#include "Headless.h"
+#include "StateCache.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// ===| Create / Destroy FBO |==================================================================
+
+bool CreateOffscreenTarget(OffscreenTarget& target, int width, int height) {
+	target.width = width;
+	target.height = height;
+
+	glGenFramebuffers(1, &target.FBO);
+	glState.BindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+
+	// Color: RGBA8 renderbuffer (what the window's back buffer would normally be)
+	glGenRenderbuffers(1, &target.colorRBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.colorRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorRBO);
+
+	// Depth/stencil: matches GLFW's default window framebuffer
+	glGenRenderbuffers(1, &target.depthRBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.depthRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depthRBO);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE (0x" << std::hex << status << std::dec << ")\n";
+		glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
+		DestroyOffscreenTarget(target);
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void DestroyOffscreenTarget(OffscreenTarget& target) {
+	glState.OnFramebufferDeleted(target.FBO);
+	glDeleteFramebuffers(1, &target.FBO);
+	glDeleteRenderbuffers(1, &target.colorRBO);
+	glDeleteRenderbuffers(1, &target.depthRBO);
+	target = OffscreenTarget();
+}
+
+// ===| Readback |==============================================================================
+
+std::vector<unsigned char> ReadOffscreenPixels(const OffscreenTarget& target) {
+	const size_t rowBytes = static_cast<size_t>(target.width) * 3;
+	std::vector<unsigned char> pixels(rowBytes * target.height);
+
+	glState.BindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, target.width, target.height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	// GL returns the bottom row first; images on disk expect the top row first
+	std::vector<unsigned char> row(rowBytes);
+	for (int y = 0; y < target.height / 2; ++y) {
+		unsigned char* top = pixels.data() + y * rowBytes;
+		unsigned char* bottom = pixels.data() + (target.height - 1 - y) * rowBytes;
+		std::memcpy(row.data(), top, rowBytes);
+		std::memcpy(top, bottom, rowBytes);
+		std::memcpy(bottom, row.data(), rowBytes);
+	}
+	return pixels;
+}
+
+bool WritePPM(const std::string& path, int width, int height, const unsigned char* rgb) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "ERROR::PPM::CANNOT_OPEN_FILE " << path << "\n";
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(rgb), static_cast<std::streamsize>(width) * height * 3);
+	return file.good();
+}
+
+// Whitespace-separated header field, skipping # comments
+static bool readHeaderToken(std::istream& in, std::string& token) {
+	token.clear();
+	int c;
+	while ((c = in.get()) != EOF) {
+		if (c == '#') {
+			while ((c = in.get()) != EOF && c != '\n') {}
+			continue;
+		}
+		if (std::isspace(c)) {
+			if (!token.empty())
+				return true;
+			continue;
+		}
+		token += static_cast<char>(c);
+	}
+	return !token.empty();
+}
+
+bool ReadPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "ERROR::PPM::CANNOT_OPEN_FILE " << path << "\n";
+		return false;
+	}
+
+	// The single whitespace after maxval is consumed with it, so the pixels start right after
+	std::string magic, widthToken, heightToken, maxval;
+	if (!readHeaderToken(file, magic) || magic != "P6" || !readHeaderToken(file, widthToken)
+		|| !readHeaderToken(file, heightToken) || !readHeaderToken(file, maxval) || maxval != "255") {
+		std::cout << "ERROR::PPM::UNSUPPORTED_FORMAT " << path << " (expected binary 8-bit PPM)\n";
+		return false;
+	}
+
+	width = std::atoi(widthToken.c_str());
+	height = std::atoi(heightToken.c_str());
+	if (width <= 0 || height <= 0) {
+		std::cout << "ERROR::PPM::INVALID_SIZE " << path << "\n";
+		return false;
+	}
+
+	rgb.resize(static_cast<size_t>(width) * height * 3);
+	if (!file.read(reinterpret_cast<char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()))) {
+		std::cout << "ERROR::PPM::TRUNCATED " << path << "\n";
+		return false;
+	}
+	return true;
+}
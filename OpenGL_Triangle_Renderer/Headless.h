@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// ===| Offscreen Render Target |===============================================================
+//
+// Used by the headless mode: when there is no display, the context has no usable default
+// framebuffer, so every frame is rendered into this FBO instead and read back from it.
+
+struct OffscreenTarget {
+	unsigned int FBO = 0;
+	unsigned int colorRBO = 0;
+	unsigned int depthRBO = 0;
+	int width = 0;
+	int height = 0;
+};
+
+bool CreateOffscreenTarget(OffscreenTarget& target, int width, int height);
+void DestroyOffscreenTarget(OffscreenTarget& target);
+
+// Reads the color attachment back as tightly packed RGB8, top row first.
+std::vector<unsigned char> ReadOffscreenPixels(const OffscreenTarget& target);
+
+// Writes a binary PPM (P6) image; rgb must hold width * height * 3 bytes, top row first.
+bool WritePPM(const std::string& path, int width, int height, const unsigned char* rgb);
+// Reads a binary 8-bit PPM (P6) into rgb, top row first, the layout WritePPM() takes
+bool ReadPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb);
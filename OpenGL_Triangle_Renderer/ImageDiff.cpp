@@ -0,0 +1,163 @@
+#include "ImageDiff.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DIFF_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define DIFF_TARGET_AVX2
+#else
+#define DIFF_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// ===| Image Diff |============================================================================
+
+// Running totals over the channel bytes, walked in ascending order so a pixel whose channels
+// fail in the same (or consecutive) blocks is only counted once
+struct DiffAccumulator {
+	uint64_t sum = 0;
+	int max = 0;
+	size_t failed = 0;
+	size_t lastFailedPixel = SIZE_MAX;
+
+	void Fail(size_t byte) {
+		const size_t pixel = byte / 3;
+		if (pixel != lastFailedPixel) {
+			++failed;
+			lastFailedPixel = pixel;
+		}
+	}
+};
+
+static void diffScalar(const unsigned char* a, const unsigned char* b, size_t begin, size_t end,
+	int tolerance, DiffAccumulator& acc) {
+	for (size_t i = begin; i < end; ++i) {
+		const int difference = std::abs(a[i] - b[i]);
+		acc.sum += static_cast<uint64_t>(difference);
+		acc.max = std::max(acc.max, difference);
+		if (difference > tolerance)
+			acc.Fail(i);
+	}
+}
+
+#ifdef DIFF_X86
+// Counts the failing pixels of a block whose sum and maximum are already taken
+static void failBlock(const unsigned char* a, const unsigned char* b, size_t begin, size_t end,
+	int tolerance, DiffAccumulator& acc) {
+	for (size_t i = begin; i < end; ++i) {
+		if (std::abs(a[i] - b[i]) > tolerance)
+			acc.Fail(i);
+	}
+}
+
+static size_t diffSSE(const unsigned char* a, const unsigned char* b, size_t size, int tolerance, DiffAccumulator& acc) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i limit = _mm_set1_epi8(static_cast<char>(tolerance));
+	__m128i sum = zero, max = zero;
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		const __m128i difference = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(difference, zero));
+		max = _mm_max_epu8(max, difference);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(difference, limit), zero)) != 0xFFFF)
+			failBlock(a, b, i, i + 16, tolerance, acc);
+	}
+
+	alignas(16) uint64_t sums[2];
+	alignas(16) unsigned char maxes[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+	_mm_store_si128(reinterpret_cast<__m128i*>(maxes), max);
+	acc.sum += sums[0] + sums[1];
+	acc.max = std::max(acc.max, static_cast<int>(*std::max_element(maxes, maxes + 16)));
+	return i;
+}
+
+DIFF_TARGET_AVX2
+static size_t diffAVX2(const unsigned char* a, const unsigned char* b, size_t size, int tolerance, DiffAccumulator& acc) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i limit = _mm256_set1_epi8(static_cast<char>(tolerance));
+	__m256i sum = zero, max = zero;
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		const __m256i difference = _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(difference, zero));
+		max = _mm256_max_epu8(max, difference);
+
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(difference, limit), zero)) != -1)
+			failBlock(a, b, i, i + 32, tolerance, acc);
+	}
+
+	alignas(32) uint64_t sums[4];
+	alignas(32) unsigned char maxes[32];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(sums), sum);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(maxes), max);
+	acc.sum += sums[0] + sums[1] + sums[2] + sums[3];
+	acc.max = std::max(acc.max, static_cast<int>(*std::max_element(maxes, maxes + 32)));
+	return i;
+}
+#endif
+
+ImageDiffResult DiffImages(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual,
+	int tolerance, CullSimd simd) {
+	ImageDiffResult result;
+	const size_t size = std::min(expected.size(), actual.size());
+	result.pixels = size / 3;
+	if (size == 0)
+		return result;
+
+	// Differences are bytes: a tolerance of 255 passes everything
+	tolerance = std::min(std::max(tolerance, 0), 255);
+	DiffAccumulator acc;
+	size_t done = 0;
+#ifdef DIFF_X86
+	if (simd == CullSimd::AVX2 && BestCullSimd() == CullSimd::AVX2)
+		done = diffAVX2(expected.data(), actual.data(), size, tolerance, acc);
+	else if (simd != CullSimd::Scalar)
+		done = diffSSE(expected.data(), actual.data(), size, tolerance, acc);
+#else
+	(void)simd;
+#endif
+	diffScalar(expected.data(), actual.data(), done, size, tolerance, acc);
+
+	result.failedPixels = acc.failed;
+	result.maxDifference = acc.max;
+	result.meanDifference = static_cast<double>(acc.sum) / size;
+	return result;
+}
+
+std::vector<unsigned char> MakeDiffHeatmap(const std::vector<unsigned char>& expected,
+	const std::vector<unsigned char>& actual, int tolerance) {
+	const size_t size = std::min(expected.size(), actual.size());
+	std::vector<unsigned char> heatmap(size);
+	for (size_t i = 0; i + 2 < size; i += 3) {
+		int difference = 0;
+		for (int c = 0; c < 3; ++c)
+			difference = std::max(difference, std::abs(expected[i + c] - actual[i + c]));
+
+		unsigned char* out = &heatmap[i];
+		if (difference > tolerance) {
+			out[0] = 255;
+			out[1] = static_cast<unsigned char>(std::min(255, difference * 2));
+			out[2] = 0;
+		}
+		else if (difference > 0) {
+			out[0] = 0;
+			out[1] = 64;
+			out[2] = 255;
+		}
+		else {
+			const int gray = (expected[i] * 77 + expected[i + 1] * 150 + expected[i + 2] * 29) >> 10;
+			out[0] = out[1] = out[2] = static_cast<unsigned char>(gray);
+		}
+	}
+	return heatmap;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Culling.h"
+
+// ===| Image Diff |============================================================================
+//
+// Compares two tightly packed RGB8 images of the same size, as ReadOffscreenPixels() returns
+// them. Channel differences are taken 16 (SSE2) or 32 (AVX2) bytes at a time; blocks that are
+// within tolerance everywhere, the common case, never leave the vector registers. Only blocks
+// holding a larger difference are walked pixel by pixel to count the failing pixels.
+
+struct ImageDiffResult {
+	size_t pixels = 0;
+	size_t failedPixels = 0;       // some channel differs by more than the tolerance
+	int maxDifference = 0;         // largest channel difference
+	double meanDifference = 0.0;   // mean channel difference
+};
+
+// CullSimd names the instruction set here too: Scalar, SSE (SSE2) or AVX2
+ImageDiffResult DiffImages(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual,
+	int tolerance, CullSimd simd = BestCullSimd());
+
+// RGB8 heatmap of the same size: the expected image dimmed to gray, pixels within tolerance that
+// differ in blue, failing pixels from red to yellow as the difference grows
+std::vector<unsigned char> MakeDiffHeatmap(const std::vector<unsigned char>& expected,
+	const std::vector<unsigned char>& actual, int tolerance);
@@ -0,0 +1,82 @@
+#include "Instancing.h"
+#include "Mesh.h"
+#include "StateCache.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ===| Per-Instance Data |=====================================================================
+
+std::vector<InstanceData> MakeInstanceGrid(size_t count) {
+	std::vector<InstanceData> instances(count);
+	if (count == 0)
+		return instances;
+
+	const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+	const float cell = 2.0f / side;
+
+	for (size_t i = 0; i < count; ++i) {
+		const size_t x = i % side;
+		const size_t y = i / side;
+		InstanceData& instance = instances[i];
+		instance.offsetScale[0] = -1.0f + (x + 0.5f) * cell;
+		instance.offsetScale[1] = -1.0f + (y + 0.5f) * cell;
+		instance.offsetScale[2] = 0.0f;
+		instance.offsetScale[3] = cell;
+
+		// Cheap integer hash for a stable, varied tint per instance
+		uint32_t h = static_cast<uint32_t>(i) * 2654435761u;
+		h ^= h >> 15;
+		instance.color = PackUNorm8x4(0.5f + (h & 0xFF) / 510.0f, 0.5f + ((h >> 8) & 0xFF) / 510.0f,
+			0.5f + ((h >> 16) & 0xFF) / 510.0f, 1.0f);
+	}
+	return instances;
+}
+
+void SetDefaultInstanceAttributes() {
+	glVertexAttrib4f(ATTRIB_INSTANCE_OFFSET_SCALE, 0.0f, 0.0f, 0.0f, 1.0f);
+	glVertexAttrib4f(ATTRIB_INSTANCE_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+// ===| Instance Buffer |=======================================================================
+
+void AttachInstanceAttributes(unsigned int buffer, size_t baseOffset) {
+	const GLsizei stride = sizeof(InstanceData);
+	glState.BindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_OFFSET_SCALE);
+	glVertexAttribPointer(ATTRIB_INSTANCE_OFFSET_SCALE, 4, GL_FLOAT, GL_FALSE, stride,
+		(void*)(baseOffset + offsetof(InstanceData, offsetScale)));
+	glVertexAttribDivisor(ATTRIB_INSTANCE_OFFSET_SCALE, 1);
+
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_COLOR);
+	glVertexAttribPointer(ATTRIB_INSTANCE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+		(void*)(baseOffset + offsetof(InstanceData, color)));
+	glVertexAttribDivisor(ATTRIB_INSTANCE_COLOR, 1);
+}
+
+InstanceBuffer CreateInstanceBuffer(const GpuMesh& mesh, const std::vector<InstanceData>& instances) {
+	InstanceBuffer instanceBuffer;
+	instanceBuffer.count = static_cast<GLsizei>(instances.size());
+
+	glGenBuffers(1, &instanceBuffer.buffer);
+	glState.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer.buffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STATIC_DRAW);
+
+	glState.BindVertexArray(mesh.VAO);
+	AttachInstanceAttributes(instanceBuffer.buffer);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return instanceBuffer;
+}
+
+void DestroyInstanceBuffer(InstanceBuffer& instances) {
+	glState.OnBufferDeleted(instances.buffer);
+	glDeleteBuffers(1, &instances.buffer);
+	instances = InstanceBuffer();
+}
+
+void DrawMeshInstanced(const GpuMesh& mesh, GLsizei instanceCount) {
+	glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, (void*)0, instanceCount);
+}
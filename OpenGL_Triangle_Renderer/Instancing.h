@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct GpuMesh;
+
+// ===| Per-Instance Data |=====================================================================
+//
+// 20 bytes per copy of a mesh, fed to the vertex shader with glVertexAttribDivisor(.., 1).
+
+struct InstanceData {
+	float offsetScale[4];   // x, y, z offset and uniform scale
+	uint32_t color;         // RGBA8 tint, multiplied with the vertex color
+};
+
+// Lays count instances out on a square grid covering clip space, each scaled to its cell
+std::vector<InstanceData> MakeInstanceGrid(size_t count);
+
+// Constant values for the instance attributes when no instance buffer is attached.
+// Current attribute values are context state (not VAO state), so this is set once after init.
+void SetDefaultInstanceAttributes();
+
+// ===| Instance Buffer |=======================================================================
+
+struct InstanceBuffer {
+	unsigned int buffer = 0;
+	GLsizei count = 0;
+};
+
+// Uploads the instances and points the mesh VAO's instance attributes at them
+InstanceBuffer CreateInstanceBuffer(const GpuMesh& mesh, const std::vector<InstanceData>& instances);
+void DestroyInstanceBuffer(InstanceBuffer& instances);
+
+// Binds instance attributes of the currently bound VAO to buffer at baseOffset
+void AttachInstanceAttributes(unsigned int buffer, size_t baseOffset = 0);
+
+void DrawMeshInstanced(const GpuMesh& mesh, GLsizei instanceCount);
@@ -0,0 +1,91 @@
+#include "Lod.h"
+#include "FrameHistory.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+
+// ===| LOD Chain |=============================================================================
+
+LodChain BuildLodChain(const Mesh& mesh, size_t maxLevels, float ratio) {
+	LodChain chain;
+	chain.indices = mesh.indices;
+	chain.levels.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+
+	// Each level is simplified from the original rather than from the level before, so errors
+	// do not compound; the quadrics then measure every level against what was authored
+	size_t previousTriangles = mesh.TriangleCount();
+	while (chain.levels.size() < maxLevels) {
+		const size_t target = static_cast<size_t>(previousTriangles * ratio);
+		if (target == 0)
+			break;
+
+		SimplifyResult level = SimplifyMesh(mesh, target);
+		const size_t triangles = level.indices.size() / 3;
+		if (triangles == 0 || triangles * 10 > previousTriangles * 9)
+			break;
+
+		OptimizeVertexCache(level.indices, mesh.VertexCount());
+		const float error = std::max(level.error, chain.levels.back().error);
+		chain.levels.push_back({ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(level.indices.size()), error });
+		chain.indices.insert(chain.indices.end(), level.indices.begin(), level.indices.end());
+		previousTriangles = triangles;
+	}
+	return chain;
+}
+
+// ===| LOD Selection |=========================================================================
+
+LodSelector::LodSelector(size_t objectCount, float pixelError, float hysteresis)
+	: pixelError(pixelError), hysteresis(std::min(std::max(hysteresis, 0.0f), 1.0f)), current(objectCount, 0) {
+}
+
+void LodSelector::Register(const GpuMesh* mesh, const LodChain& chain) {
+	if (!chain.levels.empty())
+		chains[mesh] = chain.levels;
+}
+
+LodLevel LodSelector::Select(uint32_t object, const GpuMesh* mesh, float clipScale) {
+	++frame.selections;
+
+	auto found = chains.find(mesh);
+	if (found == chains.end()) {
+		LodLevel whole;
+		whole.indexCount = static_cast<uint32_t>(mesh->indexCount);
+		frame.fullTriangles += whole.indexCount / 3;
+		frame.selectedTriangles += whole.indexCount / 3;
+		return whole;
+	}
+
+	// Clip space spans the viewport's height in two units
+	const std::vector<LodLevel>& levels = found->second;
+	const float pixelsPerUnit = clipScale * viewportHeight * 0.5f;
+	const size_t previous = std::min<size_t>(current[object], levels.size() - 1);
+
+	size_t level = previous;
+	if (levels[level].error * pixelsPerUnit > pixelError) {
+		while (level > 0 && levels[level].error * pixelsPerUnit > pixelError)
+			--level;
+	}
+	else {
+		const float coarserError = pixelError * (1.0f - hysteresis);
+		while (level + 1 < levels.size() && levels[level + 1].error * pixelsPerUnit <= coarserError)
+			++level;
+	}
+
+	if (level != current[object])
+		++frame.switches;
+	if (level != 0)
+		++frame.reduced;
+	current[object] = static_cast<uint8_t>(level);
+	frame.fullTriangles += levels[0].indexCount / 3;
+	frame.selectedTriangles += levels[level].indexCount / 3;
+	return levels[level];
+}
+
+void LodSelector::EndFrame() {
+	lastFrame = frame;
+	AppendHistory(history, frame);
+	frame = LodFrameStats();
+}
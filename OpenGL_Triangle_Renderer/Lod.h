@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct GpuMesh;
+struct Mesh;
+
+// ===| LOD Chain |=============================================================================
+//
+// Every level of a mesh is an index range into one shared element buffer over the original
+// vertices: level 0 is the mesh as authored, each further level has about ratio times the
+// triangles of the one before. Upload with UploadMesh(mesh, chain.indices, layout); the
+// uploaded indexCount covers level 0 only.
+
+struct LodLevel {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;   // geometric error against level 0, in mesh units
+};
+
+struct LodChain {
+	std::vector<uint32_t> indices;
+	std::vector<LodLevel> levels;
+};
+
+// Stops early once a level would not remove at least a tenth of the previous one's triangles
+LodChain BuildLodChain(const Mesh& mesh, size_t maxLevels = 6, float ratio = 0.5f);
+
+// ===| LOD Selection |=========================================================================
+//
+// Picks per object the coarsest level whose error, projected to the screen, stays under
+// pixelError. Going coarser needs the error under pixelError * (1 - hysteresis), so an object
+// near the threshold does not flip between two levels every frame.
+
+struct LodFrameStats {
+	size_t selections = 0;
+	size_t reduced = 0;          // objects drawn at a level other than 0
+	unsigned int switches = 0;   // objects whose level changed since last frame
+	size_t fullTriangles = 0;    // triangles the selected meshes have at level 0
+	size_t selectedTriangles = 0;
+};
+
+class LodSelector {
+public:
+	LodSelector(size_t objectCount, float pixelError = 1.0f, float hysteresis = 0.25f);
+
+	void Register(const GpuMesh* mesh, const LodChain& chain);
+	void SetViewportHeight(int pixels) { viewportHeight = static_cast<float>(pixels); }
+
+	// Level to draw object with; clipScale is the object's scale from mesh units to clip space.
+	// Unregistered meshes always get their whole index range.
+	LodLevel Select(uint32_t object, const GpuMesh* mesh, float clipScale);
+
+	void EndFrame();
+	const LodFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<LodFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	float pixelError;
+	float hysteresis;
+	float viewportHeight = 1.0f;
+
+	std::unordered_map<const GpuMesh*, std::vector<LodLevel>> chains;
+	std::vector<uint8_t> current;   // level drawn last frame, per object
+
+	LodFrameStats frame;
+	LodFrameStats lastFrame;
+	std::vector<LodFrameStats> history;
+};
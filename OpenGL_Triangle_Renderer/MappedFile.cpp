@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		Close();
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+		std::swap(isOpen, other.isOpen);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	size = static_cast<size_t>(fileSize.QuadPart);
+	isOpen = true;
+
+	// Zero-length files cannot be mapped; they are simply an empty view
+	if (size == 0)
+		return true;
+
+	mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != NULL)
+		data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (data == nullptr) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t bytes) const {
+	if (!data || offset >= size)
+		return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<char*>(data) + offset;
+	range.NumberOfBytes = std::min(bytes, size - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::Release(size_t offset, size_t bytes) const {
+	if (!data || offset >= size)
+		return;
+
+	// Unlocking pages that are not locked removes them from the working set
+	VirtualUnlock(const_cast<char*>(data) + offset, std::min(bytes, size - offset));
+}
+
+void MappedFile::Close() {
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+
+	data = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	size = 0;
+	isOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return false;
+	}
+
+	size = static_cast<size_t>(info.st_size);
+	isOpen = true;
+
+	// Zero-length files cannot be mapped; they are simply an empty view
+	if (size > 0) {
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			size = 0;
+			isOpen = false;
+			return false;
+		}
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(mapping);
+	}
+
+	// The mapping keeps the file contents alive; the descriptor is no longer needed
+	close(fd);
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t bytes) const {
+	if (!data || offset >= size)
+		return;
+
+	// madvise wants a page-aligned start
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t start = offset / page * page;
+	madvise(const_cast<char*>(data) + start, std::min(bytes + offset - start, size - start), MADV_WILLNEED);
+}
+
+void MappedFile::Release(size_t offset, size_t bytes) const {
+	if (!data || offset >= size)
+		return;
+
+	// Only whole pages inside the range: the partial pages at either end may still be in use
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t start = (offset + page - 1) / page * page;
+	const size_t stop = std::min(offset + bytes, size) / page * page;
+	if (stop > start)
+		madvise(const_cast<char*>(data) + start, stop - start, MADV_DONTNEED);
+}
+
+void MappedFile::Close() {
+	if (data)
+		munmap(const_cast<char*>(data), size);
+
+	data = nullptr;
+	size = 0;
+	isOpen = false;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// ===| Memory-Mapped File |====================================================================
+//
+// Read-only view of a whole file. The size is taken from the file system and the contents are
+// mapped rather than read, so callers can hand the bytes straight to GL without copying them.
+
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return isOpen; }
+	const char* Data() const { return data; }
+	size_t Size() const { return size; }
+	std::string_view View() const { return std::string_view(data, size); }
+
+	// Hints that bytes at offset are needed soon, so the OS can start reading them in
+	void Prefetch(size_t offset, size_t bytes) const;
+	// Hints that bytes at offset are done with, so their pages can leave the working set
+	void Release(size_t offset, size_t bytes) const;
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	bool isOpen = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,85 @@
+#include "MathUtil.h"
+
+#include <cmath>
+
+// ===| 4x4 Matrices |==========================================================================
+
+Mat4 Mat4::Identity() {
+	Mat4 result = {};
+	result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+	return result;
+}
+
+Mat4 Mat4::Perspective(float fovYRadians, float aspect, float zNear, float zFar) {
+	const float f = 1.0f / std::tan(fovYRadians * 0.5f);
+	Mat4 result = {};
+	result.m[0] = f / aspect;
+	result.m[5] = f;
+	result.m[10] = (zFar + zNear) / (zNear - zFar);
+	result.m[11] = -1.0f;
+	result.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+	return result;
+}
+
+static void normalize(float v[3]) {
+	const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0.0f) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+static void cross(const float a[3], const float b[3], float out[3]) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+Mat4 Mat4::LookAt(const float eye[3], const float target[3], const float up[3]) {
+	float forward[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+	normalize(forward);
+	float side[3];
+	cross(forward, up, side);
+	normalize(side);
+	float upward[3];
+	cross(side, forward, upward);
+
+	Mat4 result = Identity();
+	for (int i = 0; i < 3; ++i) {
+		result.m[i * 4 + 0] = side[i];
+		result.m[i * 4 + 1] = upward[i];
+		result.m[i * 4 + 2] = -forward[i];
+	}
+	result.m[12] = -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]);
+	result.m[13] = -(upward[0] * eye[0] + upward[1] * eye[1] + upward[2] * eye[2]);
+	result.m[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+	return result;
+}
+
+Mat4 Mat4::Camera2D(float centerX, float centerY, float zoom) {
+	Mat4 result = Identity();
+	result.m[0] = zoom;
+	result.m[5] = zoom;
+	result.m[12] = -centerX * zoom;
+	result.m[13] = -centerY * zoom;
+	return result;
+}
+
+Mat4 Mat4::operator*(const Mat4& other) const {
+	Mat4 result;
+	for (int column = 0; column < 4; ++column) {
+		for (int row = 0; row < 4; ++row) {
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k)
+				sum += m[k * 4 + row] * other.m[column * 4 + k];
+			result.m[column * 4 + row] = sum;
+		}
+	}
+	return result;
+}
+
+void Mat4::TransformPoint(const float point[3], float out[4]) const {
+	for (int row = 0; row < 4; ++row)
+		out[row] = m[row] * point[0] + m[4 + row] * point[1] + m[8 + row] * point[2] + m[12 + row];
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// ===| 4x4 Matrices |==========================================================================
+//
+// Column-major like GL: m[column * 4 + row], vectors are columns multiplied from the right.
+
+struct Mat4 {
+	float m[16];
+
+	static Mat4 Identity();
+	// GL-style projection: right-handed view space, clip z in [-w, w]
+	static Mat4 Perspective(float fovYRadians, float aspect, float zNear, float zFar);
+	static Mat4 LookAt(const float eye[3], const float target[3], const float up[3]);
+	// Uniform 2D zoom about (centerX, centerY); z is left untouched
+	static Mat4 Camera2D(float centerX, float centerY, float zoom);
+
+	Mat4 operator*(const Mat4& other) const;
+	// Transforms the point (x, y, z, 1); out receives x, y, z, w
+	void TransformPoint(const float point[3], float out[4]) const;
+};
@@ -0,0 +1,175 @@
+#include "Mesh.h"
+#include "StateCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// ===| CPU Mesh |==============================================================================
+
+VertexStreams Mesh::Streams() const {
+	VertexStreams streams;
+	streams.count = VertexCount();
+	streams.positions = positions.data();
+	streams.colors = colors.size() == positions.size() ? colors.data() : nullptr;
+	streams.texcoords = texcoords.size() * 3 == positions.size() * 2 ? texcoords.data() : nullptr;
+	return streams;
+}
+
+Mesh MakeTriangleMesh() {
+	Mesh mesh;
+	mesh.positions = {
+		// x     y     z  
+		-0.5f, -0.2f, 0.0f,
+		0.5f, -0.2f, 0.0f,
+		0.0f, 0.5f, 0.0f
+	};
+	mesh.colors = {
+		// r    g    b
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f
+	};
+	mesh.texcoords = {
+		// u    v
+		0.0f, 0.0f,
+		1.0f, 0.0f,
+		0.5f, 1.0f
+	};
+	mesh.indices = { 0, 1, 2 };
+	return mesh;
+}
+
+Mesh MakeGridMesh(int cells) {
+	cells = std::max(cells, 1);
+	const int side = cells + 1;
+
+	Mesh mesh;
+	mesh.positions.reserve(static_cast<size_t>(side) * side * 3);
+	mesh.colors.reserve(static_cast<size_t>(side) * side * 3);
+	mesh.texcoords.reserve(static_cast<size_t>(side) * side * 2);
+	for (int y = 0; y < side; ++y) {
+		for (int x = 0; x < side; ++x) {
+			const float u = static_cast<float>(x) / cells;
+			const float v = static_cast<float>(y) / cells;
+			mesh.positions.insert(mesh.positions.end(), { -0.9f + 1.8f * u, -0.9f + 1.8f * v, 0.0f });
+			mesh.colors.insert(mesh.colors.end(), { u, v, 1.0f - u });
+			mesh.texcoords.insert(mesh.texcoords.end(), { u, v });
+		}
+	}
+
+	mesh.indices.reserve(static_cast<size_t>(cells) * cells * 6);
+	for (int y = 0; y < cells; ++y) {
+		for (int x = 0; x < cells; ++x) {
+			const uint32_t i0 = y * side + x;
+			const uint32_t i1 = i0 + 1;
+			const uint32_t i2 = i0 + side;
+			const uint32_t i3 = i2 + 1;
+			mesh.indices.insert(mesh.indices.end(), { i0, i1, i3, i0, i3, i2 });
+		}
+	}
+	return mesh;
+}
+
+Mesh MakeFlowerMesh(int rings, int segments) {
+	rings = std::max(rings, 1);
+	segments = std::max(segments, 3);
+
+	Mesh mesh;
+	mesh.positions = { 0.0f, 0.0f, 0.0f };
+	mesh.colors = { 1.0f, 1.0f, 1.0f };
+	mesh.texcoords = { 0.5f, 0.5f };
+	for (int ring = 1; ring <= rings; ++ring) {
+		const float t = static_cast<float>(ring) / rings;
+		for (int s = 0; s < segments; ++s) {
+			const float angle = 6.2831853f * s / segments;
+			const float radius = 0.9f * t * (0.75f + 0.25f * std::sin(6.0f * angle));
+			mesh.positions.insert(mesh.positions.end(), { radius * std::cos(angle), radius * std::sin(angle), 0.0f });
+			mesh.colors.insert(mesh.colors.end(), {
+				1.0f - t * (0.5f - 0.5f * std::cos(angle)),
+				1.0f - t * (0.5f - 0.5f * std::cos(angle - 2.0943951f)),
+				1.0f - t * (0.5f - 0.5f * std::cos(angle + 2.0943951f)) });
+			// Planar mapping: the flower's [-0.9, 0.9]^2 square to [0, 1]^2, like the grid
+			mesh.texcoords.insert(mesh.texcoords.end(), { 0.5f + radius * std::cos(angle) / 1.8f, 0.5f + radius * std::sin(angle) / 1.8f });
+		}
+	}
+
+	// Center fan, then a band of quads between each pair of rings
+	for (int s = 0; s < segments; ++s) {
+		const uint32_t next = (s + 1) % segments;
+		mesh.indices.insert(mesh.indices.end(), { 0u, 1u + s, 1u + next });
+	}
+	for (int ring = 1; ring < rings; ++ring) {
+		const uint32_t inner = 1 + (ring - 1) * segments;
+		const uint32_t outer = inner + segments;
+		for (int s = 0; s < segments; ++s) {
+			const uint32_t next = (s + 1) % segments;
+			mesh.indices.insert(mesh.indices.end(), { inner + s, outer + s, outer + next, inner + s, outer + next, inner + next });
+		}
+	}
+	return mesh;
+}
+
+// ===| GPU Mesh |==============================================================================
+
+GLenum ChooseIndexType(size_t vertexCount) {
+	return vertexCount <= std::numeric_limits<uint16_t>::max() + size_t(1) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t IndexTypeSize(GLenum indexType) {
+	return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+GpuMesh UploadMesh(const Mesh& mesh, const VertexLayout& layout) {
+	return UploadMesh(mesh, mesh.indices, layout);
+}
+
+GpuMesh UploadMesh(const Mesh& mesh, const std::vector<uint32_t>& indices, const VertexLayout& layout) {
+	GpuMesh gpuMesh;
+	gpuMesh.indexCount = static_cast<GLsizei>(indices.size());
+	gpuMesh.indexType = ChooseIndexType(mesh.VertexCount());
+	gpuMesh.vertexCount = mesh.VertexCount();
+
+	const std::vector<unsigned char> vertices = PackVertices(layout, mesh.Streams());
+
+	glGenVertexArrays(1, &gpuMesh.VAO);
+	glState.BindVertexArray(gpuMesh.VAO);
+
+	glGenBuffers(1, &gpuMesh.VBO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+	layout.Apply();
+
+	// The element buffer binding is part of the VAO state
+	glGenBuffers(1, &gpuMesh.EBO);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+	if (gpuMesh.indexType == GL_UNSIGNED_SHORT) {
+		const std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	}
+
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return gpuMesh;
+}
+
+void DestroyGpuMesh(GpuMesh& gpuMesh) {
+	glState.OnVertexArrayDeleted(gpuMesh.VAO);
+	glState.OnBufferDeleted(gpuMesh.VBO);
+	glState.OnBufferDeleted(gpuMesh.EBO);
+	glDeleteVertexArrays(1, &gpuMesh.VAO);
+	glDeleteBuffers(1, &gpuMesh.VBO);
+	glDeleteBuffers(1, &gpuMesh.EBO);
+	gpuMesh = GpuMesh();
+}
+
+void DrawMesh(const GpuMesh& gpuMesh) {
+	glDrawElements(GL_TRIANGLES, gpuMesh.indexCount, gpuMesh.indexType, (void*)0);
+}
+
+void DrawMeshRange(const GpuMesh& gpuMesh, size_t firstIndex, GLsizei count) {
+	glDrawElements(GL_TRIANGLES, count, gpuMesh.indexType, (void*)(firstIndex * IndexTypeSize(gpuMesh.indexType)));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VertexLayout.h"
+
+// ===| CPU Mesh |==============================================================================
+
+struct Mesh {
+	std::vector<float> positions;    // x, y, z per vertex
+	std::vector<float> colors;       // r, g, b per vertex
+	std::vector<float> texcoords;    // u, v per vertex, optional
+	std::vector<uint32_t> indices;   // 3 per triangle
+
+	size_t VertexCount() const { return positions.size() / 3; }
+	size_t TriangleCount() const { return indices.size() / 3; }
+	VertexStreams Streams() const;
+};
+
+// The original hard-coded RGB triangle
+Mesh MakeTriangleMesh();
+// cells x cells quads over [-0.9, 0.9]^2 sharing their corner vertices
+Mesh MakeGridMesh(int cells);
+// A six-petal flower inside [-0.9, 0.9]^2: a polar grid whose curved outline gives the
+// simplifier real error to trade against
+Mesh MakeFlowerMesh(int rings, int segments);
+
+// ===| GPU Mesh |==============================================================================
+
+struct GpuMesh {
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	unsigned int EBO = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	size_t vertexCount = 0;
+};
+
+// 16-bit indices whenever every vertex is addressable with them: half the index bandwidth
+GLenum ChooseIndexType(size_t vertexCount);
+size_t IndexTypeSize(GLenum indexType);
+
+GpuMesh UploadMesh(const Mesh& mesh, const VertexLayout& layout);
+// Uploads indices in place of mesh.indices, e.g. every LOD level in one element buffer
+GpuMesh UploadMesh(const Mesh& mesh, const std::vector<uint32_t>& indices, const VertexLayout& layout);
+void DestroyGpuMesh(GpuMesh& gpuMesh);
+void DrawMesh(const GpuMesh& gpuMesh);
+// Draws count indices starting at firstIndex of the mesh's element buffer
+void DrawMeshRange(const GpuMesh& gpuMesh, size_t firstIndex, GLsizei count);
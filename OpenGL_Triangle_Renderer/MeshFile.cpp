@@ -0,0 +1,200 @@
+#include "MeshFile.h"
+#include "Mesh.h"
+#include "StateCache.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static const char MESH_FILE_MAGIC[4] = { 'T', 'M', 'S', 'H' };
+
+// Large enough to amortize the call, small enough that read-ahead keeps up with the copy
+static const size_t UPLOAD_CHUNK_BYTES = 64u << 20;
+
+static uint64_t alignUp(uint64_t value) {
+	return (value + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+// ===| Writing |===============================================================================
+
+bool WriteMeshFile(const std::string& path, const Mesh& mesh, const VertexLayout& layout) {
+	MeshFileHeader header = {};
+	std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version = MESH_FILE_VERSION;
+	header.attributeCount = static_cast<uint32_t>(layout.Attributes().size());
+	header.stride = layout.Stride();
+	header.indexType = ChooseIndexType(mesh.VertexCount());
+	header.vertexCount = mesh.VertexCount();
+	header.indexCount = mesh.indices.size();
+
+	const uint64_t descriptorEnd = sizeof(MeshFileHeader) + header.attributeCount * sizeof(MeshFileAttribute);
+	header.vertexOffset = alignUp(descriptorEnd);
+	header.indexOffset = alignUp(header.vertexOffset + header.vertexCount * header.stride);
+
+	for (int axis = 0; axis < 3; ++axis) {
+		header.boundsMin[axis] = mesh.VertexCount() ? mesh.positions[axis] : 0.0f;
+		header.boundsMax[axis] = header.boundsMin[axis];
+	}
+	for (size_t i = 0; i < mesh.positions.size(); ++i) {
+		header.boundsMin[i % 3] = std::min(header.boundsMin[i % 3], mesh.positions[i]);
+		header.boundsMax[i % 3] = std::max(header.boundsMax[i % 3], mesh.positions[i]);
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "ERROR::MESH_FILE::CANNOT_WRITE " << path << "\n";
+		return false;
+	}
+
+	const std::vector<unsigned char> vertices = PackVertices(layout, mesh.Streams());
+	const char padding[MESH_FILE_ALIGNMENT] = {};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const VertexAttribute& attribute : layout.Attributes()) {
+		const MeshFileAttribute descriptor = { attribute.location, static_cast<uint32_t>(attribute.format), attribute.offset };
+		out.write(reinterpret_cast<const char*>(&descriptor), sizeof(descriptor));
+	}
+	out.write(padding, static_cast<std::streamsize>(header.vertexOffset - descriptorEnd));
+	out.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size()));
+	out.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - vertices.size()));
+	if (header.indexType == GL_UNSIGNED_SHORT) {
+		const std::vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.end());
+		out.write(reinterpret_cast<const char*>(shortIndices.data()), static_cast<std::streamsize>(shortIndices.size() * sizeof(uint16_t)));
+	}
+	else {
+		out.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
+	}
+
+	if (!out) {
+		std::cout << "ERROR::MESH_FILE::CANNOT_WRITE " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+// ===| Reading |===============================================================================
+
+template <class Index>
+static bool indicesInRange(const char* data, uint64_t count, uint64_t vertexCount) {
+	Index largest = 0;
+	for (uint64_t i = 0; i < count; ++i) {
+		Index index;
+		std::memcpy(&index, data + i * sizeof(Index), sizeof(Index));
+		largest = std::max(largest, index);
+	}
+	return count == 0 || largest < vertexCount;
+}
+
+// The per-vertex locations a mesh file may describe; instance attributes come from elsewhere
+static bool isVertexLocation(uint32_t location) {
+	return location == ATTRIB_POSITION || location == ATTRIB_COLOR || location == ATTRIB_TEXCOORD;
+}
+
+bool MeshFile::Open(const std::string& path) {
+	layout = VertexLayout();
+	if (!file.Open(path)) {
+		std::cout << "ERROR::MESH_FILE::CANNOT_OPEN " << path << "\n";
+		return false;
+	}
+
+	auto reject = [&](const char* reason) {
+		std::cout << "ERROR::MESH_FILE::" << reason << " " << path << "\n";
+		file.Close();
+		return false;
+	};
+
+	if (file.Size() < sizeof(MeshFileHeader))
+		return reject("TRUNCATED");
+	const MeshFileHeader& header = Header();
+	if (std::memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) != 0)
+		return reject("NOT_A_MESH_FILE");
+	if (header.version != MESH_FILE_VERSION)
+		return reject("UNSUPPORTED_VERSION");
+	if (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+		return reject("BAD_INDEX_TYPE");
+
+	const uint64_t descriptorEnd = sizeof(MeshFileHeader) + static_cast<uint64_t>(header.attributeCount) * sizeof(MeshFileAttribute);
+	if (descriptorEnd > file.Size())
+		return reject("TRUNCATED");
+
+	// Rebuild the layout and make sure it lays vertices out the way the file says
+	const MeshFileAttribute* descriptors = reinterpret_cast<const MeshFileAttribute*>(file.Data() + sizeof(MeshFileHeader));
+	bool hasPosition = false;
+	for (uint32_t i = 0; i < header.attributeCount; ++i) {
+		if (!isVertexLocation(descriptors[i].location))
+			return reject("BAD_ATTRIBUTE_LOCATION");
+		for (uint32_t j = 0; j < i; ++j) {
+			if (descriptors[j].location == descriptors[i].location)
+				return reject("BAD_ATTRIBUTE_LOCATION");
+		}
+		hasPosition |= descriptors[i].location == ATTRIB_POSITION;
+		if (descriptors[i].format > static_cast<uint32_t>(AttribFormat::Half2))
+			return reject("BAD_ATTRIBUTE_FORMAT");
+		layout.Add(descriptors[i].location, static_cast<AttribFormat>(descriptors[i].format));
+		if (layout.Attributes().back().offset != descriptors[i].offset)
+			return reject("BAD_ATTRIBUTE_OFFSET");
+	}
+	if (!hasPosition)
+		return reject("NO_POSITION");
+	if (header.stride == 0 || layout.Stride() != header.stride)
+		return reject("BAD_STRIDE");
+	// Draw calls take the index count as a GLsizei
+	if (header.indexCount > static_cast<uint64_t>(INT_MAX))
+		return reject("TOO_MANY_INDICES");
+
+	// Ranges are checked without overflow: counts come from the file and cannot be trusted
+	const uint64_t size = file.Size();
+	if (header.vertexOffset > size || header.indexOffset > size
+		|| header.vertexCount > (size - header.vertexOffset) / header.stride
+		|| header.indexCount > (size - header.indexOffset) / IndexTypeBytes())
+		return reject("TRUNCATED");
+
+	// The indices go to the GPU as they are, so one past the vertices would read out of bounds.
+	// One sequential pass over the mapping, far cheaper than the upload that follows.
+	if (header.indexType == GL_UNSIGNED_SHORT ? !indicesInRange<uint16_t>(file.Data() + header.indexOffset, header.indexCount, header.vertexCount)
+		: !indicesInRange<uint32_t>(file.Data() + header.indexOffset, header.indexCount, header.vertexCount))
+		return reject("INDEX_OUT_OF_RANGE");
+	return true;
+}
+
+// ===| Upload |================================================================================
+
+static void uploadChunked(GLenum target, const MappedFile& file, const char* data, size_t bytes) {
+	glBufferData(target, bytes, bytes <= UPLOAD_CHUNK_BYTES ? data : NULL, GL_STATIC_DRAW);
+	if (bytes <= UPLOAD_CHUNK_BYTES)
+		return;
+
+	for (size_t offset = 0; offset < bytes; offset += UPLOAD_CHUNK_BYTES) {
+		const size_t chunk = std::min(UPLOAD_CHUNK_BYTES, bytes - offset);
+		if (offset + chunk < bytes)
+			file.Prefetch(static_cast<size_t>(data - file.Data()) + offset + chunk, std::min(UPLOAD_CHUNK_BYTES, bytes - offset - chunk));
+		glBufferSubData(target, offset, chunk, data + offset);
+	}
+}
+
+GpuMesh UploadMeshFile(const MeshFile& meshFile) {
+	const MeshFileHeader& header = meshFile.Header();
+
+	GpuMesh gpuMesh;
+	gpuMesh.indexCount = static_cast<GLsizei>(header.indexCount);   // at most INT_MAX, see Open()
+	gpuMesh.indexType = header.indexType;
+	gpuMesh.vertexCount = static_cast<size_t>(header.vertexCount);
+
+	glGenVertexArrays(1, &gpuMesh.VAO);
+	glState.BindVertexArray(gpuMesh.VAO);
+
+	glGenBuffers(1, &gpuMesh.VBO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+	uploadChunked(GL_ARRAY_BUFFER, meshFile.Mapping(), static_cast<const char*>(meshFile.Vertices()), meshFile.VertexBytes());
+	meshFile.Layout().Apply();
+
+	glGenBuffers(1, &gpuMesh.EBO);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+	uploadChunked(GL_ELEMENT_ARRAY_BUFFER, meshFile.Mapping(), static_cast<const char*>(meshFile.Indices()), meshFile.IndexBytes());
+
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return gpuMesh;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "VertexLayout.h"
+
+struct GpuMesh;
+struct Mesh;
+
+// ===| Binary Mesh File |======================================================================
+//
+// Vertices and indices stored exactly as the GPU takes them, so loading is a mapping and a
+// buffer upload with nothing parsed or converted in between:
+//
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]   the VertexLayout the vertices were packed with
+//   vertex blob                         vertexCount * stride bytes, at vertexOffset
+//   index blob                          indexCount 16/32-bit indices, at indexOffset
+//
+// Blobs start on MESH_FILE_ALIGNMENT boundaries so they begin on a page of the mapping. All
+// fields are little-endian. A file with another magic or version is rejected, never guessed at.
+
+static const uint32_t MESH_FILE_VERSION = 1;
+static const uint64_t MESH_FILE_ALIGNMENT = 4096;
+
+struct MeshFileHeader {
+	char magic[4];            // "TMSH"
+	uint32_t version;
+	uint32_t attributeCount;
+	uint32_t stride;
+	uint32_t indexType;       // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t reserved;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct MeshFileAttribute {
+	uint32_t location;
+	uint32_t format;          // AttribFormat
+	uint32_t offset;
+};
+
+// Packs mesh with layout and writes it to path
+bool WriteMeshFile(const std::string& path, const Mesh& mesh, const VertexLayout& layout);
+
+class MeshFile {
+public:
+	// Maps the file and validates header, layout (a position, known vertex locations, a stride)
+	// and blob ranges against its size, and every index against the vertex count
+	bool Open(const std::string& path);
+	void Close() { file.Close(); }
+
+	const MeshFileHeader& Header() const { return *reinterpret_cast<const MeshFileHeader*>(file.Data()); }
+	const VertexLayout& Layout() const { return layout; }
+	const void* Vertices() const { return file.Data() + Header().vertexOffset; }
+	const void* Indices() const { return file.Data() + Header().indexOffset; }
+	size_t VertexBytes() const { return static_cast<size_t>(Header().vertexCount) * Header().stride; }
+	size_t IndexBytes() const { return static_cast<size_t>(Header().indexCount) * IndexTypeBytes(); }
+	size_t FileBytes() const { return file.Size(); }
+	const MappedFile& Mapping() const { return file; }
+
+private:
+	size_t IndexTypeBytes() const { return Header().indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+	MappedFile file;
+	VertexLayout layout;
+};
+
+// Creates the GL buffers straight from the mapping, in chunks so the pages of the next chunk are
+// being read ahead while the driver copies the current one
+GpuMesh UploadMeshFile(const MeshFile& file);
@@ -0,0 +1,333 @@
+#include "MeshImport.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+// ===| Text Parsing |==========================================================================
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static std::string_view nextToken(std::string_view& line) {
+	size_t start = 0;
+	while (start < line.size() && isSpace(line[start]))
+		++start;
+	size_t end = start;
+	while (end < line.size() && !isSpace(line[end]))
+		++end;
+	const std::string_view token = line.substr(start, end - start);
+	line.remove_prefix(end);
+	return token;
+}
+
+static std::string_view nextLine(std::string_view& text) {
+	const size_t end = text.find('\n');
+	const std::string_view line = text.substr(0, end);
+	text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+	return line;
+}
+
+static float toFloat(std::string_view token) {
+	// strtof needs a terminator; tokens are short, so a stack copy is cheap
+	char buffer[64];
+	const size_t length = std::min(token.size(), sizeof(buffer) - 1);
+	std::memcpy(buffer, token.data(), length);
+	buffer[length] = '\0';
+	return std::strtof(buffer, nullptr);
+}
+
+static long toInt(std::string_view token) {
+	char buffer[32];
+	const size_t length = std::min(token.size(), sizeof(buffer) - 1);
+	std::memcpy(buffer, token.data(), length);
+	buffer[length] = '\0';
+	return std::strtol(buffer, nullptr, 10);
+}
+
+// ===| OBJ |===================================================================================
+
+bool LoadObj(const std::string& path, Mesh& mesh) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << "\n";
+		return false;
+	}
+
+	mesh = Mesh();
+	std::vector<uint32_t> polygon;
+	std::string_view text = file.View();
+	while (!text.empty()) {
+		std::string_view line = nextLine(text);
+		const std::string_view keyword = nextToken(line);
+
+		if (keyword == "v") {
+			for (int k = 0; k < 3; ++k)
+				mesh.positions.push_back(toFloat(nextToken(line)));
+			const std::string_view r = nextToken(line);
+			mesh.colors.push_back(r.empty() ? 1.0f : toFloat(r));
+			mesh.colors.push_back(r.empty() ? 1.0f : toFloat(nextToken(line)));
+			mesh.colors.push_back(r.empty() ? 1.0f : toFloat(nextToken(line)));
+		}
+		else if (keyword == "f") {
+			// v, v/vt, v//vn or v/vt/vn; negative indices count back from the last vertex
+			polygon.clear();
+			const long vertexCount = static_cast<long>(mesh.VertexCount());
+			for (std::string_view corner = nextToken(line); !corner.empty(); corner = nextToken(line)) {
+				long index = toInt(corner.substr(0, corner.find('/')));
+				index = index < 0 ? vertexCount + index : index - 1;
+				if (index < 0 || index >= vertexCount) {
+					std::cout << "ERROR::MESH_IMPORT::OBJ_INDEX_OUT_OF_RANGE " << path << "\n";
+					return false;
+				}
+				polygon.push_back(static_cast<uint32_t>(index));
+			}
+			for (size_t i = 2; i < polygon.size(); ++i)
+				mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+		}
+	}
+
+	return true;
+}
+
+// ===| PLY |===================================================================================
+
+namespace {
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+struct PlyProperty {
+	std::string name;
+	PlyType type = PlyType::Invalid;
+	PlyType countType = PlyType::Invalid;   // set for list properties
+};
+
+struct PlyElement {
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+};
+
+PlyType plyType(std::string_view name) {
+	if (name == "char" || name == "int8") return PlyType::Int8;
+	if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+	if (name == "short" || name == "int16") return PlyType::Int16;
+	if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+	if (name == "int" || name == "int32") return PlyType::Int32;
+	if (name == "uint" || name == "uint32") return PlyType::UInt32;
+	if (name == "float" || name == "float32") return PlyType::Float32;
+	if (name == "double" || name == "float64") return PlyType::Float64;
+	return PlyType::Invalid;
+}
+
+size_t plyTypeSize(PlyType type) {
+	switch (type) {
+	case PlyType::Int8: case PlyType::UInt8: return 1;
+	case PlyType::Int16: case PlyType::UInt16: return 2;
+	case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+	case PlyType::Float64: return 8;
+	default: return 0;
+	}
+}
+
+// Reads one value of type from a binary little-endian stream or an ascii line
+class PlyReader {
+public:
+	PlyReader(std::string_view body, bool binary) : body(body), binary(binary) {}
+
+	bool Failed() const { return failed; }
+
+	double Read(PlyType type) {
+		if (!binary) {
+			if (line.empty())
+				line = nextLine(body);
+			const std::string_view token = nextToken(line);
+			if (token.empty()) {
+				failed = true;
+				return 0.0;
+			}
+			return toFloat(token);
+		}
+
+		const size_t size = plyTypeSize(type);
+		if (body.size() < size) {
+			failed = true;
+			return 0.0;
+		}
+		const char* p = body.data();
+		body.remove_prefix(size);
+		switch (type) {
+		case PlyType::Int8: return static_cast<int8_t>(*p);
+		case PlyType::UInt8: return static_cast<uint8_t>(*p);
+		case PlyType::Int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+		case PlyType::UInt16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+		case PlyType::Int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+		case PlyType::UInt32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+		case PlyType::Float32: { float v; std::memcpy(&v, p, 4); return v; }
+		case PlyType::Float64: { double v; std::memcpy(&v, p, 8); return v; }
+		default: failed = true; return 0.0;
+		}
+	}
+
+	// Ascii elements end at the end of their line
+	void EndElement() { line = std::string_view(); }
+
+	// The fewest body bytes one instance of element can take: its binary size, or in ascii one
+	// character per value
+	size_t MinElementBytes(const PlyElement& element) const {
+		size_t bytes = 0;
+		for (const PlyProperty& property : element.properties)
+			bytes += binary ? plyTypeSize(property.countType != PlyType::Invalid ? property.countType : property.type) : 1;
+		return std::max<size_t>(bytes, 1);
+	}
+	size_t Remaining() const { return body.size() + line.size(); }
+
+private:
+	std::string_view body;
+	std::string_view line;
+	bool binary;
+	bool failed = false;
+};
+
+}
+
+bool LoadPly(const std::string& path, Mesh& mesh) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << "\n";
+		return false;
+	}
+
+	std::string_view text = file.View();
+	std::string_view magic = nextLine(text);
+	if (nextToken(magic) != "ply") {
+		std::cout << "ERROR::MESH_IMPORT::NOT_A_PLY_FILE " << path << "\n";
+		return false;
+	}
+
+	std::vector<PlyElement> elements;
+	bool binary = false;
+	bool headerDone = false;
+	while (!text.empty() && !headerDone) {
+		std::string_view line = nextLine(text);
+		const std::string_view keyword = nextToken(line);
+		if (keyword == "format") {
+			const std::string_view format = nextToken(line);
+			if (format != "ascii" && format != "binary_little_endian") {
+				std::cout << "ERROR::MESH_IMPORT::UNSUPPORTED_PLY_FORMAT " << format << "\n";
+				return false;
+			}
+			binary = format == "binary_little_endian";
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			element.name = std::string(nextToken(line));
+			element.count = static_cast<size_t>(toInt(nextToken(line)));
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			PlyProperty property;
+			std::string_view type = nextToken(line);
+			if (type == "list") {
+				property.countType = plyType(nextToken(line));
+				type = nextToken(line);
+			}
+			property.type = plyType(type);
+			property.name = std::string(nextToken(line));
+			if (property.type == PlyType::Invalid) {
+				std::cout << "ERROR::MESH_IMPORT::UNSUPPORTED_PLY_PROPERTY " << property.name << "\n";
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			headerDone = true;
+		}
+	}
+	if (!headerDone) {
+		std::cout << "ERROR::MESH_IMPORT::PLY_HEADER_INCOMPLETE " << path << "\n";
+		return false;
+	}
+
+	mesh = Mesh();
+	std::vector<uint32_t> polygon;
+	PlyReader reader(text, binary);
+	for (const PlyElement& element : elements) {
+		const bool isVertex = element.name == "vertex";
+		const bool isFace = element.name == "face";
+		// The count comes straight from the header: bound it by what the body can hold before
+		// allocating for it
+		if (element.count > reader.Remaining() / reader.MinElementBytes(element)) {
+			std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << "\n";
+			return false;
+		}
+		if (isVertex) {
+			mesh.positions.reserve(element.count * 3);
+			mesh.colors.assign(element.count * 3, 1.0f);
+		}
+
+		for (size_t i = 0; i < element.count && !reader.Failed(); ++i) {
+			for (const PlyProperty& property : element.properties) {
+				if (property.countType != PlyType::Invalid) {
+					const size_t count = static_cast<size_t>(reader.Read(property.countType));
+					polygon.clear();
+					for (size_t k = 0; k < count && !reader.Failed(); ++k)
+						polygon.push_back(static_cast<uint32_t>(reader.Read(property.type)));
+					if (isFace && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+						for (size_t k = 2; k < polygon.size(); ++k)
+							mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[k - 1], polygon[k] });
+					}
+					continue;
+				}
+
+				const double value = reader.Read(property.type);
+				if (!isVertex)
+					continue;
+				if (property.name == "x" || property.name == "y" || property.name == "z") {
+					mesh.positions.push_back(static_cast<float>(value));
+				}
+				else if (property.name == "red" || property.name == "green" || property.name == "blue") {
+					// Integer colors are 0-255, float ones already 0-1
+					const float scale = property.type == PlyType::Float32 || property.type == PlyType::Float64 ? 1.0f : 1.0f / 255.0f;
+					const int channel = property.name == "red" ? 0 : property.name == "green" ? 1 : 2;
+					mesh.colors[i * 3 + channel] = static_cast<float>(value) * scale;
+				}
+			}
+			reader.EndElement();
+		}
+	}
+
+	if (reader.Failed() || mesh.positions.size() != mesh.colors.size()) {
+		std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << "\n";
+		return false;
+	}
+	const size_t vertexCount = mesh.VertexCount();
+	if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t index) { return index >= vertexCount; })) {
+		std::cout << "ERROR::MESH_IMPORT::PLY_INDEX_OUT_OF_RANGE " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+// ===| Dispatch |==============================================================================
+
+bool LoadMeshSource(const std::string& path, Mesh& mesh) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension == ".obj")
+		return LoadObj(path, mesh);
+	if (extension == ".ply")
+		return LoadPly(path, mesh);
+
+	std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT " << path << " (expected .obj or .ply)\n";
+	return false;
+}
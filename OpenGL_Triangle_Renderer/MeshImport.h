@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+struct Mesh;
+
+// ===| Mesh Import |===========================================================================
+//
+// Reads authored meshes into a Mesh: Wavefront OBJ (positions, optional per-vertex colors after
+// them, polygons fanned into triangles) and PLY (ascii or binary_little_endian, vertex x/y/z
+// with optional red/green/blue, faces as index lists). Texture coordinates and normals in the
+// source are skipped. Missing colors come out white.
+
+bool LoadObj(const std::string& path, Mesh& mesh);
+bool LoadPly(const std::string& path, Mesh& mesh);
+
+// Picks the loader from the file extension
+bool LoadMeshSource(const std::string& path, Mesh& mesh);
@@ -0,0 +1,209 @@
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ===| Vertex Cache Statistics |===============================================================
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize) {
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	// FIFO: a hit does not refresh the entry, the oldest entry is evicted on a miss.
+	// cacheTimestamp[v] is the miss counter value when v entered the cache.
+	std::vector<size_t> cacheTimestamp(vertexCount, 0);
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		if (cacheTimestamp[index] == 0 || misses - cacheTimestamp[index] >= cacheSize) {
+			++misses;
+			cacheTimestamp[index] = misses;
+		}
+	}
+
+	stats.transformed = misses;
+	stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+	stats.atvr = static_cast<double>(misses) / vertexCount;
+	return stats;
+}
+
+// ===| Forsyth Vertex Cache Optimization |=====================================================
+
+namespace {
+
+const int CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+const unsigned int VALENCE_TABLE_SIZE = 32;
+
+// Both score terms are precomputed: pow() per vertex update dominates the runtime otherwise
+struct ScoreTables {
+	float cache[CACHE_SIZE];
+	float valence[VALENCE_TABLE_SIZE];
+
+	ScoreTables() {
+		for (int i = 0; i < CACHE_SIZE; ++i) {
+			if (i < 3) {
+				// Used by the triangle just emitted: fixed score so the next one is not biased
+				cache[i] = LAST_TRIANGLE_SCORE;
+			}
+			else {
+				const float scaler = 1.0f / (CACHE_SIZE - 3);
+				cache[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+		valence[0] = 0.0f;
+		for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; ++i)
+			valence[i] = valenceBoost(i);
+	}
+
+	static float valenceBoost(unsigned int liveTriangles) {
+		// Favor vertices with few triangles left, so they get finished and leave the working set
+		return VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTriangles), -VALENCE_BOOST_POWER);
+	}
+};
+
+const ScoreTables scoreTables;
+
+float vertexScore(int cachePosition, unsigned int liveTriangles) {
+	if (liveTriangles == 0)
+		return -1.0f;    // no triangle left to help
+
+	float score = cachePosition >= 0 ? scoreTables.cache[cachePosition] : 0.0f;
+	score += liveTriangles < VALENCE_TABLE_SIZE ? scoreTables.valence[liveTriangles] : ScoreTables::valenceBoost(liveTriangles);
+	return score;
+}
+
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency (CSR layout)
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (uint32_t index : indices)
+		++liveTriangles[index];
+
+	std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		for (int k = 0; k < 3; ++k)
+			adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+	}
+
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		score[v] = vertexScore(-1, liveTriangles[v]);
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	size_t bestTriangle = 0;
+	size_t scanCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+		// No candidate from the cache: take the next unemitted triangle in input order
+		if (bestTriangle == triangleCount || emitted[bestTriangle]) {
+			while (emitted[scanCursor])
+				++scanCursor;
+			bestTriangle = scanCursor;
+		}
+
+		const uint32_t* tri = &indices[bestTriangle * 3];
+		output.insert(output.end(), tri, tri + 3);
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from its vertices' live lists
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t v = tri[k];
+			uint32_t* begin = &adjacency[adjacencyOffset[v]];
+			uint32_t* end = begin + liveTriangles[v];
+			uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			std::swap(*found, *(end - 1));
+			--liveTriangles[v];
+		}
+
+		// New cache: the triangle's vertices first, then the previous contents minus duplicates
+		newCache.assign(tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache.push_back(v);
+		}
+
+		// Vertices pushed past the end drop out of the cache
+		for (size_t i = CACHE_SIZE; i < newCache.size(); ++i)
+			score[newCache[i]] = vertexScore(-1, liveTriangles[newCache[i]]);
+		if (newCache.size() > CACHE_SIZE)
+			newCache.resize(CACHE_SIZE);
+		cache.swap(newCache);
+
+		for (size_t i = 0; i < cache.size(); ++i)
+			score[cache[i]] = vertexScore(static_cast<int>(i), liveTriangles[cache[i]]);
+
+		// Rescore the live triangles touching the cache and pick the best one
+		bestTriangle = triangleCount;
+		float bestScore = -1.0f;
+		for (uint32_t v : cache) {
+			const uint32_t* begin = &adjacency[adjacencyOffset[v]];
+			for (unsigned int i = 0; i < liveTriangles[v]; ++i) {
+				const uint32_t t = begin[i];
+				const float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				if (s > bestScore) {
+					bestScore = s;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+// ===| Vertex Fetch Optimization |=============================================================
+
+template <typename T>
+static void remapStream(std::vector<T>& stream, const std::vector<uint32_t>& remap, size_t components) {
+	if (stream.empty())
+		return;
+	std::vector<T> reordered(stream.size());
+	for (size_t v = 0; v < remap.size(); ++v)
+		std::copy_n(&stream[v * components], components, &reordered[remap[v] * components]);
+	stream.swap(reordered);
+}
+
+void OptimizeVertexFetch(Mesh& mesh) {
+	const size_t vertexCount = mesh.VertexCount();
+	const uint32_t unassigned = ~0u;
+
+	std::vector<uint32_t> remap(vertexCount, unassigned);
+	uint32_t next = 0;
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == unassigned)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	for (uint32_t& target : remap) {
+		if (target == unassigned)
+			target = next++;
+	}
+
+	remapStream(mesh.positions, remap, 3);
+	remapStream(mesh.colors, remap, 3);
+	remapStream(mesh.texcoords, remap, 2);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Mesh;
+
+// ===| Vertex Cache Statistics |===============================================================
+//
+// CPU simulation of a FIFO post-transform cache, so index order can be judged without a GPU.
+//   ACMR: vertices transformed per triangle (ideal ~0.5 for regular grids, worst 3.0)
+//   ATVR: vertices transformed per unique vertex (ideal 1.0)
+
+struct VertexCacheStats {
+	size_t transformed = 0;
+	double acmr = 0.0;
+	double atvr = 0.0;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// ===| Optimization Passes |===================================================================
+
+// Reorders triangles for post-transform cache reuse (Tom Forsyth's linear-speed algorithm)
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Reorders vertices into first-use order of the index buffer for linear fetches. Vertices no
+// triangle references are moved to the end. Run after OptimizeVertexCache.
+void OptimizeVertexFetch(Mesh& mesh);
@@ -0,0 +1,238 @@
+#include "MeshSimplifier.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+// ===| Quadrics |==============================================================================
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle: a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+struct Quadric {
+	double a[10] = {};
+
+	void AddPlane(double nx, double ny, double nz, double d, double weight) {
+		const double p[4] = { nx, ny, nz, d };
+		int k = 0;
+		for (int i = 0; i < 4; ++i) {
+			for (int j = i; j < 4; ++j)
+				a[k++] += weight * p[i] * p[j];
+		}
+	}
+
+	Quadric& operator+=(const Quadric& other) {
+		for (int k = 0; k < 10; ++k)
+			a[k] += other.a[k];
+		return *this;
+	}
+
+	// Sum of squared distances of p to the accumulated planes
+	double Evaluate(const float* p) const {
+		const double x = p[0], y = p[1], z = p[2];
+		return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+			+ a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+			+ a[7] * z * z + 2.0 * a[8] * z
+			+ a[9];
+	}
+};
+
+struct Collapse {
+	double cost;
+	uint32_t from;
+	uint32_t to;
+	uint32_t fromVersion;
+	uint32_t toVersion;
+
+	bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+void triangleNormal(const float* a, const float* b, const float* c, double n[3]) {
+	const double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+}
+
+// ===| Simplification |========================================================================
+
+SimplifyResult SimplifyMesh(const Mesh& mesh, size_t targetTriangles, float maxError) {
+	const size_t vertexCount = mesh.VertexCount();
+	const size_t triangleCount = mesh.TriangleCount();
+	const float* positions = mesh.positions.data();
+
+	std::vector<uint32_t> triangles = mesh.indices;
+	std::vector<bool> triangleAlive(triangleCount, true);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	std::vector<Quadric> quadrics(vertexCount);
+
+	// Plane quadrics of every triangle, shared by its corners
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const uint32_t* tri = &triangles[t * 3];
+		double n[3];
+		triangleNormal(positions + tri[0] * 3, positions + tri[1] * 3, positions + tri[2] * 3, n);
+		const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int k = 0; k < 3; ++k)
+			vertexTriangles[tri[k]].push_back(static_cast<uint32_t>(t));
+		if (length == 0.0)
+			continue;
+
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		const float* p = positions + tri[0] * 3;
+		const double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+		for (int k = 0; k < 3; ++k)
+			quadrics[tri[k]].AddPlane(n[0], n[1], n[2], d, 1.0);
+	}
+
+	// Boundary edges (used by one triangle) get a plane through the edge, perpendicular to the
+	// triangle, weighted so that moving the outline costs more than moving the interior
+	const double boundaryWeight = 10.0;
+	std::vector<uint64_t> edges;
+	edges.reserve(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t a = triangles[t * 3 + k];
+			const uint32_t b = triangles[t * 3 + (k + 1) % 3];
+			edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+		}
+	}
+	std::vector<uint64_t> sortedEdges = edges;
+	std::sort(sortedEdges.begin(), sortedEdges.end());
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const uint32_t* tri = &triangles[t * 3];
+		double n[3];
+		triangleNormal(positions + tri[0] * 3, positions + tri[1] * 3, positions + tri[2] * 3, n);
+
+		for (int k = 0; k < 3; ++k) {
+			const uint64_t key = edges[t * 3 + k];
+			const auto range = std::equal_range(sortedEdges.begin(), sortedEdges.end(), key);
+			if (range.second - range.first != 1)
+				continue;
+
+			const float* pa = positions + tri[k] * 3;
+			const float* pb = positions + tri[(k + 1) % 3] * 3;
+			const double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+			double side[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+			const double length = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+			if (length == 0.0)
+				continue;
+			side[0] /= length; side[1] /= length; side[2] /= length;
+			const double d = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+			quadrics[tri[k]].AddPlane(side[0], side[1], side[2], d, boundaryWeight);
+			quadrics[tri[(k + 1) % 3]].AddPlane(side[0], side[1], side[2], d, boundaryWeight);
+		}
+	}
+
+	// Candidate collapses in both directions of every edge; entries go stale when an endpoint
+	// changes and are skipped when popped
+	std::vector<uint32_t> version(vertexCount, 0);
+	std::vector<bool> vertexAlive(vertexCount, true);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+	auto pushCollapse = [&](uint32_t from, uint32_t to) {
+		Quadric combined = quadrics[from];
+		combined += quadrics[to];
+		heap.push({ std::max(combined.Evaluate(positions + to * 3), 0.0), from, to, version[from], version[to] });
+	};
+	for (uint64_t key : sortedEdges) {
+		const uint32_t a = static_cast<uint32_t>(key >> 32);
+		const uint32_t b = static_cast<uint32_t>(key);
+		pushCollapse(a, b);
+		pushCollapse(b, a);
+	}
+
+	// A collapse must not flip any triangle that survives it
+	auto flips = [&](uint32_t from, uint32_t to) {
+		for (uint32_t t : vertexTriangles[from]) {
+			if (!triangleAlive[t])
+				continue;
+			const uint32_t* tri = &triangles[t * 3];
+			if (tri[0] == to || tri[1] == to || tri[2] == to)
+				continue;
+
+			const float* corners[3];
+			const float* moved[3];
+			for (int k = 0; k < 3; ++k) {
+				corners[k] = positions + tri[k] * 3;
+				moved[k] = tri[k] == from ? positions + to * 3 : corners[k];
+			}
+			double before[3], after[3];
+			triangleNormal(corners[0], corners[1], corners[2], before);
+			triangleNormal(moved[0], moved[1], moved[2], after);
+			const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+			if (dot <= 0.0)
+				return true;
+		}
+		return false;
+	};
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	size_t liveTriangles = triangleCount;
+	double worstCost = 0.0;
+	std::vector<uint32_t> neighbors;
+
+	while (liveTriangles > targetTriangles && !heap.empty()) {
+		const Collapse collapse = heap.top();
+		heap.pop();
+		if (!vertexAlive[collapse.from] || !vertexAlive[collapse.to]
+			|| version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion)
+			continue;
+		if (collapse.cost > maxCost)
+			break;
+		if (flips(collapse.from, collapse.to))
+			continue;
+
+		// Move the triangles of from onto to; the ones sharing the edge disappear
+		for (uint32_t t : vertexTriangles[collapse.from]) {
+			if (!triangleAlive[t])
+				continue;
+			uint32_t* tri = &triangles[t * 3];
+			if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+				triangleAlive[t] = false;
+				--liveTriangles;
+				continue;
+			}
+			for (int k = 0; k < 3; ++k) {
+				if (tri[k] == collapse.from)
+					tri[k] = collapse.to;
+			}
+			vertexTriangles[collapse.to].push_back(t);
+		}
+		vertexTriangles[collapse.from].clear();
+		vertexAlive[collapse.from] = false;
+		quadrics[collapse.to] += quadrics[collapse.from];
+		++version[collapse.to];
+		worstCost = std::max(worstCost, collapse.cost);
+
+		// Only to's quadric changed: its version bump already invalidated the edges touching it,
+		// so queue them again with their new costs. Dead triangles leave its list on the way.
+		std::vector<uint32_t>& around = vertexTriangles[collapse.to];
+		around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return !triangleAlive[t]; }), around.end());
+		neighbors.clear();
+		for (uint32_t t : around) {
+			for (int k = 0; k < 3; ++k) {
+				if (triangles[t * 3 + k] != collapse.to)
+					neighbors.push_back(triangles[t * 3 + k]);
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+		for (uint32_t other : neighbors) {
+			pushCollapse(collapse.to, other);
+			pushCollapse(other, collapse.to);
+		}
+	}
+
+	SimplifyResult result;
+	result.indices.reserve(liveTriangles * 3);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		if (triangleAlive[t])
+			result.indices.insert(result.indices.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+	}
+	result.error = static_cast<float>(std::sqrt(worstCost));
+	return result;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Mesh;
+
+// ===| Quadric Error Simplification |==========================================================
+//
+// Garland-Heckbert edge collapse: every vertex carries the quadric of the planes of its
+// triangles (plus planes perpendicular to boundary edges, so outlines hold their shape), and
+// the cheapest edge is collapsed onto one of its endpoints until the target is met.
+// Only the index buffer changes: simplified levels reference the original vertices, so every
+// level can share one vertex buffer.
+
+struct SimplifyResult {
+	std::vector<uint32_t> indices;
+	float error = 0.0f;   // largest collapse error, as a distance in mesh units
+};
+
+// Collapses edges until at most targetTriangles remain or no collapse stays under maxError
+SimplifyResult SimplifyMesh(const Mesh& mesh, size_t targetTriangles, float maxError = 1e30f);
@@ -0,0 +1,622 @@
+#include "MeshStreamImporter.h"
+#include "MappedFile.h"
+#include "MeshImport.h"
+#include "StateCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+// ===| Line Parsing |==========================================================================
+
+namespace {
+
+// Relative (negative) OBJ indices are kept relative to the first vertex of their piece until the
+// merge knows where that piece starts: they are stored biased into this range
+const int64_t RELATIVE_CORNER = -(int64_t(1) << 62);
+
+const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+	return p;
+}
+
+const char* skipToken(const char* p, const char* end) {
+	while (p < end && *p != ' ' && *p != '\t')
+		++p;
+	return p;
+}
+
+// nullptr when there is no number at p
+const char* parseFloat(const char* p, const char* end, float& value) {
+	p = skipSpaces(p, end);
+	if (p < end && *p == '+')
+		++p;
+	const std::from_chars_result result = std::from_chars(p, end, value);
+	return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+const char* parseInt(const char* p, const char* end, int64_t& value) {
+	p = skipSpaces(p, end);
+	if (p < end && *p == '+')
+		++p;
+	const std::from_chars_result result = std::from_chars(p, end, value);
+	return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+const char* lineEnd(const char* p, const char* end) {
+	const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+	return newline ? newline : end;
+}
+
+// Moves position forward to just past the next newline (or to end)
+size_t alignToLine(const char* data, size_t position, size_t size) {
+	if (position == 0 || position >= size)
+		return std::min(position, size);
+	const char* newline = static_cast<const char*>(std::memchr(data + position - 1, '\n', size - position + 1));
+	return newline ? static_cast<size_t>(newline - data) + 1 : size;
+}
+
+// Two independent 64-bit hashes of a vertex's bits: welding compares these instead of keeping
+// every welded vertex around on the CPU
+struct VertexKey {
+	uint64_t a;
+	uint64_t b;
+};
+
+uint64_t mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+VertexKey makeKey(const float* position, const float* color) {
+	uint64_t a = 0x9e3779b97f4a7c15ull, b = 0x632be59bd9b4e019ull;
+	for (int k = 0; k < 6; ++k) {
+		float value = k < 3 ? position[k] : color[k - 3];
+		if (value == 0.0f)
+			value = 0.0f;   // -0 and +0 weld
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		a = mix(a ^ bits);
+		b = mix(b + bits * 0x9e3779b97f4a7c15ull);
+	}
+	return { a, b | 1 };   // b == 0 marks an empty slot
+}
+
+// Open addressing, linear probing; grows at half load
+class WeldTable {
+public:
+	// Returns the id stored for key, inserting nextId when the key is new
+	uint32_t Insert(const VertexKey& key, uint32_t nextId) {
+		if ((count + 1) * 2 > slots.size())
+			Grow();
+		size_t mask = slots.size() - 1;
+		for (size_t i = key.a & mask;; i = (i + 1) & mask) {
+			Slot& slot = slots[i];
+			if (slot.b == 0) {
+				slot = { key.a, key.b, nextId };
+				++count;
+				return nextId;
+			}
+			if (slot.a == key.a && slot.b == key.b)
+				return slot.id;
+		}
+	}
+
+private:
+	struct Slot {
+		uint64_t a = 0;
+		uint64_t b = 0;
+		uint32_t id = 0;
+	};
+
+	void Grow() {
+		std::vector<Slot> old(std::max<size_t>(slots.size() * 2, 1024));
+		old.swap(slots);
+		count = 0;
+		for (const Slot& slot : old) {
+			if (slot.b != 0)
+				Insert({ slot.a, slot.b }, slot.id);
+		}
+	}
+
+	std::vector<Slot> slots;
+	size_t count = 0;
+};
+
+// What one piece of a window parses into
+struct ParsedPiece {
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<VertexKey> keys;
+	std::vector<int64_t> corners;     // 3 per triangle, 0-based absolute or biased relative
+	std::vector<uint32_t> triangles;  // corners remapped to welded vertices
+	size_t degenerate = 0;
+	bool failed = false;
+
+	void Clear() {
+		positions.clear();
+		colors.clear();
+		keys.clear();
+		corners.clear();
+		triangles.clear();
+		degenerate = 0;
+		failed = false;
+	}
+
+	size_t Bytes() const {
+		return positions.capacity() * sizeof(float) + colors.capacity() * sizeof(float)
+			+ keys.capacity() * sizeof(VertexKey) + corners.capacity() * sizeof(int64_t)
+			+ triangles.capacity() * sizeof(uint32_t);
+	}
+
+	void AddVertex(const float* position, const float* color) {
+		positions.insert(positions.end(), position, position + 3);
+		colors.insert(colors.end(), color, color + 3);
+		keys.push_back(makeKey(position, color));
+	}
+
+	void AddPolygon(const int64_t* polygon, size_t count) {
+		for (size_t i = 2; i < count; ++i)
+			corners.insert(corners.end(), { polygon[0], polygon[i - 1], polygon[i] });
+	}
+};
+
+// ===| OBJ Pieces |============================================================================
+
+void parseObjPiece(const char* p, const char* end, ParsedPiece& piece) {
+	std::vector<int64_t> polygon;
+	while (p < end) {
+		const char* eol = lineEnd(p, end);
+		const char* q = skipSpaces(p, eol);
+		const bool vertex = eol - q > 1 && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t');
+		const bool face = eol - q > 1 && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t');
+
+		if (vertex) {
+			float position[3] = {};
+			float color[3] = { 1.0f, 1.0f, 1.0f };
+			q += 1;
+			for (int k = 0; k < 3 && q; ++k)
+				q = parseFloat(q, eol, position[k]);
+			if (!q) {
+				piece.failed = true;
+				return;
+			}
+			// Optional per-vertex color; anything else after the position is ignored
+			float rgb[3];
+			const char* c = q;
+			for (int k = 0; k < 3 && c; ++k)
+				c = parseFloat(c, eol, rgb[k]);
+			if (c)
+				std::memcpy(color, rgb, sizeof(color));
+			piece.AddVertex(position, color);
+		}
+		else if (face) {
+			polygon.clear();
+			const int64_t localVertex = static_cast<int64_t>(piece.keys.size());
+			for (q = skipSpaces(q + 1, eol); q < eol; q = skipSpaces(q, eol)) {
+				int64_t index;
+				const char* next = parseInt(q, eol, index);
+				if (!next || index == 0) {
+					piece.failed = true;
+					return;
+				}
+				polygon.push_back(index > 0 ? index - 1 : RELATIVE_CORNER + localVertex + index);
+				q = skipToken(next, eol);   // "/vt/vn"
+			}
+			piece.AddPolygon(polygon.data(), polygon.size());
+		}
+		p = eol + 1;
+	}
+}
+
+// ===| PLY Pieces |============================================================================
+
+struct PlyLayout {
+	struct Property {
+		bool list = false;
+		bool integer = false;
+		int role = -1;   // 0-2 position, 3-5 color, 6 vertex indices
+	};
+	struct Element {
+		bool vertex = false;
+		bool face = false;
+		size_t firstLine = 0;
+		size_t count = 0;
+		std::vector<Property> properties;
+	};
+	std::vector<Element> elements;
+	size_t bodyOffset = 0;
+	bool binary = false;
+};
+
+bool readPlyHeader(std::string_view text, PlyLayout& layout) {
+	size_t line = 0;
+	size_t offset = 0;
+	bool first = true;
+	while (offset < text.size()) {
+		size_t eol = text.find('\n', offset);
+		if (eol == std::string_view::npos)
+			eol = text.size();
+		std::string_view current = text.substr(offset, eol - offset);
+		offset = eol + 1;
+		if (!current.empty() && current.back() == '\r')
+			current.remove_suffix(1);
+
+		auto token = [&current]() {
+			const size_t start = current.find_first_not_of(" \t");
+			if (start == std::string_view::npos)
+				return std::string_view();
+			const size_t stop = current.find_first_of(" \t", start);
+			const std::string_view result = current.substr(start, stop == std::string_view::npos ? std::string_view::npos : stop - start);
+			current.remove_prefix(stop == std::string_view::npos ? current.size() : stop);
+			return result;
+		};
+
+		const std::string_view keyword = token();
+		if (first) {
+			if (keyword != "ply")
+				return false;
+			first = false;
+		}
+		else if (keyword == "format") {
+			layout.binary = token() != "ascii";
+		}
+		else if (keyword == "element") {
+			PlyLayout::Element element;
+			const std::string_view name = token();
+			element.vertex = name == "vertex";
+			element.face = name == "face";
+			const std::string_view count = token();
+			std::from_chars(count.data(), count.data() + count.size(), element.count);
+			element.firstLine = line;
+			line += element.count;
+			layout.elements.push_back(element);
+		}
+		else if (keyword == "property" && !layout.elements.empty()) {
+			PlyLayout::Property property;
+			std::string_view type = token();
+			if (type == "list") {
+				property.list = true;
+				token();
+				type = token();
+			}
+			property.integer = type != "float" && type != "float32" && type != "double" && type != "float64";
+			const std::string_view name = token();
+			const char* roles[] = { "x", "y", "z", "red", "green", "blue" };
+			for (int role = 0; role < 6; ++role) {
+				if (name == roles[role])
+					property.role = role;
+			}
+			if (property.list && (name == "vertex_indices" || name == "vertex_index"))
+				property.role = 6;
+			layout.elements.back().properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			layout.bodyOffset = offset;
+			return true;
+		}
+	}
+	return false;
+}
+
+void parsePlyPiece(const char* p, const char* end, size_t line, const PlyLayout& layout, ParsedPiece& piece) {
+	std::vector<int64_t> polygon;
+	size_t element = 0;
+	for (; p < end; p = lineEnd(p, end) + 1, ++line) {
+		while (element < layout.elements.size() && line >= layout.elements[element].firstLine + layout.elements[element].count)
+			++element;
+		if (element == layout.elements.size())
+			return;   // past the last element
+		const PlyLayout::Element& current = layout.elements[element];
+		if (!current.vertex && !current.face)
+			continue;
+
+		const char* eol = lineEnd(p, end);
+		const char* q = p;
+		float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+		polygon.clear();
+		for (const PlyLayout::Property& property : current.properties) {
+			if (property.list) {
+				int64_t count = 0;
+				q = parseInt(q, eol, count);
+				for (int64_t k = 0; k < count && q; ++k) {
+					int64_t index;
+					q = parseInt(q, eol, index);
+					if (property.role == 6)
+						polygon.push_back(index);
+				}
+			}
+			else {
+				float value = 0.0f;
+				q = parseFloat(q, eol, value);
+				if (property.role >= 0)
+					values[property.role] = property.role >= 3 && property.integer ? value / 255.0f : value;
+			}
+			if (!q) {
+				piece.failed = true;
+				return;
+			}
+		}
+
+		if (current.vertex)
+			piece.AddVertex(values, values + 3);
+		else
+			piece.AddPolygon(polygon.data(), polygon.size());
+	}
+}
+
+// ===| GPU Buffers |===========================================================================
+
+// Appends to a buffer that grows by copying into a larger one on the GPU
+struct GrowingBuffer {
+	unsigned int buffer = 0;
+	size_t capacity = 0;
+	size_t used = 0;
+
+	void Append(const void* data, size_t bytes) {
+		if (bytes == 0)
+			return;
+		if (used + bytes > capacity) {
+			const size_t newCapacity = std::max(capacity * 2, used + bytes);
+			unsigned int grown = 0;
+			glGenBuffers(1, &grown);
+			glState.BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+			glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+			if (used > 0) {
+				glState.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+			}
+			if (buffer) {
+				glState.OnBufferDeleted(buffer);
+				glDeleteBuffers(1, &buffer);
+			}
+			buffer = grown;
+			capacity = newCapacity;
+		}
+		glState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, used, bytes, data);
+		used += bytes;
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+double ImportStats::MegabytesPerSecond() const {
+	return totalMilliseconds > 0.0 ? fileBytes / (1024.0 * 1024.0) * 1000.0 / totalMilliseconds : 0.0;
+}
+
+// ===| Streaming Import |======================================================================
+
+MeshStreamImporter::MeshStreamImporter(ThreadPool& pool, const VertexLayout& layout, size_t windowBytes)
+	: pool(pool), layout(layout), windowBytes(std::max<size_t>(windowBytes, 1u << 16)) {
+}
+
+bool MeshStreamImporter::Import(const std::string& path, GpuMesh& gpuMesh) {
+	const Clock::time_point start = Clock::now();
+	stats = ImportStats();
+
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	const bool ply = extension == ".ply";
+	if (!ply && extension != ".obj") {
+		std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT " << path << " (expected .obj or .ply)\n";
+		return false;
+	}
+
+	MappedFile file;
+	if (!file.Open(path)) {
+		std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << "\n";
+		return false;
+	}
+	stats.fileBytes = file.Size();
+
+	PlyLayout plyLayout;
+	size_t bodyOffset = 0;
+	if (ply) {
+		if (!readPlyHeader(file.View(), plyLayout)) {
+			std::cout << "ERROR::MESH_IMPORT::PLY_HEADER_INCOMPLETE " << path << "\n";
+			return false;
+		}
+		if (plyLayout.binary) {
+			// Already compact and fixed-size: nothing to gain from parallel text parsing
+			Mesh mesh;
+			if (!LoadPly(path, mesh))
+				return false;
+			gpuMesh = UploadMesh(mesh, layout);
+			stats.sourceVertices = stats.weldedVertices = mesh.VertexCount();
+			stats.triangles = mesh.TriangleCount();
+			stats.totalMilliseconds = millisecondsSince(start);
+			return true;
+		}
+		bodyOffset = plyLayout.bodyOffset;
+	}
+
+	const char* data = file.Data();
+	const size_t size = file.Size();
+	const size_t pieceCount = std::max<size_t>(pool.ThreadCount() + 1, 1) * 4;
+	std::vector<ParsedPiece> pieces(pieceCount);
+	std::vector<size_t> pieceStart(pieceCount + 1);
+	std::vector<size_t> pieceLine(pieceCount);
+	std::vector<size_t> pieceVertexBase(pieceCount);
+
+	WeldTable weldTable;
+	std::vector<uint32_t> remap;        // source vertex -> welded vertex
+	std::vector<float> newPositions;    // welded vertices first seen in this window
+	std::vector<float> newColors;
+	std::vector<unsigned char> packed;
+	GrowingBuffer vertices;
+	GrowingBuffer indices;
+	size_t line = 0;
+	bool failed = false;
+
+	for (size_t windowBegin = bodyOffset; windowBegin < size && !failed;) {
+		const size_t windowEnd = alignToLine(data, std::min(size, windowBegin + windowBytes), size);
+		++stats.windows;
+		if (windowEnd < size)
+			file.Prefetch(windowEnd, windowBytes);
+
+		// Parse: the window's pieces in parallel
+		Clock::time_point phase = Clock::now();
+		for (size_t i = 0; i <= pieceCount; ++i)
+			pieceStart[i] = alignToLine(data, windowBegin + (windowEnd - windowBegin) * i / pieceCount, windowEnd);
+		if (ply) {
+			// PLY lines belong to elements by number, so every piece needs its first line number
+			pool.ParallelFor(pieceCount, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					pieceLine[i] = std::count(data + pieceStart[i], data + pieceStart[i + 1], '\n');
+			});
+			for (size_t i = 0; i < pieceCount; ++i) {
+				const size_t lines = pieceLine[i];
+				pieceLine[i] = line;
+				line += lines;
+			}
+		}
+		pool.ParallelFor(pieceCount, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				pieces[i].Clear();
+				if (ply)
+					parsePlyPiece(data + pieceStart[i], data + pieceStart[i + 1], pieceLine[i], plyLayout, pieces[i]);
+				else
+					parseObjPiece(data + pieceStart[i], data + pieceStart[i + 1], pieces[i]);
+			}
+		});
+		stats.parseMilliseconds += millisecondsSince(phase);
+
+		// Weld: in file order, since welded ids are handed out in first-seen order
+		phase = Clock::now();
+		const uint32_t weldedBefore = static_cast<uint32_t>(stats.weldedVertices);
+		newPositions.clear();
+		newColors.clear();
+		size_t windowMemory = 0;
+		for (size_t i = 0; i < pieceCount; ++i) {
+			ParsedPiece& piece = pieces[i];
+			failed |= piece.failed;
+			windowMemory += piece.Bytes();
+			pieceVertexBase[i] = remap.size();
+			for (size_t v = 0; v < piece.keys.size(); ++v) {
+				const uint32_t next = static_cast<uint32_t>(stats.weldedVertices);
+				const uint32_t id = welding ? weldTable.Insert(piece.keys[v], next) : next;
+				if (id == next) {
+					newPositions.insert(newPositions.end(), &piece.positions[v * 3], &piece.positions[v * 3] + 3);
+					newColors.insert(newColors.end(), &piece.colors[v * 3], &piece.colors[v * 3] + 3);
+					++stats.weldedVertices;
+				}
+				remap.push_back(id);
+			}
+		}
+		stats.sourceVertices = remap.size();
+		if (failed)
+			break;
+
+		// Remap corners to welded vertices, dropping triangles welding collapsed
+		std::atomic<bool> badIndex{ false };
+		pool.ParallelFor(pieceCount, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				ParsedPiece& piece = pieces[i];
+				piece.triangles.reserve(piece.corners.size());
+				for (size_t c = 0; c < piece.corners.size(); c += 3) {
+					uint32_t triangle[3];
+					for (int k = 0; k < 3; ++k) {
+						int64_t corner = piece.corners[c + k];
+						if (corner < RELATIVE_CORNER / 2)
+							corner = static_cast<int64_t>(pieceVertexBase[i]) + (corner - RELATIVE_CORNER);
+						if (corner < 0 || corner >= static_cast<int64_t>(remap.size())) {
+							badIndex = true;
+							return;
+						}
+						triangle[k] = remap[static_cast<size_t>(corner)];
+					}
+					if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+						++piece.degenerate;
+						continue;
+					}
+					piece.triangles.insert(piece.triangles.end(), triangle, triangle + 3);
+				}
+			}
+		});
+		stats.mergeMilliseconds += millisecondsSince(phase);
+		if (badIndex) {
+			std::cout << "ERROR::MESH_IMPORT::INDEX_OUT_OF_RANGE " << path << "\n";
+			failed = true;
+			break;
+		}
+
+		// Upload: the window's new vertices and its triangles
+		phase = Clock::now();
+		const size_t newVertexCount = stats.weldedVertices - weldedBefore;
+		packed.resize(newVertexCount * layout.Stride());
+		pool.ParallelFor(newVertexCount, [&](size_t begin, size_t end) {
+			VertexStreams streams;
+			streams.count = end - begin;
+			streams.positions = newPositions.data() + begin * 3;
+			streams.colors = newColors.data() + begin * 3;
+			PackVertices(layout, streams, packed.data() + begin * layout.Stride());
+		}, 4096);
+		vertices.Append(packed.data(), packed.size());
+		for (const ParsedPiece& piece : pieces) {
+			indices.Append(piece.triangles.data(), piece.triangles.size() * sizeof(uint32_t));
+			stats.triangles += piece.triangles.size() / 3;
+			stats.degenerateTriangles += piece.degenerate;
+		}
+		stats.uploadMilliseconds += millisecondsSince(phase);
+		stats.peakWindowBytes = std::max(stats.peakWindowBytes, windowMemory + packed.capacity()
+			+ (newPositions.capacity() + newColors.capacity()) * sizeof(float));
+
+		// The window's pages are done with; keep the process's footprint at about one window
+		file.Release(windowBegin, windowEnd - windowBegin);
+		windowBegin = windowEnd;
+	}
+
+	if (failed) {
+		std::cout << "ERROR::MESH_IMPORT::PARSE_FAILED " << path << "\n";
+		for (GrowingBuffer* buffer : { &vertices, &indices }) {
+			glState.OnBufferDeleted(buffer->buffer);
+			glDeleteBuffers(1, &buffer->buffer);
+		}
+		return false;
+	}
+
+	// Buffers can still be empty for a file without faces: give GL something to bind
+	if (!vertices.buffer)
+		glGenBuffers(1, &vertices.buffer);
+	if (!indices.buffer)
+		glGenBuffers(1, &indices.buffer);
+
+	gpuMesh = GpuMesh();
+	gpuMesh.VBO = vertices.buffer;
+	gpuMesh.EBO = indices.buffer;
+	gpuMesh.indexCount = static_cast<GLsizei>(stats.triangles * 3);
+	gpuMesh.indexType = GL_UNSIGNED_INT;
+	gpuMesh.vertexCount = stats.weldedVertices;
+
+	glGenVertexArrays(1, &gpuMesh.VAO);
+	glState.BindVertexArray(gpuMesh.VAO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+	layout.Apply();
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Finished copies included: the time is until the mesh could be drawn
+	glFinish();
+	stats.totalMilliseconds = millisecondsSince(start);
+	return true;
+}
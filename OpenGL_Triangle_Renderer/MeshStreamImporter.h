@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+class ThreadPool;
+
+// ===| Streaming Mesh Importer |===============================================================
+//
+// Imports ascii OBJ and PLY files of any size straight into GPU buffers. The mapped file is
+// walked in windows of windowBytes; each window is cut at line boundaries into pieces that are
+// parsed on the pool with std::from_chars, then merged in file order: vertices are welded by
+// hashing their position and color bits, face indices are remapped to the welded vertices in
+// parallel, and the window's new vertices and triangles are appended to the GPU buffers before
+// the next window is read. CPU memory is bounded by the window plus one 4-byte remap entry per
+// source vertex and the weld table; the mesh itself only ever lives on the GPU.
+//
+// Indices are always 32-bit, since the vertex count is not known up front. Binary PLY goes
+// through LoadPly() and a plain upload.
+
+struct ImportStats {
+	size_t fileBytes = 0;
+	size_t windows = 0;
+	size_t sourceVertices = 0;
+	size_t weldedVertices = 0;
+	size_t triangles = 0;
+	size_t degenerateTriangles = 0;   // collapsed to a line or point by welding, dropped
+	size_t peakWindowBytes = 0;       // CPU memory held by one window's parse results
+	double parseMilliseconds = 0.0;
+	double mergeMilliseconds = 0.0;
+	double uploadMilliseconds = 0.0;
+	double totalMilliseconds = 0.0;
+
+	double MegabytesPerSecond() const;
+};
+
+class MeshStreamImporter {
+public:
+	MeshStreamImporter(ThreadPool& pool, const VertexLayout& layout, size_t windowBytes = 64u << 20);
+
+	void SetWelding(bool enabled) { welding = enabled; }
+
+	// On success gpuMesh owns new buffers and a VAO set up for layout
+	bool Import(const std::string& path, GpuMesh& gpuMesh);
+	const ImportStats& Stats() const { return stats; }
+
+private:
+	ThreadPool& pool;
+	VertexLayout layout;
+	size_t windowBytes;
+	bool welding = true;
+	ImportStats stats;
+};
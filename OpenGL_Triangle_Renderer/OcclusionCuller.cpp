@@ -0,0 +1,104 @@
+#include "OcclusionCuller.h"
+#include "FrameHistory.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "StateCache.h"
+#include "VertexLayout.h"
+
+OcclusionCuller::OcclusionCuller(size_t objectCount, const GpuMesh& proxy, unsigned int proxyProgram)
+	: queries(objectCount), proxy(proxy), proxyProgram(proxyProgram) {
+	std::vector<unsigned int> names(objectCount);
+	if (objectCount > 0)
+		glGenQueries(static_cast<GLsizei>(objectCount), names.data());
+	for (size_t i = 0; i < objectCount; ++i)
+		queries[i].query = names[i];
+}
+
+OcclusionCuller::~OcclusionCuller() {
+	for (ObjectQuery& object : queries)
+		glDeleteQueries(1, &object.query);
+}
+
+void OcclusionCuller::CollectResults() {
+	while (!inFlight.empty()) {
+		ObjectQuery& object = queries[inFlight.front()];
+
+		// Queries finish in the order they were issued: once one is not ready, later ones are not either
+		GLuint available = 0;
+		glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint anySamples = 0;
+		glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &anySamples);
+		object.occluded = anySamples == 0;
+		object.pending = false;
+		inFlight.pop_front();
+		++frame.resultsCollected;
+	}
+}
+
+const std::vector<uint32_t>& OcclusionCuller::Filter(const std::vector<uint32_t>& candidates) {
+	drawn.clear();
+	frame.candidates += candidates.size();
+	for (uint32_t id : candidates) {
+		const ObjectQuery& object = queries[id];
+		if (object.pending) {
+			++frame.conditional;
+			drawn.push_back(id);
+		}
+		else if (object.occluded) {
+			++frame.skipped;
+		}
+		else {
+			drawn.push_back(id);
+		}
+	}
+	return drawn;
+}
+
+unsigned int OcclusionCuller::ConditionQuery(uint32_t id) const {
+	return queries[id].pending ? queries[id].query : 0;
+}
+
+void OcclusionCuller::IssueQueries(const std::vector<SceneObject>& objects, const std::vector<uint32_t>& candidates,
+	const Mat4& camera) {
+
+	// Proxies only test depth: <= so an object's proxy passes against the object itself
+	glState.ColorMask(false, false, false, false);
+	glState.DepthMask(false);
+	glState.Enable(GL_DEPTH_TEST);
+	glState.DepthFunc(GL_LEQUAL);
+	glState.Disable(GL_BLEND);
+	glState.UseProgram(proxyProgram);
+	glState.BindVertexArray(proxy.VAO);
+
+	for (uint32_t id : candidates) {
+		ObjectQuery& object = queries[id];
+		if (object.pending)
+			continue;
+
+		const InstanceData placement = PlaceObject(objects[id], camera);
+		glVertexAttrib4fv(ATTRIB_INSTANCE_OFFSET_SCALE, placement.offsetScale);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, object.query);
+		DrawMesh(proxy);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		object.pending = true;
+		inFlight.push_back(id);
+		++frame.queriesIssued;
+	}
+
+	SetDefaultInstanceAttributes();
+	glState.ColorMask(true, true, true, true);
+	glState.DepthMask(true);
+	glState.DepthFunc(GL_LESS);
+	glState.Disable(GL_DEPTH_TEST);
+}
+
+void OcclusionCuller::EndFrame() {
+	lastFrame = frame;
+	AppendHistory(history, frame);
+	frame = OcclusionFrameStats();
+}
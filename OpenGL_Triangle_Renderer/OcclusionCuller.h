@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "MathUtil.h"
+
+struct GpuMesh;
+struct SceneObject;
+
+// ===| Occlusion Culling |=====================================================================
+//
+// One GL_ANY_SAMPLES_PASSED query per object. After the opaque objects are drawn, objects with
+// no query in flight get their bounding proxy drawn (no color or depth writes) inside a new
+// query. Results are only read once GL says they are available, usually a frame or two later,
+// so the CPU never waits on the GPU:
+//   - last result "no samples": the object is skipped entirely,
+//   - query still in flight: the object is drawn under glBeginConditionalRender(GL_QUERY_NO_WAIT),
+//     which lets the GPU drop it if the result is in by then,
+//   - otherwise it is drawn normally.
+// An object that becomes visible again shows up as soon as its next query is read back.
+
+struct OcclusionFrameStats {
+	size_t candidates = 0;        // objects considered (after frustum culling)
+	size_t skipped = 0;           // draws saved: last query found the object hidden
+	size_t conditional = 0;       // draws left to the GPU under conditional render
+	size_t queriesIssued = 0;
+	size_t resultsCollected = 0;
+};
+
+class OcclusionCuller {
+public:
+	// proxy is drawn scaled by each object's placement, so it must bound every object mesh
+	OcclusionCuller(size_t objectCount, const GpuMesh& proxy, unsigned int proxyProgram);
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// Reads back the results that are available, oldest first; never waits
+	void CollectResults();
+
+	// The candidates that are not known to be hidden. The list lives until the next call.
+	const std::vector<uint32_t>& Filter(const std::vector<uint32_t>& candidates);
+
+	// The in-flight query to make the object's draw conditional on, 0 if none
+	unsigned int ConditionQuery(uint32_t id) const;
+
+	// Draws proxies with queries for candidates that have none in flight. Call once the opaque
+	// objects are drawn, so the depth buffer holds this frame's occluders.
+	void IssueQueries(const std::vector<SceneObject>& objects, const std::vector<uint32_t>& candidates,
+		const Mat4& camera);
+
+	void EndFrame();
+	const OcclusionFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<OcclusionFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	struct ObjectQuery {
+		unsigned int query = 0;
+		bool pending = false;
+		bool occluded = false;
+	};
+
+	std::vector<ObjectQuery> queries;
+	std::deque<uint32_t> inFlight;   // in issue order, which is the order results arrive in
+	std::vector<uint32_t> drawn;
+
+	const GpuMesh& proxy;
+	unsigned int proxyProgram;
+
+	OcclusionFrameStats frame;
+	OcclusionFrameStats lastFrame;
+	std::vector<OcclusionFrameStats> history;
+};
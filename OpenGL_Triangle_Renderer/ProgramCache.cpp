@@ -0,0 +1,161 @@
+#include "ProgramCache.h"
+#include "GLExtensions.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+// On-disk entry: header followed by the driver's binary blob
+struct ProgramCacheHeader {
+	char magic[4];          // "PBIN"
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binaryLength;
+};
+
+static const uint32_t CACHE_VERSION = 1;
+
+// ===| Hashing |===============================================================================
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static std::string glString(GLenum name) {
+	const char* str = reinterpret_cast<const char*>(glGetString(name));
+	return str ? str : "";
+}
+
+// ===| Program Cache |=========================================================================
+
+ProgramCache::ProgramCache(const std::string& directory)
+	: directory(directory) {
+	enabled = !directory.empty() && glExt.programBinary;
+	if (!enabled)
+		return;
+
+	// Same strings getOpenGLVerInfo() prints: a binary is only valid for the driver that made it
+	contextSignature = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY " << directory << "\n";
+		enabled = false;
+	}
+}
+
+uint64_t ProgramCache::MakeKey(std::initializer_list<std::string_view> sources) const {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = fnv1a(hash, contextSignature.data(), contextSignature.size());
+	for (std::string_view source : sources) {
+		// Length prefix so that moving text from one stage to the next changes the key
+		uint64_t length = source.size();
+		hash = fnv1a(hash, &length, sizeof(length));
+		hash = fnv1a(hash, source.data(), source.size());
+	}
+	return hash;
+}
+
+std::string ProgramCache::EntryPath(uint64_t key) const {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(directory) / name).string();
+}
+
+unsigned int ProgramCache::Load(uint64_t key) {
+	if (!enabled)
+		return 0;
+
+	const std::string path = EntryPath(key);
+	MappedFile file;
+	if (!file.Open(path)) {
+		++misses;
+		return 0;
+	}
+
+	ProgramCacheHeader header;
+	if (file.Size() < sizeof(header)) {
+		++misses;
+		return 0;
+	}
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, "PBIN", 4) != 0 || header.version != CACHE_VERSION || header.key != key
+		|| file.Size() - sizeof(header) < header.binaryLength) {
+		++misses;
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glExt.ProgramBinary(program, header.binaryFormat, file.Data() + sizeof(header), header.binaryLength);
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// Rejected (e.g. driver changed in a way the version string does not show): drop the entry
+		glDeleteProgram(program);
+		file.Close();
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		++misses;
+		return 0;
+	}
+
+	++hits;
+	return program;
+}
+
+void ProgramCache::PrepareForRetrieval(unsigned int program) const {
+	if (enabled)
+		glExt.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::Store(uint64_t key, unsigned int program) {
+	if (!enabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glExt.GetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramCacheHeader header;
+	std::memcpy(header.magic, "PBIN", 4);
+	header.version = CACHE_VERSION;
+	header.key = key;
+	header.binaryFormat = format;
+	header.binaryLength = static_cast<uint32_t>(length);
+
+	// Write to a temporary name and rename, so a concurrent reader never sees a partial entry
+	const std::string path = EntryPath(key);
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		if (!out.is_open()) {
+			std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << tempPath << "\n";
+			return;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(binary.data(), length);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+		std::filesystem::remove(tempPath, error);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// ===| Program Binary Cache |==================================================================
+//
+// Stores linked programs on disk with glGetProgramBinary and restores them with glProgramBinary.
+// Entries are keyed by a hash of the shader sources and the GL vendor/renderer/version strings,
+// so a driver update or a shader edit simply misses the cache. A binary the driver rejects is
+// deleted and the caller falls back to compiling from source.
+
+class ProgramCache {
+public:
+	// An empty directory disables the cache
+	explicit ProgramCache(const std::string& directory);
+
+	bool Enabled() const { return enabled; }
+
+	uint64_t MakeKey(std::initializer_list<std::string_view> sources) const;
+
+	// Returns a linked program, or 0 when there is no usable entry for key
+	unsigned int Load(uint64_t key);
+
+	// Call before glLinkProgram so the driver keeps the binary around for Store()
+	void PrepareForRetrieval(unsigned int program) const;
+	void Store(uint64_t key, unsigned int program);
+
+	unsigned int Hits() const { return hits; }
+	unsigned int Misses() const { return misses; }
+
+private:
+	std::string EntryPath(uint64_t key) const;
+
+	std::string directory;
+	std::string contextSignature;
+	bool enabled = false;
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+};
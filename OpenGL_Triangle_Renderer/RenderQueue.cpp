@@ -0,0 +1,228 @@
+#include "RenderQueue.h"
+#include "FrameHistory.h"
+#include "Mesh.h"
+#include "StateCache.h"
+#include "ThreadPool.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ===| Sort Keys |=============================================================================
+
+static const int PROGRAM_BITS = 10;
+static const int VAO_BITS = 14;
+static const int TEXTURE_BITS = 14;
+static const int DEPTH_BITS = 24;
+
+uint64_t MakeSortKey(RenderPass pass, uint32_t programId, uint32_t vaoId, uint32_t textureId, float depth) {
+	const uint64_t depthMax = (1ull << DEPTH_BITS) - 1;
+	uint64_t quantized = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * depthMax);
+	const uint64_t state = (static_cast<uint64_t>(programId) << (VAO_BITS + TEXTURE_BITS))
+		| (static_cast<uint64_t>(vaoId) << TEXTURE_BITS)
+		| textureId;
+	const uint64_t passBits = static_cast<uint64_t>(pass) << 62;
+
+	if (pass == RenderPass::Transparent)
+		return passBits | ((depthMax - quantized) << (PROGRAM_BITS + VAO_BITS + TEXTURE_BITS)) | state;
+	return passBits | (state << DEPTH_BITS) | quantized;
+}
+
+void RadixSortKeys(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+	std::vector<uint64_t>& scratchKeys, std::vector<uint32_t>& scratchValues) {
+	const size_t count = keys.size();
+	scratchKeys.resize(count);
+	scratchValues.resize(count);
+
+	// All eight histograms in one read of the keys
+	size_t histograms[8][256] = {};
+	for (uint64_t key : keys) {
+		for (int digit = 0; digit < 8; ++digit)
+			++histograms[digit][(key >> (digit * 8)) & 0xFF];
+	}
+
+	for (int digit = 0; digit < 8; ++digit) {
+		size_t* histogram = histograms[digit];
+		if (histogram[(keys.empty() ? 0 : keys[0] >> (digit * 8)) & 0xFF] == count)
+			continue;   // every key has the same byte here: the pass would not move anything
+
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; ++bucket) {
+			const size_t bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+
+		const int shift = digit * 8;
+		for (size_t i = 0; i < count; ++i) {
+			const size_t destination = histogram[(keys[i] >> shift) & 0xFF]++;
+			scratchKeys[destination] = keys[i];
+			scratchValues[destination] = values[i];
+		}
+		keys.swap(scratchKeys);
+		values.swap(scratchValues);
+	}
+}
+
+// ===| Render Queue |==========================================================================
+
+void ApplyPassState(bool transparent) {
+	// Both passes test depth; only opaque objects write it, transparent ones blend
+	glState.Enable(GL_DEPTH_TEST);
+	glState.DepthFunc(GL_LESS);
+	glState.DepthMask(!transparent);
+	glState.SetEnabled(GL_BLEND, transparent);
+	if (transparent)
+		glState.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+uint32_t RenderQueue::Intern(std::unordered_map<unsigned int, uint32_t>& ids, unsigned int name, uint32_t limit) {
+	auto found = ids.find(name);
+	if (found != ids.end())
+		return found->second;
+
+	// Past the field width ids wrap: sorting gets less effective but stays correct
+	const uint32_t id = static_cast<uint32_t>(ids.size()) & (limit - 1);
+	ids.emplace(name, id);
+	return id;
+}
+
+void RenderQueue::Begin() {
+	items.clear();
+	keys.clear();
+	order.clear();
+}
+
+void RenderQueue::Submit(const DrawItem& item) {
+	const uint32_t programId = Intern(programIds, item.program, 1u << PROGRAM_BITS);
+	const uint32_t vaoId = Intern(vaoIds, item.mesh->VAO, 1u << VAO_BITS);
+	const uint32_t textureId = Intern(textureIds, item.texture, 1u << TEXTURE_BITS);
+
+	keys.push_back(MakeSortKey(item.pass, programId, vaoId, textureId, item.depth));
+	order.push_back(static_cast<uint32_t>(items.size()));
+	items.push_back(item);
+}
+
+unsigned int RenderQueue::CountStateChanges(bool sorted) const {
+	unsigned int changes = 0;
+	const DrawItem* previous = NULL;
+	for (size_t i = 0; i < items.size(); ++i) {
+		const DrawItem& item = items[sorted ? order[i] : i];
+		if (!previous || item.pass != previous->pass) ++changes;
+		if (!previous || item.program != previous->program) ++changes;
+		if (!previous || item.mesh->VAO != previous->mesh->VAO) ++changes;
+		if (!previous || item.texture != previous->texture) ++changes;
+		previous = &item;
+	}
+	return changes;
+}
+
+RenderQueueStats RenderQueue::Prepare() {
+	RenderQueueStats stats;
+	stats.items = items.size();
+	for (const DrawItem& item : items)
+		stats.triangles += (item.indexCount ? item.indexCount : item.mesh->indexCount) / 3;
+	stats.stateChangesUnsorted = CountStateChanges(false);
+
+	if (sorting) {
+		const auto start = std::chrono::steady_clock::now();
+		RadixSortKeys(keys, order, scratchKeys, scratchOrder);
+		stats.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	stats.stateChangesSorted = sorting ? CountStateChanges(true) : stats.stateChangesUnsorted;
+	return stats;
+}
+
+void RenderQueue::Finish(const RenderQueueStats& stats) {
+	glState.Disable(GL_BLEND);
+	glState.DepthMask(true);
+	glState.Disable(GL_DEPTH_TEST);
+	SetDefaultInstanceAttributes();
+
+	lastFrame = stats;
+	AppendHistory(history, stats);
+}
+
+void RenderQueue::Execute() {
+	const RenderQueueStats stats = Prepare();
+
+	for (uint32_t index : order) {
+		const DrawItem& item = items[index];
+
+		ApplyPassState(item.pass == RenderPass::Transparent);
+		glState.UseProgram(item.program);
+		glState.BindVertexArray(item.mesh->VAO);
+		glState.BindTexture(0, GL_TEXTURE_2D, item.texture);
+
+		// Per-draw data as constant attribute values: the instance attributes are disabled
+		// in mesh VAOs, so these behave like uniforms without a per-program location lookup
+		const float* offsetScale = item.instance.offsetScale;
+		const uint32_t color = item.instance.color;
+		glVertexAttrib4f(ATTRIB_INSTANCE_OFFSET_SCALE, offsetScale[0], offsetScale[1], offsetScale[2], offsetScale[3]);
+		glVertexAttrib4Nub(ATTRIB_INSTANCE_COLOR, color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, color >> 24);
+
+		const GLsizei indexCount = item.indexCount ? static_cast<GLsizei>(item.indexCount) : item.mesh->indexCount;
+		if (item.conditionQuery)
+			glBeginConditionalRender(item.conditionQuery, GL_QUERY_NO_WAIT);
+		DrawMeshRange(*item.mesh, item.firstIndex, indexCount);
+		if (item.conditionQuery)
+			glEndConditionalRender();
+	}
+
+	Finish(stats);
+}
+
+// ===| Recorded Execution |====================================================================
+
+void RenderQueue::Record(CommandBuffer& buffer, size_t begin, size_t end) const {
+	buffer.Clear();
+
+	// State commands are only recorded when they change within this range; the first item of
+	// every range sets everything, and glState drops whatever was already bound at replay
+	const DrawItem* previous = NULL;
+	for (size_t i = begin; i < end; ++i) {
+		const DrawItem& item = items[order[i]];
+
+		if (!previous || item.pass != previous->pass)
+			buffer.SetPass(item.pass == RenderPass::Transparent);
+		if (!previous || item.program != previous->program)
+			buffer.UseProgram(item.program);
+		if (!previous || item.mesh->VAO != previous->mesh->VAO)
+			buffer.BindVertexArray(item.mesh->VAO);
+		if (!previous || item.texture != previous->texture)
+			buffer.BindTexture(0, GL_TEXTURE_2D, item.texture);
+
+		buffer.VertexAttrib4f(ATTRIB_INSTANCE_OFFSET_SCALE, item.instance.offsetScale);
+		buffer.VertexAttrib4Nub(ATTRIB_INSTANCE_COLOR, item.instance.color);
+		const GLsizei indexCount = item.indexCount ? static_cast<GLsizei>(item.indexCount) : item.mesh->indexCount;
+		buffer.DrawElements(GL_TRIANGLES, indexCount, item.mesh->indexType, item.firstIndex * IndexTypeSize(item.mesh->indexType),
+			0, item.conditionQuery);
+		previous = &item;
+	}
+}
+
+void RenderQueue::Execute(ThreadPool& pool, std::vector<CommandBuffer>& buffers) {
+	RenderQueueStats stats = Prepare();
+	if (buffers.empty())
+		buffers.resize(1);
+
+	const size_t bufferCount = buffers.size();
+	const size_t itemCount = order.size();
+	const auto recordStart = std::chrono::steady_clock::now();
+	pool.ParallelFor(bufferCount, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b)
+			Record(buffers[b], itemCount * b / bufferCount, itemCount * (b + 1) / bufferCount);
+	});
+	const auto replayStart = std::chrono::steady_clock::now();
+
+	for (const CommandBuffer& buffer : buffers) {
+		buffer.Replay();
+		stats.commandBytes += buffer.SizeBytes();
+	}
+
+	const auto replayEnd = std::chrono::steady_clock::now();
+	stats.commandBuffers = bufferCount;
+	stats.recordMilliseconds = std::chrono::duration<double, std::milli>(replayStart - recordStart).count();
+	stats.replayMilliseconds = std::chrono::duration<double, std::milli>(replayEnd - replayStart).count();
+	Finish(stats);
+}
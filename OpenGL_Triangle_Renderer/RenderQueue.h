@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "CommandBuffer.h"
+#include "Instancing.h"
+
+struct GpuMesh;
+class ThreadPool;
+
+// ===| Draw Items |============================================================================
+
+enum class RenderPass : uint8_t {
+	Opaque = 0,        // sorted by state, then front to back
+	Transparent = 1,   // blended, sorted back to front
+};
+
+struct DrawItem {
+	RenderPass pass = RenderPass::Opaque;
+	unsigned int program = 0;
+	unsigned int texture = 0;       // GL_TEXTURE_2D on unit 0; untextured draws use the white one
+	const GpuMesh* mesh = NULL;     // its VAO is part of the key
+	float depth = 0.0f;             // [0, 1], 0 = nearest
+	InstanceData instance;          // set as constant attribute values for the draw
+	unsigned int conditionQuery = 0;  // occlusion query to draw under conditional render, 0 for none
+	uint32_t firstIndex = 0;        // index range of the mesh to draw, e.g. an LOD level;
+	uint32_t indexCount = 0;        // 0 draws the whole mesh
+};
+
+// ===| Sort Keys |=============================================================================
+//
+// 64-bit key, most significant bits first:
+//   opaque:       pass:2 | program:10 | vao:14 | texture:14 | depth:24
+//   transparent:  pass:2 | depth:24 (inverted) | program:10 | vao:14 | texture:14
+// so opaque draws group by the most expensive state change and transparent ones stay in
+// back-to-front order. Program/VAO/texture fields hold small ids interned by the queue.
+
+uint64_t MakeSortKey(RenderPass pass, uint32_t programId, uint32_t vaoId, uint32_t textureId, float depth);
+
+// LSD radix sort of keys, 8 bits per pass, carrying values along. Passes where every key has the
+// same byte are skipped. Stable; scratch buffers are resized as needed and can be reused.
+void RadixSortKeys(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+	std::vector<uint64_t>& scratchKeys, std::vector<uint32_t>& scratchValues);
+
+// ===| Render Queue |==========================================================================
+
+// Depth and blend state for drawing a pass through glState
+void ApplyPassState(bool transparent);
+
+struct RenderQueueStats {
+	size_t items = 0;
+	size_t triangles = 0;                    // submitted, whether or not conditional render drops them
+	unsigned int stateChangesUnsorted = 0;   // program/VAO/texture/pass switches in submission order
+	unsigned int stateChangesSorted = 0;     // ... in the order actually drawn
+	double sortMilliseconds = 0.0;
+
+	// Only for recorded frames (Execute with a thread pool)
+	size_t commandBuffers = 0;
+	size_t commandBytes = 0;
+	double recordMilliseconds = 0.0;
+	double replayMilliseconds = 0.0;
+};
+
+class RenderQueue {
+public:
+	void SetSorting(bool enabled) { sorting = enabled; }
+	bool Sorting() const { return sorting; }
+
+	void Begin();
+	void Submit(const DrawItem& item);
+	// Sorts (unless disabled), draws through glState and records the frame's stats
+	void Execute();
+	// Same, but the draws are recorded into buffers on the pool, one contiguous range of the
+	// draw order per buffer, and then replayed in order on the calling (GL) thread
+	void Execute(ThreadPool& pool, std::vector<CommandBuffer>& buffers);
+
+	const RenderQueueStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<RenderQueueStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	static uint32_t Intern(std::unordered_map<unsigned int, uint32_t>& ids, unsigned int name, uint32_t limit);
+	unsigned int CountStateChanges(bool sorted) const;
+	RenderQueueStats Prepare();
+	void Finish(const RenderQueueStats& stats);
+	void Record(CommandBuffer& buffer, size_t begin, size_t end) const;
+
+	bool sorting = true;
+
+	std::vector<DrawItem> items;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint64_t> scratchKeys;
+	std::vector<uint32_t> scratchOrder;
+
+	// GL names -> dense ids that fit the key fields; kept across frames so keys stay stable
+	std::unordered_map<unsigned int, uint32_t> programIds;
+	std::unordered_map<unsigned int, uint32_t> vaoIds;
+	std::unordered_map<unsigned int, uint32_t> textureIds;
+
+	RenderQueueStats lastFrame;
+	std::vector<RenderQueueStats> history;
+};
@@ -0,0 +1,91 @@
+#include "Scene.h"
+#include "Lod.h"
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ===| Object Scene |==========================================================================
+
+static uint32_t hashIndex(size_t i, uint32_t seed) {
+	uint32_t h = static_cast<uint32_t>(i) * 2654435761u ^ seed;
+	h ^= h >> 15;
+	h *= 2246822519u;
+	h ^= h >> 13;
+	return h;
+}
+
+std::vector<SceneObject> MakeObjectScene(size_t count, const std::vector<const GpuMesh*>& meshes,
+	const std::vector<unsigned int>& programs, const std::vector<unsigned int>& textures, size_t layers) {
+
+	// The instance grid already lays copies out over clip space; reuse its placement and tints
+	layers = std::max<size_t>(layers, 1);
+	const size_t cells = std::max<size_t>((count + layers - 1) / layers, 1);
+	const std::vector<InstanceData> grid = MakeInstanceGrid(cells);
+
+	std::vector<SceneObject> objects(count);
+	for (size_t i = 0; i < count; ++i) {
+		SceneObject& object = objects[i];
+		object.mesh = meshes[hashIndex(i, 0x1234u) % meshes.size()];
+		object.program = programs[hashIndex(i, 0x5678u) % programs.size()];
+		object.texture = textures[hashIndex(i, 0xDEF0u) % textures.size()];
+		object.placement = grid[i % cells];
+		object.placement.offsetScale[3] *= 0.5f;   // meshes span [-0.9, 0.9]: keep each inside its cell
+		object.depth = (i / cells + (hashIndex(i, 0x9ABCu) & 0xFFFF) / 65535.0f) / layers;
+		object.placement.offsetScale[2] = object.depth * 2.0f - 1.0f;
+
+		if (i % 8 == 7) {
+			object.pass = RenderPass::Transparent;
+			object.placement.color = (object.placement.color & 0x00FFFFFFu) | (128u << 24);
+		}
+	}
+	return objects;
+}
+
+BoundsSoA MakeObjectBounds(const std::vector<SceneObject>& objects) {
+	// Every mesh fits in [-0.9, 0.9]^2 at z = 0
+	const float meshRadius = 0.9f * std::sqrt(2.0f);
+
+	BoundsSoA bounds;
+	bounds.Resize(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const float* offsetScale = objects[i].placement.offsetScale;
+		bounds.Set(i, offsetScale[0], offsetScale[1], offsetScale[2], meshRadius * offsetScale[3]);
+	}
+	return bounds;
+}
+
+InstanceData PlaceObject(const SceneObject& object, const Mat4& camera) {
+	InstanceData placement = object.placement;
+	float clip[4];
+	camera.TransformPoint(object.placement.offsetScale, clip);
+	placement.offsetScale[0] = clip[0];
+	placement.offsetScale[1] = clip[1];
+	placement.offsetScale[3] *= camera.m[0];
+	return placement;
+}
+
+void SubmitObjects(RenderQueue& queue, const std::vector<SceneObject>& objects, const Mat4& camera,
+	const std::vector<uint32_t>* visible, const OcclusionCuller* occlusion, LodSelector* lod) {
+
+	const size_t count = visible ? visible->size() : objects.size();
+
+	DrawItem item;
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t id = visible ? (*visible)[i] : static_cast<uint32_t>(i);
+		const SceneObject& object = objects[id];
+		item.pass = object.pass;
+		item.program = object.program;
+		item.texture = object.texture;
+		item.mesh = object.mesh;
+		item.depth = object.depth;
+		item.instance = PlaceObject(object, camera);
+		item.conditionQuery = occlusion ? occlusion->ConditionQuery(id) : 0;
+		if (lod) {
+			const LodLevel level = lod->Select(id, object.mesh, item.instance.offsetScale[3]);
+			item.firstIndex = level.firstIndex;
+			item.indexCount = level.indexCount;
+		}
+		queue.Submit(item);
+	}
+}
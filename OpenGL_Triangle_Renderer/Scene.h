@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Culling.h"
+#include "Instancing.h"
+#include "MathUtil.h"
+#include "RenderQueue.h"
+
+struct GpuMesh;
+class LodSelector;
+class OcclusionCuller;
+
+// ===| Object Scene |==========================================================================
+//
+// Many independent objects, each with its own mesh, program and placement: the workload the
+// render queue is meant for, as opposed to one mesh drawn many times by instancing.
+
+struct SceneObject {
+	const GpuMesh* mesh = NULL;
+	unsigned int program = 0;
+	unsigned int texture = 0;
+	RenderPass pass = RenderPass::Opaque;
+	InstanceData placement;   // offset/scale and tint, alpha < 1 for transparent objects
+	float depth = 0.0f;
+};
+
+// count objects on a grid over clip space, with meshes, programs and textures assigned in a
+// scrambled order (so submission order alone does not group state) and every 8th object
+// transparent. With layers > 1 each grid cell holds that many objects one behind the other.
+std::vector<SceneObject> MakeObjectScene(size_t count, const std::vector<const GpuMesh*>& meshes,
+	const std::vector<unsigned int>& programs, const std::vector<unsigned int>& textures, size_t layers = 1);
+
+// Bounding spheres of the objects in the space their placement is given in
+BoundsSoA MakeObjectBounds(const std::vector<SceneObject>& objects);
+
+// The object's placement as seen through camera, which must be a Mat4::Camera2D: offsets and
+// scales are transformed on the CPU, so the shaders need no camera
+InstanceData PlaceObject(const SceneObject& object, const Mat4& camera);
+
+// Submits the objects listed in visible (all of them when NULL) as seen through camera. With an
+// occlusion culler, each draw is made conditional on the object's pending occlusion query; with
+// an LOD selector, each object draws the level its on-screen size calls for.
+void SubmitObjects(RenderQueue& queue, const std::vector<SceneObject>& objects, const Mat4& camera,
+	const std::vector<uint32_t>* visible = NULL, const OcclusionCuller* occlusion = NULL, LodSelector* lod = NULL);
@@ -0,0 +1,205 @@
+#include "ShaderManager.h"
+#include "GLExtensions.h"
+#include "MappedFile.h"
+#include "ProgramCache.h"
+#include "StateCache.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <string_view>
+
+// ===| Load Shader Programs |==================================================================
+
+// Maps the whole file in one go: no per-line strings, no regrowing of the output buffer
+static MappedFile LoadShaderProgram(const std::string& filename) {
+	MappedFile file;
+	if (!file.Open(filename))
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << filename << "\n";
+	return file;
+}
+
+// Hands the source to GL with explicit lengths, so nothing needs to be NUL-terminated or copied.
+// Defines go right after the #version line, which GLSL requires to come first.
+static void ShaderSource(unsigned int shader, std::string_view source, std::string_view defines) {
+	size_t split = 0;
+	size_t version = source.find("#version");
+	if (version != std::string_view::npos) {
+		size_t lineEnd = source.find('\n', version);
+		split = lineEnd == std::string_view::npos ? source.size() : lineEnd + 1;
+	}
+
+	const char* strings[3] = { source.data(), defines.data(), source.data() + split };
+	const GLint lengths[3] = {
+		static_cast<GLint>(split),
+		static_cast<GLint>(defines.size()),
+		static_cast<GLint>(source.size() - split)
+	};
+	glShaderSource(shader, 3, strings, lengths);
+}
+
+static unsigned int SubmitShader(GLenum stage, std::string_view source, std::string_view defines) {
+	unsigned int shader = glCreateShader(stage);
+	ShaderSource(shader, source, defines);
+	glCompileShader(shader);   // no status query here: that would wait for the compile to finish
+	return shader;
+}
+
+static void ReportShaderErrors(unsigned int shader, const char* stageName, const std::string& programName) {
+	int success;
+	char infoLog[512];
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED (" << programName << ")\n" << infoLog << "\n";
+	}
+}
+
+// ===| Shader Manager |========================================================================
+
+ShaderManager::ShaderManager(ProgramCache& cache, ThreadPool& pool)
+	: cache(cache), pool(pool) {
+}
+
+ShaderManager::~ShaderManager() {
+	for (ProgramEntry& entry : programs) {
+		glDeleteShader(entry.vertexShader);
+		glDeleteShader(entry.fragmentShader);
+		glState.OnProgramDeleted(entry.program);
+		glDeleteProgram(entry.program);
+	}
+}
+
+size_t ShaderManager::Add(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+	const std::string& defines) {
+	ProgramEntry entry;
+	entry.name = name;
+	entry.vertexPath = vertexPath;
+	entry.fragmentPath = fragmentPath;
+	entry.defines = defines;
+	programs.push_back(entry);
+	return programs.size() - 1;
+}
+
+unsigned int ShaderManager::Program(const std::string& name) const {
+	for (const ProgramEntry& entry : programs) {
+		if (entry.name == name)
+			return entry.program;
+	}
+	return 0;
+}
+
+bool ShaderManager::FinishProgram(ProgramEntry& entry) {
+	int success;
+	char infoLog[512];
+	glGetProgramiv(entry.program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// Compile errors explain most link failures, so report those first
+		ReportShaderErrors(entry.vertexShader, "VERTEX", entry.name);
+		ReportShaderErrors(entry.fragmentShader, "FRAGMENT", entry.name);
+		glGetProgramInfoLog(entry.program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED (" << entry.name << ")\n" << infoLog << "\n";
+	}
+	else {
+		cache.Store(entry.cacheKey, entry.program);
+	}
+
+	// Deleting individual shaders after linking
+	glDetachShader(entry.program, entry.vertexShader);
+	glDetachShader(entry.program, entry.fragmentShader);
+	glDeleteShader(entry.vertexShader);
+	glDeleteShader(entry.fragmentShader);
+	entry.vertexShader = 0;
+	entry.fragmentShader = 0;
+	entry.built = true;
+	return success != 0;
+}
+
+bool ShaderManager::BuildAll() {
+	const auto start = std::chrono::steady_clock::now();
+	lastBuildCacheHits = 0;
+
+	// 1. Map every distinct shader file on the thread pool
+	std::map<std::string, std::future<MappedFile>> pendingFiles;
+	for (const ProgramEntry& entry : programs) {
+		if (entry.built)
+			continue;
+		for (const std::string* path : { &entry.vertexPath, &entry.fragmentPath }) {
+			if (pendingFiles.find(*path) == pendingFiles.end())
+				pendingFiles[*path] = pool.Submit([filename = *path]() { return LoadShaderProgram(filename); });
+		}
+	}
+	std::map<std::string, MappedFile> files;
+	for (auto& pending : pendingFiles)
+		files[pending.first] = pending.second.get();
+
+	// 2. Restore cached binaries and submit every remaining compile and link
+	if (glExt.parallelShaderCompile)
+		glExt.MaxShaderCompilerThreads(0xFFFFFFFFu);   // let the driver pick its thread count
+
+	std::vector<ProgramEntry*> linking;
+	for (ProgramEntry& entry : programs) {
+		if (entry.built)
+			continue;
+
+		std::string_view vertexSource = files[entry.vertexPath].View();
+		std::string_view fragmentSource = files[entry.fragmentPath].View();
+		entry.cacheKey = cache.MakeKey({ vertexSource, fragmentSource, entry.defines });
+
+		entry.program = cache.Load(entry.cacheKey);
+		if (entry.program != 0) {
+			entry.built = true;
+			++lastBuildCacheHits;
+			continue;
+		}
+
+		entry.vertexShader = SubmitShader(GL_VERTEX_SHADER, vertexSource, entry.defines);
+		entry.fragmentShader = SubmitShader(GL_FRAGMENT_SHADER, fragmentSource, entry.defines);
+
+		entry.program = glCreateProgram();
+		glAttachShader(entry.program, entry.vertexShader);
+		glAttachShader(entry.program, entry.fragmentShader);
+		cache.PrepareForRetrieval(entry.program);
+		glLinkProgram(entry.program);
+		linking.push_back(&entry);
+	}
+
+	// 3. Collect link results. Without the extension any status query blocks, so simply go in
+	//    order; with it, finish whatever has completed and only block when nothing has.
+	bool allLinked = true;
+	size_t remaining = linking.size();
+	while (remaining > 0) {
+		bool progressed = false;
+		for (ProgramEntry*& entry : linking) {
+			if (entry == nullptr)
+				continue;
+
+			GLint completed = GL_TRUE;
+			if (glExt.parallelShaderCompile)
+				glGetProgramiv(entry->program, GL_COMPLETION_STATUS_KHR, &completed);
+			if (!completed)
+				continue;
+
+			allLinked &= FinishProgram(*entry);
+			entry = nullptr;
+			--remaining;
+			progressed = true;
+		}
+
+		if (!progressed) {
+			for (ProgramEntry*& entry : linking) {
+				if (entry != nullptr) {
+					allLinked &= FinishProgram(*entry);
+					entry = nullptr;
+					--remaining;
+					break;
+				}
+			}
+		}
+	}
+
+	lastBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return allLinked;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ProgramCache;
+class ThreadPool;
+
+// ===| Shader Manager |========================================================================
+//
+// Builds every registered program in one batch instead of compile-check-link per program:
+//   1. shader files are mapped on the thread pool,
+//   2. cache hits are restored, every other compile and link is submitted without any status
+//      query in between (with KHR_parallel_shader_compile the driver compiles on its threads),
+//   3. only then are link results collected, in completion order where the driver can tell.
+
+class ShaderManager {
+public:
+	ShaderManager(ProgramCache& cache, ThreadPool& pool);
+	~ShaderManager();
+
+	ShaderManager(const ShaderManager&) = delete;
+	ShaderManager& operator=(const ShaderManager&) = delete;
+
+	// defines are inserted after the #version line of both stages, e.g. "#define INSTANCED 1\n"
+	size_t Add(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+		const std::string& defines = "");
+
+	// Builds everything added since the last call. Returns false if any program failed.
+	bool BuildAll();
+
+	unsigned int Program(size_t index) const { return programs[index].program; }
+	unsigned int Program(const std::string& name) const;
+	size_t ProgramCount() const { return programs.size(); }
+
+	double LastBuildMilliseconds() const { return lastBuildMs; }
+	unsigned int LastBuildCacheHits() const { return lastBuildCacheHits; }
+
+private:
+	struct ProgramEntry {
+		std::string name;
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::string defines;
+
+		unsigned int program = 0;
+		unsigned int vertexShader = 0;
+		unsigned int fragmentShader = 0;
+		uint64_t cacheKey = 0;
+		bool built = false;
+	};
+
+	bool FinishProgram(ProgramEntry& entry);
+
+	ProgramCache& cache;
+	ThreadPool& pool;
+	std::vector<ProgramEntry> programs;
+	double lastBuildMs = 0.0;
+	unsigned int lastBuildCacheHits = 0;
+};
@@ -0,0 +1,117 @@
+#include "Simulation.h"
+#include "DynamicMesh.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ===| Simulation |============================================================================
+
+// Further behind than this, the simulation skips ahead instead of running every missed step
+static const int64_t MAX_CATCH_UP_STEPS = 4;
+
+static double milliseconds(std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void CameraPan(double time, float& x, float& y) {
+	x = static_cast<float>(std::cos(time * 0.3));
+	y = static_cast<float>(std::sin(time * 0.2));
+}
+
+Simulation::Simulation(const DynamicMesh* mesh, double rate)
+	: mesh(mesh), rate(std::max(rate, 1.0)) {
+	period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / this->rate));
+	start = Clock::now();
+
+	SimState previous, current;
+	SimulateStep(0, previous);
+	SimulateStep(1, current);
+	SimSnapshot& first = snapshots.Back();
+	first.step = 1;
+	first.previous = previous;
+	first.current = current;
+	snapshots.Publish();
+
+	thread = std::thread(&Simulation::ThreadMain, this, std::move(previous), std::move(current));
+}
+
+Simulation::~Simulation() {
+	Stop();
+}
+
+void Simulation::Stop() {
+	stopping.store(true, std::memory_order_relaxed);
+	if (thread.joinable())
+		thread.join();
+}
+
+void Simulation::SimulateStep(int64_t step, SimState& state) const {
+	const double time = static_cast<double>(step) / rate;
+	if (mesh)
+		mesh->Simulate(time, state.positions);
+	CameraPan(time, state.panX, state.panY);
+}
+
+void Simulation::ThreadMain(SimState previous, SimState current) {
+	int64_t step = 1;
+	while (!stopping.load(std::memory_order_relaxed)) {
+		// Step k is computed once the clock passes (k - 1) * dt, a step ahead of its time
+		int64_t next = step + 1;
+		const Clock::time_point due = start + period * (next - 1);
+		std::this_thread::sleep_until(due);
+		const Clock::time_point begin = Clock::now();
+
+		const int64_t onTime = static_cast<int64_t>((begin - start) / period) + 1;
+		if (onTime - next > MAX_CATCH_UP_STEPS) {
+			stats.skipped += static_cast<size_t>(onTime - next);
+			next = onTime;
+			SimulateStep(next - 1, previous);
+		}
+		else {
+			std::swap(previous, current);
+		}
+		SimulateStep(next, current);
+
+		// Assigning keeps the slot's capacity: after the first few steps nothing is allocated
+		SimSnapshot& snapshot = snapshots.Back();
+		snapshot.step = next;
+		snapshot.previous = previous;
+		snapshot.current = current;
+		snapshots.Publish();
+		step = next;
+
+		SimStepStats stepStats;
+		stepStats.stepMilliseconds = milliseconds(Clock::now() - begin);
+		stepStats.lateMilliseconds = milliseconds(begin - due);
+		AppendHistory(steps, stepStats);
+		++stats.steps;
+	}
+}
+
+void Simulation::Sample() {
+	const Clock::time_point begin = Clock::now();
+	SimFrameStats frame;
+	frame.fresh = snapshots.Update();
+	const SimSnapshot& snapshot = snapshots.Front();
+
+	// How far the clock is past the previous state, in steps; past 1 the simulation is behind
+	const double elapsedSteps = std::chrono::duration<double>(begin - start).count() * rate;
+	double alpha = elapsedSteps - static_cast<double>(snapshot.step - 1);
+	frame.stale = alpha > 1.0;
+	alpha = std::min(std::max(alpha, 0.0), 1.0);
+	frame.alpha = alpha;
+
+	const float t = static_cast<float>(alpha);
+	const std::vector<float>& from = snapshot.previous.positions;
+	const std::vector<float>& to = snapshot.current.positions;
+	positions.resize(to.size());
+	for (size_t i = 0; i < to.size(); ++i)
+		positions[i] = from[i] + (to[i] - from[i]) * t;
+	panX = snapshot.previous.panX + (snapshot.current.panX - snapshot.previous.panX) * t;
+	panY = snapshot.previous.panY + (snapshot.current.panY - snapshot.previous.panY) * t;
+
+	frame.sampleMilliseconds = milliseconds(Clock::now() - begin);
+	lastFrame = frame;
+	AppendHistory(history, frame);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "TripleBuffer.h"
+
+class DynamicMesh;
+
+// ===| Simulation |============================================================================
+//
+// Steps the animated state at a fixed rate on a thread of its own, so simulating and drawing
+// overlap on different cores and a frame never waits for a step:
+//   1. step k holds the state at time k * dt. It is computed as soon as the clock passes
+//      (k - 1) * dt, a step ahead of when it is needed, and published together with step
+//      k - 1 through a lock-free triple buffer,
+//   2. every frame, the renderer takes the newest snapshot and interpolates between its two
+//      states at the current time, so motion stays smooth whatever the frame rate is,
+//   3. when the simulation falls behind, the renderer holds the newest state (a stale frame)
+//      rather than wait for it; more than a few steps behind, the simulation skips ahead
+//      instead of running every missed step.
+// The state is the dynamic mesh's vertices (when there is one) and the camera pan.
+
+// The camera's pan at time, x and y in [-1, 1]
+void CameraPan(double time, float& x, float& y);
+
+struct SimState {
+	std::vector<float> positions;        // dynamic mesh vertices, xyz
+	float panX = 0.0f;
+	float panY = 0.0f;
+};
+
+struct SimSnapshot {
+	int64_t step = 0;
+	SimState previous;                   // at step - 1
+	SimState current;                    // at step
+};
+
+struct SimStepStats {
+	double stepMilliseconds = 0.0;       // simulating and publishing the step
+	double lateMilliseconds = 0.0;       // how long after it was due the step started
+};
+
+struct SimFrameStats {
+	double alpha = 0.0;                  // interpolation weight of the current state
+	bool fresh = false;                  // a new snapshot arrived for this frame
+	bool stale = false;                  // the newest state was already in the past: held
+	double sampleMilliseconds = 0.0;     // taking the snapshot and interpolating it
+};
+
+struct SimStats {
+	size_t steps = 0;
+	size_t skipped = 0;                  // steps dropped to catch up
+};
+
+class Simulation {
+public:
+	// mesh: when set, its vertices are simulated too; rate: steps per second.
+	// The first snapshot is published before the thread starts, so Sample() always has one.
+	Simulation(const DynamicMesh* mesh, double rate = 60.0);
+	~Simulation();
+
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	// Render thread, once per frame: takes the newest snapshot and interpolates it to now
+	void Sample();
+	const std::vector<float>& Positions() const { return positions; }
+	float PanX() const { return panX; }
+	float PanY() const { return panY; }
+
+	double Rate() const { return rate; }
+
+	// Stops the thread; the step statistics are only read after this
+	void Stop();
+	const SimStats& Stats() const { return stats; }
+	const std::vector<SimStepStats>& StepHistory() const { return steps; }
+
+	const SimFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<SimFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void SimulateStep(int64_t step, SimState& state) const;
+	void ThreadMain(SimState previous, SimState current);
+
+	const DynamicMesh* mesh;
+	double rate;
+	Clock::duration period;
+	Clock::time_point start;
+
+	TripleBuffer<SimSnapshot> snapshots;
+	std::thread thread;
+	std::atomic<bool> stopping{ false };
+
+	// Simulation thread only, until Stop()
+	SimStats stats;
+	std::vector<SimStepStats> steps;
+
+	// Render thread only
+	std::vector<float> positions;
+	float panX = 0.0f;
+	float panY = 0.0f;
+	SimFrameStats lastFrame;
+	std::vector<SimFrameStats> history;
+};
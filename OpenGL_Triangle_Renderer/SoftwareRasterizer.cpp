@@ -0,0 +1,588 @@
+#include "SoftwareRasterizer.h"
+#include "FrameHistory.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define RASTER_TARGET_AVX2
+#else
+#define RASTER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// ===| Raster Mesh |===========================================================================
+
+static void decodeAttribute(AttribFormat format, const unsigned char* src, float out[4]) {
+	switch (format) {
+	case AttribFormat::Float3:
+		std::memcpy(out, src, 3 * sizeof(float));
+		break;
+	case AttribFormat::Float2:
+		std::memcpy(out, src, 2 * sizeof(float));
+		break;
+	case AttribFormat::Half4:
+	case AttribFormat::Half2: {
+		uint16_t half[3] = {};
+		std::memcpy(half, src, (format == AttribFormat::Half4 ? 3 : 2) * sizeof(uint16_t));
+		for (int c = 0; c < 3; ++c)
+			out[c] = HalfToFloat(half[c]);
+		break;
+	}
+	case AttribFormat::UNorm8x4:
+		for (int c = 0; c < 4; ++c)
+			out[c] = src[c] / 255.0f;
+		break;
+	}
+}
+
+RasterMesh MakeRasterMesh(const Mesh& mesh, const VertexLayout& layout) {
+	RasterMesh raster;
+	raster.indices = mesh.indices;
+
+	const size_t count = mesh.VertexCount();
+	const std::vector<unsigned char> packed = PackVertices(layout, mesh.Streams());
+	const VertexAttribute* position = layout.Find(ATTRIB_POSITION);
+	const VertexAttribute* color = layout.Find(ATTRIB_COLOR);
+
+	// An attribute missing from the layout reads as GL's default: zeros
+	raster.positions.assign(count * 3, 0.0f);
+	raster.colors.assign(count * 3, 0.0f);
+	for (size_t i = 0; i < count; ++i) {
+		const unsigned char* vertex = packed.data() + i * layout.Stride();
+		float value[4] = {};
+		if (position) {
+			decodeAttribute(position->format, vertex + position->offset, value);
+			std::copy_n(value, 3, &raster.positions[i * 3]);
+		}
+		if (color) {
+			decodeAttribute(color->format, vertex + color->offset, value);
+			std::copy_n(value, 3, &raster.colors[i * 3]);
+		}
+	}
+	return raster;
+}
+
+// ===| Triangle Setup |========================================================================
+
+struct ClipVertex {
+	float position[4];   // clip space
+	float color[4];
+};
+
+// Plane distances in clip space, inside when >= 0: the four viewport sides and near/far, then
+// the four guard band sides
+static const int CLIP_PLANES = 10;
+static const unsigned VIEWPORT_PLANES = 0x3F;
+static const unsigned MUST_CLIP_PLANES = 0x3F0;   // near/far and the guard band
+
+static float planeDistance(const float* p, int plane, float guardX, float guardY) {
+	switch (plane) {
+	case 0: return p[3] - p[0];
+	case 1: return p[3] + p[0];
+	case 2: return p[3] - p[1];
+	case 3: return p[3] + p[1];
+	case 4: return p[3] - p[2];
+	case 5: return p[3] + p[2];
+	case 6: return guardX * p[3] - p[0];
+	case 7: return guardX * p[3] + p[0];
+	case 8: return guardY * p[3] - p[1];
+	default: return guardY * p[3] + p[1];
+	}
+}
+
+static unsigned outcode(const ClipVertex& v, float guardX, float guardY) {
+	unsigned code = 0;
+	for (int plane = 0; plane < CLIP_PLANES; ++plane) {
+		if (planeDistance(v.position, plane, guardX, guardY) < 0.0f)
+			code |= 1u << plane;
+	}
+	return code;
+}
+
+// Sutherland-Hodgman against every plane in planes; attributes are interpolated linearly in
+// clip space, as GL does. Returns the vertex count of the clipped polygon.
+static int clipPolygon(ClipVertex* polygon, int count, unsigned planes, float guardX, float guardY) {
+	ClipVertex scratch[16];
+	ClipVertex* in = polygon;
+	ClipVertex* out = scratch;
+	for (int plane = 0; plane < CLIP_PLANES && count > 0; ++plane) {
+		if (!(planes & (1u << plane)))
+			continue;
+
+		int written = 0;
+		for (int i = 0; i < count; ++i) {
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[(i + 1) % count];
+			const float da = planeDistance(a.position, plane, guardX, guardY);
+			const float db = planeDistance(b.position, plane, guardX, guardY);
+			if (da >= 0.0f)
+				out[written++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				const float t = da / (da - db);
+				ClipVertex& v = out[written++];
+				for (int c = 0; c < 4; ++c) {
+					v.position[c] = a.position[c] + t * (b.position[c] - a.position[c]);
+					v.color[c] = a.color[c] + t * (b.color[c] - a.color[c]);
+				}
+			}
+		}
+		count = written;
+		std::swap(in, out);
+	}
+	if (in != polygon)
+		std::copy_n(in, count, polygon);
+	return count;
+}
+
+static int64_t floorDiv(int64_t value, int64_t divisor) {
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Snaps, orients and sets up one triangle; false when it covers no pixel center
+static bool setupTriangle(const ClipVertex* v[3], int width, int height, SoftwareRasterizer::Triangle& t) {
+	const int subpixels = 1 << SoftwareRasterizer::SUBPIXEL_BITS;
+	const int64_t half = subpixels / 2;
+
+	int64_t X[3], Y[3];
+	for (int k = 0; k < 3; ++k) {
+		const double invW = 1.0 / v[k]->position[3];
+		X[k] = std::llround((v[k]->position[0] * invW * 0.5 + 0.5) * width * subpixels);
+		Y[k] = std::llround((v[k]->position[1] * invW * 0.5 + 0.5) * height * subpixels);
+	}
+
+	// Counter-clockwise from here on; there is no face culling, so clockwise ones are flipped
+	int order[3] = { 0, 1, 2 };
+	int64_t area2 = (X[1] - X[0]) * (Y[2] - Y[0]) - (X[2] - X[0]) * (Y[1] - Y[0]);
+	if (area2 == 0)
+		return false;
+	if (area2 < 0) {
+		std::swap(order[1], order[2]);
+		area2 = -area2;
+	}
+	const int64_t x[3] = { X[order[0]], X[order[1]], X[order[2]] };
+	const int64_t y[3] = { Y[order[0]], Y[order[1]], Y[order[2]] };
+
+	// Pixel centers sit at subpixel (px * 16 + 8, py * 16 + 8)
+	const int64_t minX = std::max<int64_t>(floorDiv(std::min({ x[0], x[1], x[2] }) - half + subpixels - 1, subpixels), 0);
+	const int64_t maxX = std::min<int64_t>(floorDiv(std::max({ x[0], x[1], x[2] }) - half, subpixels), width - 1);
+	const int64_t minY = std::max<int64_t>(floorDiv(std::min({ y[0], y[1], y[2] }) - half + subpixels - 1, subpixels), 0);
+	const int64_t maxY = std::min<int64_t>(floorDiv(std::max({ y[0], y[1], y[2] }) - half, subpixels), height - 1);
+	if (minX > maxX || minY > maxY)
+		return false;
+	t.minX = static_cast<int32_t>(minX);
+	t.maxX = static_cast<int32_t>(maxX);
+	t.minY = static_cast<int32_t>(minY);
+	t.maxY = static_cast<int32_t>(maxY);
+
+	for (int k = 0; k < 3; ++k) {
+		const int a = (k + 1) % 3;
+		const int b = (k + 2) % 3;
+		const int64_t A = y[a] - y[b];
+		const int64_t B = x[b] - x[a];
+		// Top-left rule: samples exactly on an edge belong to the triangle only for left edges
+		// and horizontal top edges, so triangles sharing an edge never both draw a pixel
+		const bool topLeft = A > 0 || (A == 0 && B < 0);
+		t.A[k] = static_cast<int32_t>(A);
+		t.B[k] = static_cast<int32_t>(B);
+		t.C[k] = -(A * x[a] + B * y[a]) - (topLeft ? 0 : 1);
+	}
+
+	// color = c0 + l1 (c1 - c0) + l2 (c2 - c0), with l_k = E_k / area2 and E_1, E_2 zero at v0
+	for (int c = 0; c < 4; ++c) {
+		const double c0 = v[order[0]]->color[c];
+		const double d1 = v[order[1]]->color[c] - c0;
+		const double d2 = v[order[2]]->color[c] - c0;
+		const double gx = (d1 * t.A[1] + d2 * t.A[2]) / static_cast<double>(area2);
+		const double gy = (d1 * t.B[1] + d2 * t.B[2]) / static_cast<double>(area2);
+		t.base[c] = static_cast<float>(c0 + gx * (half - x[0]) + gy * (half - y[0]));
+		t.ddx[c] = static_cast<float>(gx * subpixels);
+		t.ddy[c] = static_cast<float>(gy * subpixels);
+	}
+	return true;
+}
+
+// ===| Software Rasterizer |===================================================================
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool& pool, int width, int height)
+	: pool(pool), width(std::max(width, 1)), height(std::max(height, 1)) {
+	stride = (this->width + 7) & ~7;
+	tilesX = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+	color.assign(static_cast<size_t>(stride) * this->height, 0);
+	tilePixels.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+}
+
+static uint32_t packColor(float r, float g, float b, float a) {
+	const auto channel = [](float value) {
+		return static_cast<uint32_t>(std::lrint(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+	};
+	return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+}
+
+void SoftwareRasterizer::Clear(float r, float g, float b, float a) {
+	clearColor = packColor(r, g, b, a);
+	clearPending = true;
+}
+
+void SoftwareRasterizer::SetupRange(const RasterMesh& mesh, const std::vector<InstanceData>& instances,
+	size_t begin, size_t end, Chunk& chunk) const {
+
+	chunk.triangles.clear();
+	chunk.bins.resize(static_cast<size_t>(tilesX) * tilesY);
+	for (std::vector<uint32_t>& bin : chunk.bins)
+		bin.clear();
+	chunk.stats = RasterFrameStats();
+
+	// Guard band in NDC units per axis: window coordinates stay within +-GUARD_PIXELS
+	const float guardX = std::max(GUARD_PIXELS / (width * 0.5f) - 1.0f, 1.0f);
+	const float guardY = std::max(GUARD_PIXELS / (height * 0.5f) - 1.0f, 1.0f);
+
+	const size_t triangleCount = mesh.TriangleCount();
+	const InstanceData defaultInstance = { { 0.0f, 0.0f, 0.0f, 1.0f }, 0xFFFFFFFFu };
+
+	for (size_t primitive = begin; primitive < end; ++primitive) {
+		const InstanceData& instance = instances.empty() ? defaultInstance : instances[primitive / triangleCount];
+		const size_t triangle = primitive % triangleCount;
+		const float* offsetScale = instance.offsetScale;
+		const float tint[4] = { (instance.color & 0xFF) / 255.0f, ((instance.color >> 8) & 0xFF) / 255.0f,
+			((instance.color >> 16) & 0xFF) / 255.0f, (instance.color >> 24) / 255.0f };
+		++chunk.stats.triangles;
+
+		// vertexShader.glsl: position * scale + offset, color * tint.rgb with the tint's alpha
+		ClipVertex polygon[16];
+		unsigned codeAnd = ~0u, codeOr = 0;
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t index = mesh.indices[triangle * 3 + k];
+			ClipVertex& v = polygon[k];
+			for (int c = 0; c < 3; ++c) {
+				v.position[c] = mesh.positions[index * 3 + c] * offsetScale[3] + offsetScale[c];
+				v.color[c] = mesh.colors[index * 3 + c] * tint[c];
+			}
+			v.position[3] = 1.0f;
+			v.color[3] = tint[3];
+			const unsigned code = outcode(v, guardX, guardY);
+			codeAnd &= code;
+			codeOr |= code;
+		}
+
+		if (codeAnd & VIEWPORT_PLANES) {
+			++chunk.stats.culled;
+			continue;
+		}
+
+		int count = 3;
+		if (codeOr & MUST_CLIP_PLANES) {
+			count = clipPolygon(polygon, 3, codeOr & MUST_CLIP_PLANES, guardX, guardY);
+			++chunk.stats.clipped;
+		}
+
+		bool any = false;
+		for (int k = 1; k + 1 < count; ++k) {
+			const ClipVertex* fan[3] = { &polygon[0], &polygon[k], &polygon[k + 1] };
+			Triangle t;
+			if (!setupTriangle(fan, width, height, t))
+				continue;
+			any = true;
+
+			const uint32_t id = static_cast<uint32_t>(chunk.triangles.size());
+			chunk.triangles.push_back(t);
+			for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ++ty) {
+				for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; ++tx) {
+					chunk.bins[static_cast<size_t>(ty) * tilesX + tx].push_back(id);
+					++chunk.stats.binned;
+				}
+			}
+		}
+		if (!any)
+			++chunk.stats.culled;
+	}
+}
+
+void SoftwareRasterizer::Draw(const RasterMesh& mesh, const std::vector<InstanceData>& instances) {
+	const auto start = std::chrono::steady_clock::now();
+	const size_t primitives = mesh.TriangleCount() * std::max<size_t>(instances.size(), 1);
+	if (primitives == 0)
+		return;
+
+	// Fixed chunk boundaries, so the bins (and the image) do not depend on thread timing
+	const size_t chunkCount = std::min<size_t>(primitives, (pool.ThreadCount() + 1) * 4);
+	if (chunks.size() < usedChunks + chunkCount)
+		chunks.resize(usedChunks + chunkCount);
+
+	const size_t first = usedChunks;
+	pool.ParallelFor(chunkCount, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c)
+			SetupRange(mesh, instances, primitives * c / chunkCount, primitives * (c + 1) / chunkCount, chunks[first + c]);
+	});
+	usedChunks += chunkCount;
+	frame.setupMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ===| Tile Rasterization |====================================================================
+
+// Edge values at pixel (x0, y0) of a rectangle and their steps per pixel, all within 32 bits
+struct RectEdges {
+	int32_t e[3];
+	int32_t dx[3];
+	int32_t dy[3];
+};
+
+// False when an edge excludes the whole rectangle. Edges that include all of it are zeroed so
+// they neither reject anything nor overflow.
+static bool setupRectEdges(const SoftwareRasterizer::Triangle& t, int x0, int y0, int x1, int y1, RectEdges& edges) {
+	const int subpixels = 1 << SoftwareRasterizer::SUBPIXEL_BITS;
+	for (int k = 0; k < 3; ++k) {
+		const int64_t dx = static_cast<int64_t>(t.A[k]) * subpixels;
+		const int64_t dy = static_cast<int64_t>(t.B[k]) * subpixels;
+		const int64_t e = static_cast<int64_t>(t.A[k]) * (x0 * subpixels + subpixels / 2)
+			+ static_cast<int64_t>(t.B[k]) * (y0 * subpixels + subpixels / 2) + t.C[k];
+		const int64_t spanX = dx * (x1 - 1 - x0);
+		const int64_t spanY = dy * (y1 - 1 - y0);
+		const int64_t lowest = e + std::min<int64_t>(spanX, 0) + std::min<int64_t>(spanY, 0);
+		const int64_t highest = e + std::max<int64_t>(spanX, 0) + std::max<int64_t>(spanY, 0);
+		if (highest < 0)
+			return false;
+		if (lowest >= 0) {
+			edges.e[k] = edges.dx[k] = edges.dy[k] = 0;
+			continue;
+		}
+		edges.e[k] = static_cast<int32_t>(e);
+		edges.dx[k] = static_cast<int32_t>(dx);
+		edges.dy[k] = static_cast<int32_t>(dy);
+	}
+	return true;
+}
+
+static size_t rasterScalar(const SoftwareRasterizer::Triangle& t, const RectEdges& edges,
+	int x0, int y0, int x1, int y1, uint32_t* pixels, int stride) {
+	size_t written = 0;
+	int32_t row[3] = { edges.e[0], edges.e[1], edges.e[2] };
+	for (int y = y0; y < y1; ++y) {
+		float rowColor[4];
+		for (int c = 0; c < 4; ++c)
+			rowColor[c] = t.base[c] + t.ddy[c] * static_cast<float>(y);
+
+		int32_t e[3] = { row[0], row[1], row[2] };
+		uint32_t* out = pixels + static_cast<size_t>(y) * stride;
+		for (int x = x0; x < x1; ++x) {
+			if ((e[0] | e[1] | e[2]) >= 0) {
+				const float fx = static_cast<float>(x);
+				out[x] = packColor(rowColor[0] + t.ddx[0] * fx, rowColor[1] + t.ddx[1] * fx,
+					rowColor[2] + t.ddx[2] * fx, rowColor[3] + t.ddx[3] * fx);
+				++written;
+			}
+			for (int k = 0; k < 3; ++k)
+				e[k] += edges.dx[k];
+		}
+		for (int k = 0; k < 3; ++k)
+			row[k] += edges.dy[k];
+	}
+	return written;
+}
+
+#ifdef RASTER_X86
+static size_t rasterSSE(const SoftwareRasterizer::Triangle& t, const RectEdges& edges,
+	int x0, int y0, int x1, int y1, uint32_t* pixels, int stride) {
+	// Groups of 4 aligned to 4 pixels: tiles and padded rows are multiples of 8, so a group never
+	// leaves the tile, and masked-off lanes rewrite what this thread already owns
+	const int start = x0 & ~3;
+	const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i first = _mm_set1_epi32(x0 - 1);
+	const __m128i last = _mm_set1_epi32(x1);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128i laneSteps[3], groupStep[3];
+	int32_t row[3];
+	for (int k = 0; k < 3; ++k) {
+		laneSteps[k] = _mm_set_epi32(3 * edges.dx[k], 2 * edges.dx[k], edges.dx[k], 0);
+		groupStep[k] = _mm_set1_epi32(4 * edges.dx[k]);
+		row[k] = edges.e[k] + (start - x0) * edges.dx[k];
+	}
+
+	size_t written = 0;
+	for (int y = y0; y < y1; ++y) {
+		__m128 rowColor[4], ddx[4];
+		for (int c = 0; c < 4; ++c) {
+			rowColor[c] = _mm_set1_ps(t.base[c] + t.ddy[c] * static_cast<float>(y));
+			ddx[c] = _mm_set1_ps(t.ddx[c]);
+		}
+
+		__m128i e[3];
+		for (int k = 0; k < 3; ++k)
+			e[k] = _mm_add_epi32(_mm_set1_epi32(row[k]), laneSteps[k]);
+		uint32_t* out = pixels + static_cast<size_t>(y) * stride;
+
+		for (int x = start; x < x1; x += 4) {
+			const __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+			const __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(xs, first), _mm_cmplt_epi32(xs, last));
+			const __m128i sign = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e[0], e[1]), e[2]), 31);
+			const __m128i covered = _mm_andnot_si128(sign, inside);
+			const int mask = _mm_movemask_ps(_mm_castsi128_ps(covered));
+			if (mask) {
+				const __m128 fx = _mm_cvtepi32_ps(xs);
+				__m128i packed = _mm_setzero_si128();
+				for (int c = 0; c < 4; ++c) {
+					__m128 value = _mm_add_ps(rowColor[c], _mm_mul_ps(ddx[c], fx));
+					value = _mm_mul_ps(_mm_min_ps(_mm_max_ps(value, zero), one), scale);
+					packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvtps_epi32(value), c * 8));
+				}
+				__m128i* target = reinterpret_cast<__m128i*>(out + x);
+				const __m128i previous = _mm_loadu_si128(target);
+				_mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(covered, packed), _mm_andnot_si128(covered, previous)));
+				written += static_cast<size_t>((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+			}
+			for (int k = 0; k < 3; ++k)
+				e[k] = _mm_add_epi32(e[k], groupStep[k]);
+		}
+		for (int k = 0; k < 3; ++k)
+			row[k] += edges.dy[k];
+	}
+	return written;
+}
+
+RASTER_TARGET_AVX2
+static size_t rasterAVX2(const SoftwareRasterizer::Triangle& t, const RectEdges& edges,
+	int x0, int y0, int x1, int y1, uint32_t* pixels, int stride) {
+	const int start = x0 & ~7;
+	const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	const __m256i first = _mm256_set1_epi32(x0 - 1);
+	const __m256i last = _mm256_set1_epi32(x1);
+	const __m256 scale = _mm256_set1_ps(255.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	__m256i laneSteps[3], groupStep[3];
+	int32_t row[3];
+	for (int k = 0; k < 3; ++k) {
+		laneSteps[k] = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(edges.dx[k]));
+		groupStep[k] = _mm256_set1_epi32(8 * edges.dx[k]);
+		row[k] = edges.e[k] + (start - x0) * edges.dx[k];
+	}
+
+	size_t written = 0;
+	for (int y = y0; y < y1; ++y) {
+		__m256 rowColor[4], ddx[4];
+		for (int c = 0; c < 4; ++c) {
+			rowColor[c] = _mm256_set1_ps(t.base[c] + t.ddy[c] * static_cast<float>(y));
+			ddx[c] = _mm256_set1_ps(t.ddx[c]);
+		}
+
+		__m256i e[3];
+		for (int k = 0; k < 3; ++k)
+			e[k] = _mm256_add_epi32(_mm256_set1_epi32(row[k]), laneSteps[k]);
+		uint32_t* out = pixels + static_cast<size_t>(y) * stride;
+
+		for (int x = start; x < x1; x += 8) {
+			const __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+			const __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(xs, first), _mm256_cmpgt_epi32(last, xs));
+			const __m256i sign = _mm256_srai_epi32(_mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]), 31);
+			const __m256i covered = _mm256_andnot_si256(sign, inside);
+			const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(covered));
+			if (mask) {
+				const __m256 fx = _mm256_cvtepi32_ps(xs);
+				__m256i packed = _mm256_setzero_si256();
+				for (int c = 0; c < 4; ++c) {
+					// Multiply, then add: the same rounding as the scalar and SSE paths
+					__m256 value = _mm256_add_ps(rowColor[c], _mm256_mul_ps(ddx[c], fx));
+					value = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(value, zero), one), scale);
+					packed = _mm256_or_si256(packed, _mm256_sllv_epi32(_mm256_cvtps_epi32(value), _mm256_set1_epi32(c * 8)));
+				}
+				_mm256_maskstore_epi32(reinterpret_cast<int*>(out + x), covered, packed);
+				written += static_cast<size_t>(_mm_popcnt_u32(static_cast<unsigned>(mask)));
+			}
+			for (int k = 0; k < 3; ++k)
+				e[k] = _mm256_add_epi32(e[k], groupStep[k]);
+		}
+		for (int k = 0; k < 3; ++k)
+			row[k] += edges.dy[k];
+	}
+	return written;
+}
+#endif
+
+void SoftwareRasterizer::RasterTile(size_t tile) {
+	const int tileX0 = static_cast<int>(tile % tilesX) * TILE_SIZE;
+	const int tileY0 = static_cast<int>(tile / tilesX) * TILE_SIZE;
+	const int tileX1 = std::min(tileX0 + TILE_SIZE, width);
+	const int tileY1 = std::min(tileY0 + TILE_SIZE, height);
+
+	if (clearPending) {
+		for (int y = tileY0; y < tileY1; ++y)
+			std::fill(color.begin() + static_cast<size_t>(y) * stride + tileX0, color.begin() + static_cast<size_t>(y) * stride + tileX1, clearColor);
+	}
+
+	size_t written = 0;
+	for (size_t c = 0; c < usedChunks; ++c) {
+		const Chunk& chunk = chunks[c];
+		for (uint32_t id : chunk.bins[tile]) {
+			const Triangle& t = chunk.triangles[id];
+			const int x0 = std::max(t.minX, tileX0);
+			const int x1 = std::min(t.maxX + 1, tileX1);
+			const int y0 = std::max(t.minY, tileY0);
+			const int y1 = std::min(t.maxY + 1, tileY1);
+
+			RectEdges edges;
+			if (!setupRectEdges(t, x0, y0, x1, y1, edges))
+				continue;
+#ifdef RASTER_X86
+			if (simd == CullSimd::AVX2 && BestCullSimd() == CullSimd::AVX2)
+				written += rasterAVX2(t, edges, x0, y0, x1, y1, color.data(), stride);
+			else if (simd != CullSimd::Scalar)
+				written += rasterSSE(t, edges, x0, y0, x1, y1, color.data(), stride);
+			else
+#endif
+				written += rasterScalar(t, edges, x0, y0, x1, y1, color.data(), stride);
+		}
+	}
+	tilePixels[tile] = written;
+}
+
+void SoftwareRasterizer::Finish() {
+	const auto start = std::chrono::steady_clock::now();
+	pool.ParallelFor(tilePixels.size(), [this](size_t begin, size_t end) {
+		for (size_t tile = begin; tile < end; ++tile)
+			RasterTile(tile);
+	});
+	clearPending = false;
+
+	for (size_t c = 0; c < usedChunks; ++c) {
+		const RasterFrameStats& stats = chunks[c].stats;
+		frame.triangles += stats.triangles;
+		frame.culled += stats.culled;
+		frame.clipped += stats.clipped;
+		frame.binned += stats.binned;
+	}
+	for (size_t pixels : tilePixels)
+		frame.pixels += pixels;
+	usedChunks = 0;
+
+	frame.rasterMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastFrame = frame;
+	AppendHistory(history, frame);
+	frame = RasterFrameStats();
+}
+
+std::vector<unsigned char> SoftwareRasterizer::ReadPixels() const {
+	std::vector<unsigned char> rgb(static_cast<size_t>(width) * height * 3);
+	for (int y = 0; y < height; ++y) {
+		const uint32_t* src = &color[static_cast<size_t>(height - 1 - y) * stride];
+		unsigned char* dst = &rgb[static_cast<size_t>(y) * width * 3];
+		for (int x = 0; x < width; ++x, dst += 3) {
+			dst[0] = static_cast<unsigned char>(src[x] & 0xFF);
+			dst[1] = static_cast<unsigned char>((src[x] >> 8) & 0xFF);
+			dst[2] = static_cast<unsigned char>((src[x] >> 16) & 0xFF);
+		}
+	}
+	return rgb;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+#include "Instancing.h"
+
+struct Mesh;
+class ThreadPool;
+class VertexLayout;
+
+// ===| Raster Mesh |===========================================================================
+
+// Vertex data as vertexShader.glsl receives it: packed through the layout and decoded again, so
+// a packed mesh is rasterized from the same half-float positions and byte colors the GPU reads
+struct RasterMesh {
+	std::vector<float> positions;    // x, y, z per vertex
+	std::vector<float> colors;       // r, g, b per vertex
+	std::vector<uint32_t> indices;   // 3 per triangle
+
+	size_t TriangleCount() const { return indices.size() / 3; }
+};
+
+RasterMesh MakeRasterMesh(const Mesh& mesh, const VertexLayout& layout);
+
+// ===| Software Rasterizer |===================================================================
+//
+// CPU stand-in for the GL draws of the mesh path: the same vertex transform and color math as
+// vertexShader.glsl and fragmentShader.glsl (with the white default texture), no depth test,
+// no blending, draws landing in submission order. Output is bit-identical from run to run and
+// independent of the thread count.
+//
+//   Draw()   transforms triangles on the pool and bins them into TILE_SIZE square screen tiles.
+//            Vertices are snapped to 1/16 pixel (4 subpixel bits, the GL minimum). Triangles
+//            are only clipped when they reach past a guard band of GUARD_PIXELS around the
+//            origin or cross the near/far planes; everything else is rasterized as is and
+//            trimmed to the viewport by its bounding box.
+//   Finish() rasterizes the tiles in parallel, each walking its bins in submission order. Edge
+//            functions are exact 64-bit integers at the corner of the triangle's rectangle in
+//            the tile; edges that cover the whole rectangle drop out, and the rest fit 32 bits
+//            there, so coverage is stepped 4 (SSE2) or 8 (AVX2) pixels per instruction. The
+//            fill rule is top-left; colors are interpolated with barycentric plane equations.
+
+struct RasterFrameStats {
+	size_t triangles = 0;          // submitted, once per instance
+	size_t culled = 0;             // off screen, outside the depth range or covering no sample
+	size_t clipped = 0;            // reached past the guard band or the near/far planes
+	size_t binned = 0;             // triangle-tile pairs
+	size_t pixels = 0;             // fragments written
+	double setupMilliseconds = 0.0;   // Draw(): transform, clip and bin
+	double rasterMilliseconds = 0.0;  // Finish(): clear and rasterize the tiles
+};
+
+class SoftwareRasterizer {
+public:
+	static constexpr int TILE_SIZE = 64;
+	static constexpr int SUBPIXEL_BITS = 4;
+	static constexpr float GUARD_PIXELS = 8000.0f;
+
+	SoftwareRasterizer(ThreadPool& pool, int width, int height);
+
+	// CullSimd names the instruction set here too: Scalar, SSE (SSE2) or AVX2
+	void SetSimd(CullSimd newSimd) { simd = newSimd; }
+	CullSimd Simd() const { return simd; }
+
+	// Deferred: tiles are cleared by the next Finish()
+	void Clear(float r, float g, float b, float a);
+	// Draws mesh once per instance, like DrawMeshInstanced(); no instances draws it once with the
+	// constant attributes of SetDefaultInstanceAttributes()
+	void Draw(const RasterMesh& mesh, const std::vector<InstanceData>& instances);
+	// Rasterizes everything drawn since the last Finish() and closes the frame's stats
+	void Finish();
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	// Tightly packed RGB8, top row first, like ReadOffscreenPixels()
+	std::vector<unsigned char> ReadPixels() const;
+
+	const RasterFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<RasterFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+	struct Triangle {
+		int32_t A[3];            // edge k, opposite vertex k: E = A * x + B * y + C in subpixels,
+		int32_t B[3];            // >= 0 inside; C carries the fill rule bias
+		int64_t C[3];
+		int32_t minX, maxX;      // covered pixel range, inclusive and inside the viewport
+		int32_t minY, maxY;
+		float base[4];           // RGBA at pixel (0, 0) of the color planes
+		float ddx[4];            // ... and their steps per pixel
+		float ddy[4];
+	};
+
+private:
+	struct Chunk {
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<uint32_t>> bins;   // per tile, indices into triangles
+		RasterFrameStats stats;
+	};
+
+	void SetupRange(const RasterMesh& mesh, const std::vector<InstanceData>& instances, size_t begin, size_t end, Chunk& chunk) const;
+	void RasterTile(size_t tile);
+
+	ThreadPool& pool;
+	int width;
+	int height;
+	int stride;                  // pixels per row, padded so SIMD groups never cross rows
+	int tilesX;
+	int tilesY;
+	CullSimd simd = BestCullSimd();
+
+	std::vector<uint32_t> color;  // RGBA8, bottom row first
+	uint32_t clearColor = 0;
+	bool clearPending = false;
+
+	std::vector<Chunk> chunks;    // in submission order; kept across frames for their capacity
+	size_t usedChunks = 0;
+	std::vector<size_t> tilePixels;
+
+	RasterFrameStats frame;
+	RasterFrameStats lastFrame;
+	std::vector<RasterFrameStats> history;
+};
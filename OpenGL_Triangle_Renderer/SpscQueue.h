@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// ===| SPSC Queue |============================================================================
+//
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. Head and
+// tail only ever grow and index the ring modulo Capacity (a power of two); each side owns one
+// of them and publishes it with a release store, so the other side's acquire load sees the
+// items written before it. Each side also keeps a cached copy of the other's index and only
+// reloads it when the ring looks full (or empty), so the cache lines bounce between the
+// cores once per batch rather than once per item. Neither side ever blocks: TryPush fails
+// when the ring is full, TryPop when it is empty.
+
+template <class T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue() = default;
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Producer thread only
+	bool TryPush(const T& item) {
+		const size_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail - cachedHead == Capacity) {
+			cachedHead = head.load(std::memory_order_acquire);
+			if (tail - cachedHead == Capacity)
+				return false;
+		}
+		items[tail & (Capacity - 1)] = item;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only
+	bool TryPop(T& item) {
+		const size_t head = this->head.load(std::memory_order_relaxed);
+		if (head == cachedTail) {
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (head == cachedTail)
+				return false;
+		}
+		item = items[head & (Capacity - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Either thread; only a snapshot, the other side may change it at once
+	size_t SizeApprox() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+private:
+	// Consumer side, then producer side, each on its own cache line
+	alignas(64) std::atomic<size_t> head{ 0 };
+	size_t cachedTail = 0;
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	size_t cachedHead = 0;
+	alignas(64) T items[Capacity];
+};
@@ -0,0 +1,228 @@
+#include "StateCache.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+
+GLStateCache glState;
+
+void GLStateCache::Invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	std::fill(std::begin(buffers), std::end(buffers), UNKNOWN);
+	drawFramebuffer = UNKNOWN;
+	readFramebuffer = UNKNOWN;
+	activeTexture = UNKNOWN;
+	for (auto& unit : textures)
+		std::fill(std::begin(unit), std::end(unit), UNKNOWN);
+	std::fill(std::begin(capabilities), std::end(capabilities), UNKNOWN);
+	blendSource = UNKNOWN;
+	blendDestination = UNKNOWN;
+	depthFunc = UNKNOWN;
+	depthMask = UNKNOWN;
+	colorMask = UNKNOWN;
+}
+
+bool GLStateCache::Changed(unsigned int& shadow, unsigned int value) {
+	if (shadow == value && !bypass) {
+		++frame.elided;
+		return false;
+	}
+	shadow = value;
+	++frame.issued;
+	return true;
+}
+
+int GLStateCache::BufferSlotFor(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER:         return ARRAY;
+	case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT;
+	case GL_COPY_READ_BUFFER:     return COPY_READ;
+	case GL_COPY_WRITE_BUFFER:    return COPY_WRITE;
+	case GL_PIXEL_PACK_BUFFER:    return PIXEL_PACK;
+	case GL_PIXEL_UNPACK_BUFFER:  return PIXEL_UNPACK;
+	case GL_UNIFORM_BUFFER:       return UNIFORM;
+	}
+	return -1;
+}
+
+int GLStateCache::TextureSlotFor(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D:       return TEX_2D;
+	case GL_TEXTURE_2D_ARRAY: return TEX_2D_ARRAY;
+	case GL_TEXTURE_CUBE_MAP: return TEX_CUBE;
+	}
+	return -1;
+}
+
+int GLStateCache::CapabilitySlotFor(GLenum capability) {
+	switch (capability) {
+	case GL_BLEND:        return BLEND;
+	case GL_DEPTH_TEST:   return DEPTH_TEST;
+	case GL_CULL_FACE:    return CULL_FACE;
+	case GL_SCISSOR_TEST: return SCISSOR_TEST;
+	}
+	return -1;
+}
+
+// ===| Bindings |==============================================================================
+
+void GLStateCache::UseProgram(unsigned int newProgram) {
+	if (Changed(program, newProgram))
+		glUseProgram(newProgram);
+}
+
+void GLStateCache::BindVertexArray(unsigned int vao) {
+	if (Changed(vertexArray, vao)) {
+		glBindVertexArray(vao);
+		buffers[ELEMENT] = UNKNOWN;
+	}
+}
+
+void GLStateCache::BindBuffer(GLenum target, unsigned int buffer) {
+	const int slot = BufferSlotFor(target);
+	if (slot < 0) {
+		++frame.issued;
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (Changed(buffers[slot], buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, unsigned int framebuffer) {
+	if (target == GL_FRAMEBUFFER) {
+		if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer && !bypass) {
+			++frame.elided;
+			return;
+		}
+		drawFramebuffer = framebuffer;
+		readFramebuffer = framebuffer;
+		++frame.issued;
+		glBindFramebuffer(target, framebuffer);
+		return;
+	}
+	if (Changed(target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer, framebuffer))
+		glBindFramebuffer(target, framebuffer);
+}
+
+void GLStateCache::ActiveTexture(unsigned int unit) {
+	if (Changed(activeTexture, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::BindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+	const int slot = TextureSlotFor(target);
+	if (slot >= 0 && unit < MAX_TEXTURE_UNITS) {
+		if (textures[unit][slot] == texture && !bypass) {
+			++frame.elided;
+			return;
+		}
+		textures[unit][slot] = texture;
+	}
+	ActiveTexture(unit);
+	++frame.issued;
+	glBindTexture(target, texture);
+}
+
+// ===| Fixed-Function State |==================================================================
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled) {
+	const int slot = CapabilitySlotFor(capability);
+	if (slot >= 0 && !Changed(capabilities[slot], enabled ? 1u : 0u))
+		return;
+	if (slot < 0)
+		++frame.issued;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLStateCache::Enable(GLenum capability) {
+	SetEnabled(capability, true);
+}
+
+void GLStateCache::Disable(GLenum capability) {
+	SetEnabled(capability, false);
+}
+
+void GLStateCache::BlendFunc(GLenum source, GLenum destination) {
+	if (blendSource == source && blendDestination == destination && !bypass) {
+		++frame.elided;
+		return;
+	}
+	blendSource = source;
+	blendDestination = destination;
+	++frame.issued;
+	glBlendFunc(source, destination);
+}
+
+void GLStateCache::DepthFunc(GLenum func) {
+	if (Changed(depthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLStateCache::DepthMask(bool write) {
+	if (Changed(depthMask, write ? 1u : 0u))
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::ColorMask(bool red, bool green, bool blue, bool alpha) {
+	const unsigned int mask = (red ? 1u : 0u) | (green ? 2u : 0u) | (blue ? 4u : 0u) | (alpha ? 8u : 0u);
+	if (Changed(colorMask, mask))
+		glColorMask(red, green, blue, alpha);
+}
+
+// ===| Deletion |==============================================================================
+
+void GLStateCache::OnProgramDeleted(unsigned int deleted) {
+	// A deleted program stays in use until another is bound, so the shadow is still right;
+	// but a new object may reuse the name, which must not count as already bound
+	if (program == deleted)
+		program = UNKNOWN;
+}
+
+void GLStateCache::OnVertexArrayDeleted(unsigned int vao) {
+	if (vertexArray == vao) {
+		vertexArray = 0;
+		buffers[ELEMENT] = UNKNOWN;
+	}
+}
+
+void GLStateCache::OnBufferDeleted(unsigned int buffer) {
+	for (unsigned int& bound : buffers) {
+		if (bound == buffer)
+			bound = 0;
+	}
+}
+
+void GLStateCache::OnTextureDeleted(unsigned int texture) {
+	for (auto& unit : textures) {
+		for (unsigned int& bound : unit) {
+			if (bound == texture)
+				bound = 0;
+		}
+	}
+}
+
+void GLStateCache::OnFramebufferDeleted(unsigned int framebuffer) {
+	if (drawFramebuffer == framebuffer)
+		drawFramebuffer = 0;
+	if (readFramebuffer == framebuffer)
+		readFramebuffer = 0;
+}
+
+// ===| Counters |==============================================================================
+
+void GLStateCache::EndFrame() {
+	lastFrame = frame;
+	AppendHistory(history, frame);
+	frame = StateCounters();
+}
+
+void GLStateCache::ClearHistory() {
+	history.clear();
+	frame = StateCounters();
+	lastFrame = StateCounters();
+}
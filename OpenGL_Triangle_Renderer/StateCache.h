@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+// ===| GL State Cache |========================================================================
+//
+// Shadows the bindings and fixed-function state the renderer touches and drops calls that would
+// not change anything. Every bind/enable in the renderer goes through glState, so the shadow
+// stays truthful; code that changes state behind its back must call Invalidate().
+//
+// The element array buffer binding is VAO state, so binding a VAO forgets it.
+
+struct StateCounters {
+	unsigned int issued = 0;   // calls that reached GL
+	unsigned int elided = 0;   // redundant calls that were skipped
+};
+
+class GLStateCache {
+public:
+	static constexpr int MAX_TEXTURE_UNITS = 16;
+
+	GLStateCache() { Invalidate(); }
+
+	// Forget everything: the next call of every kind goes to GL
+	void Invalidate();
+
+	// Forwards every call (still counted as issued), for measuring what the cache saves
+	void SetBypass(bool enabled) { bypass = enabled; }
+	bool Bypass() const { return bypass; }
+
+	void UseProgram(unsigned int program);
+	void BindVertexArray(unsigned int vao);
+	void BindBuffer(GLenum target, unsigned int buffer);
+	void BindFramebuffer(GLenum target, unsigned int framebuffer);
+	void ActiveTexture(unsigned int unit);
+	void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+
+	void Enable(GLenum capability);
+	void Disable(GLenum capability);
+	void SetEnabled(GLenum capability, bool enabled);
+	void BlendFunc(GLenum source, GLenum destination);
+	void DepthFunc(GLenum func);
+	void DepthMask(bool write);
+	void ColorMask(bool red, bool green, bool blue, bool alpha);
+
+	// Deleted objects are unbound by GL, so the shadow must follow
+	void OnProgramDeleted(unsigned int program);
+	void OnVertexArrayDeleted(unsigned int vao);
+	void OnBufferDeleted(unsigned int buffer);
+	void OnTextureDeleted(unsigned int texture);
+	void OnFramebufferDeleted(unsigned int framebuffer);
+
+	unsigned int CurrentProgram() const { return program; }
+	unsigned int CurrentVertexArray() const { return vertexArray; }
+
+	// Closes the frame's counters and starts new ones
+	void EndFrame();
+	const StateCounters& FrameCounters() const { return frame; }
+	const StateCounters& LastFrameCounters() const { return lastFrame; }
+	const std::vector<StateCounters>& History() const { return history; }
+	void ClearHistory();
+
+private:
+	static constexpr unsigned int UNKNOWN = ~0u;
+
+	enum BufferSlot { ARRAY, ELEMENT, COPY_READ, COPY_WRITE, PIXEL_PACK, PIXEL_UNPACK, UNIFORM, BUFFER_SLOTS };
+	enum TextureSlot { TEX_2D, TEX_2D_ARRAY, TEX_CUBE, TEXTURE_SLOTS };
+	enum CapabilitySlot { BLEND, DEPTH_TEST, CULL_FACE, SCISSOR_TEST, CAPABILITY_SLOTS };
+
+	static int BufferSlotFor(GLenum target);
+	static int TextureSlotFor(GLenum target);
+	static int CapabilitySlotFor(GLenum capability);
+
+	bool Changed(unsigned int& shadow, unsigned int value);
+
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int buffers[BUFFER_SLOTS];
+	unsigned int drawFramebuffer;
+	unsigned int readFramebuffer;
+	unsigned int activeTexture;
+	unsigned int textures[MAX_TEXTURE_UNITS][TEXTURE_SLOTS];
+	unsigned int capabilities[CAPABILITY_SLOTS];
+	unsigned int blendSource;
+	unsigned int blendDestination;
+	unsigned int depthFunc;
+	unsigned int depthMask;
+	unsigned int colorMask;
+
+	bool bypass = false;
+	StateCounters frame;
+	StateCounters lastFrame;
+	std::vector<StateCounters> history;
+};
+
+// The renderer's single GL context
+extern GLStateCache glState;
@@ -0,0 +1,109 @@
+#include "StreamingBuffer.h"
+#include "FrameHistory.h"
+#include "StateCache.h"
+
+#include <algorithm>
+#include <chrono>
+
+StreamingBuffer::StreamingBuffer(GLenum target, size_t segmentSize, int segmentCount, StreamPolicy policy)
+	: target(target), segmentSize(std::max<size_t>(segmentSize, 1)), segmentCount(std::max(segmentCount, 1)), policy(policy) {
+	fences.assign(this->segmentCount, nullptr);
+	glGenBuffers(1, &buffer);
+	Reallocate(this->segmentSize);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (GLsync fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+	}
+	glState.OnBufferDeleted(buffer);
+	glDeleteBuffers(1, &buffer);
+}
+
+void StreamingBuffer::Reallocate(size_t newSegmentSize) {
+	// Fences refer to the old storage, which the driver keeps alive until the GPU is done with it
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	segmentSize = newSegmentSize;
+	glState.BindBuffer(target, buffer);
+	glBufferData(target, segmentSize * segmentCount, NULL, GL_STREAM_DRAW);
+}
+
+void StreamingBuffer::AcquireSegment() {
+	segmentAcquired = true;
+	segmentUsed = 0;
+
+	GLsync& fence = fences[segment];
+	if (!fence)
+		return;
+
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (policy == StreamPolicy::Orphan) {
+			Reallocate(segmentSize);
+			++frame.orphans;
+			return;
+		}
+
+		// GPU is more than segmentCount - 1 frames behind: block until it catches up
+		const auto start = std::chrono::steady_clock::now();
+		do {
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		} while (status == GL_TIMEOUT_EXPIRED);
+		frame.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		++frame.fenceWaits;
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void* StreamingBuffer::Map(size_t bytes, size_t alignment, size_t* offset) {
+	if (!segmentAcquired)
+		AcquireSegment();
+
+	alignment = std::max<size_t>(alignment, 1);
+	size_t base = static_cast<size_t>(segment) * segmentSize;
+	size_t alignedBase = (base + segmentUsed + alignment - 1) / alignment * alignment;
+	if (alignedBase + bytes > base + segmentSize) {
+		// Frame needs more than a segment holds: grow every segment. Data written earlier this
+		// frame lives in the orphaned storage, which previously issued draws still read from.
+		size_t newSize = segmentSize;
+		while (newSize < bytes + alignment)
+			newSize *= 2;
+		Reallocate(newSize);
+		base = static_cast<size_t>(segment) * segmentSize;
+		alignedBase = (base + alignment - 1) / alignment * alignment;
+	}
+	segmentUsed = alignedBase - base + bytes;
+
+	glState.BindBuffer(target, buffer);
+	void* pointer = glMapBufferRange(target, alignedBase, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+
+	frame.bytesStreamed += bytes;
+	*offset = alignedBase;
+	return pointer;
+}
+
+void StreamingBuffer::Unmap() {
+	glState.BindBuffer(target, buffer);
+	glUnmapBuffer(target);
+}
+
+void StreamingBuffer::EndFrame() {
+	if (segmentAcquired) {
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		segment = (segment + 1) % segmentCount;
+		segmentAcquired = false;
+	}
+
+	lastFrame = frame;
+	AppendHistory(history, frame);
+	frame = StreamFrameStats();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// ===| Streaming Buffer |======================================================================
+//
+// Ring of N segments (triple-buffered by default) in one GL buffer for data rewritten every
+// frame. Frame i writes only to segment i % N through glMapBufferRange with
+// GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT, so the driver never synchronizes; a
+// glFenceSync per segment tells when the GPU is done reading it and it may be written again.
+// If the GPU is still behind when a segment comes around, the policy decides between waiting
+// on the fence and orphaning the whole buffer (fresh storage, old one retired by the driver).
+
+enum class StreamPolicy {
+	Wait,
+	Orphan
+};
+
+struct StreamFrameStats {
+	size_t bytesStreamed = 0;
+	unsigned int fenceWaits = 0;      // segment still in use, had to block
+	unsigned int orphans = 0;         // segment still in use, buffer orphaned instead
+	double waitMilliseconds = 0.0;
+};
+
+class StreamingBuffer {
+public:
+	StreamingBuffer(GLenum target, size_t segmentSize, int segmentCount = 3, StreamPolicy policy = StreamPolicy::Wait);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	// Maps bytes of the current segment for writing. offset receives the position within the
+	// GL buffer and is a multiple of alignment (need not be a power of two, e.g. a vertex stride).
+	void* Map(size_t bytes, size_t alignment, size_t* offset);
+	void Unmap();
+
+	// Fences the segment written this frame and moves on to the next one
+	void EndFrame();
+
+	unsigned int Buffer() const { return buffer; }
+	size_t SegmentSize() const { return segmentSize; }
+
+	const StreamFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<StreamFrameStats>& History() const { return history; }
+
+private:
+	void AcquireSegment();
+	void Reallocate(size_t newSegmentSize);
+
+	GLenum target;
+	unsigned int buffer = 0;
+	size_t segmentSize;
+	int segmentCount;
+	StreamPolicy policy;
+
+	std::vector<GLsync> fences;
+	int segment = 0;
+	size_t segmentUsed = 0;
+	bool segmentAcquired = false;
+
+	StreamFrameStats frame;
+	StreamFrameStats lastFrame;
+	std::vector<StreamFrameStats> history;
+};
@@ -0,0 +1,382 @@
+#include "TextureManager.h"
+#include "GLExtensions.h"
+#include "Headless.h"
+#include "StateCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// ===| Images |================================================================================
+
+bool LoadImageFile(const std::string& path, Image& image) {
+	std::vector<unsigned char> rgb;
+	if (!ReadPPM(path, image.width, image.height, rgb))
+		return false;
+	const size_t rowBytes = static_cast<size_t>(image.width) * 3;
+
+	// PPM rows run top to bottom
+	image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+	for (int y = 0; y < image.height; ++y) {
+		const unsigned char* src = &rgb[(image.height - 1 - y) * rowBytes];
+		unsigned char* dst = &image.pixels[static_cast<size_t>(y) * image.width * 4];
+		for (int x = 0; x < image.width; ++x, src += 3, dst += 4) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = 255;
+		}
+	}
+	return true;
+}
+
+Image MakePatternImage(int size, uint32_t seed) {
+	Image image;
+	image.width = image.height = std::max(size, 1);
+	image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+
+	// Light tints, so the vertex colors they multiply stay recognizable
+	const float hue = std::fmod(seed * 0.618034f, 1.0f) * 6.2831853f;
+	const float tint[3] = { 0.75f + 0.25f * std::cos(hue), 0.75f + 0.25f * std::cos(hue - 2.0943951f),
+		0.75f + 0.25f * std::cos(hue + 2.0943951f) };
+	const int cells = 4 + static_cast<int>(seed % 5) * 2;
+
+	for (int y = 0; y < image.height; ++y) {
+		for (int x = 0; x < image.width; ++x) {
+			const float u = (x + 0.5f) / image.width;
+			const float v = (y + 0.5f) / image.height;
+			const bool dark = ((static_cast<int>(u * cells) + static_cast<int>(v * cells)) & 1) != 0;
+			const float distance = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+			const float shade = (dark ? 0.6f : 1.0f) * (0.85f + 0.15f * std::cos(distance * 60.0f));
+
+			unsigned char* pixel = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 4];
+			for (int c = 0; c < 3; ++c)
+				pixel[c] = static_cast<unsigned char>(std::lround(255.0f * tint[c] * shade));
+			pixel[3] = 255;
+		}
+	}
+	return image;
+}
+
+std::vector<Image> BuildMipChain(Image image) {
+	std::vector<Image> levels;
+	levels.push_back(std::move(image));
+
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		const Image& src = levels.back();
+		Image dst;
+		dst.width = std::max(src.width / 2, 1);
+		dst.height = std::max(src.height / 2, 1);
+		dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+		for (int y = 0; y < dst.height; ++y) {
+			const int y0 = std::min(y * 2, src.height - 1);
+			const int y1 = std::min(y * 2 + 1, src.height - 1);
+			for (int x = 0; x < dst.width; ++x) {
+				const int x0 = std::min(x * 2, src.width - 1);
+				const int x1 = std::min(x * 2 + 1, src.width - 1);
+				const unsigned char* p00 = &src.pixels[(static_cast<size_t>(y0) * src.width + x0) * 4];
+				const unsigned char* p01 = &src.pixels[(static_cast<size_t>(y0) * src.width + x1) * 4];
+				const unsigned char* p10 = &src.pixels[(static_cast<size_t>(y1) * src.width + x0) * 4];
+				const unsigned char* p11 = &src.pixels[(static_cast<size_t>(y1) * src.width + x1) * 4];
+				unsigned char* out = &dst.pixels[(static_cast<size_t>(y) * dst.width + x) * 4];
+				for (int c = 0; c < 4; ++c)
+					out[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+			}
+		}
+		levels.push_back(std::move(dst));
+	}
+	return levels;
+}
+
+// ===| BC1 Compression |=======================================================================
+
+static uint16_t packRgb565(const float color[3]) {
+	const auto channel = [](float value, float scale) {
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 255.0f) * scale / 255.0f));
+	};
+	return static_cast<uint16_t>((channel(color[0], 31.0f) << 11) | (channel(color[1], 63.0f) << 5) | channel(color[2], 31.0f));
+}
+
+static void unpackRgb565(uint16_t packed, int color[3]) {
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void compressBlock(const unsigned char pixels[16][4], unsigned char out[8]) {
+	float mean[3] = {};
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c)
+			mean[c] += pixels[i][c] / 16.0f;
+	}
+
+	// Principal axis of the colors by power iteration on their covariance
+	float cov[6] = {};
+	for (int i = 0; i < 16; ++i) {
+		const float d[3] = { pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2] };
+		cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+	}
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 4; ++iteration) {
+		const float next[3] = {
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+		const float length = std::max({ std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2]) });
+		if (length < 1e-6f)
+			break;   // flat block: any axis will do
+		for (int c = 0; c < 3; ++c)
+			axis[c] = next[c] / length;
+	}
+
+	int lo = 0, hi = 0;
+	float loDot = 1e30f, hiDot = -1e30f;
+	for (int i = 0; i < 16; ++i) {
+		const float dot = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+		if (dot < loDot) { loDot = dot; lo = i; }
+		if (dot > hiDot) { hiDot = dot; hi = i; }
+	}
+
+	const float hiColor[3] = { static_cast<float>(pixels[hi][0]), static_cast<float>(pixels[hi][1]), static_cast<float>(pixels[hi][2]) };
+	const float loColor[3] = { static_cast<float>(pixels[lo][0]), static_cast<float>(pixels[lo][1]), static_cast<float>(pixels[lo][2]) };
+	uint16_t color0 = packRgb565(hiColor);
+	uint16_t color1 = packRgb565(loColor);
+	// color0 > color1 selects the four-color mode; equal endpoints only ever need index 0
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	int palette[4][3];
+	unpackRgb565(color0, palette[0]);
+	unpackRgb565(color1, palette[1]);
+	for (int c = 0; c < 3; ++c) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4; ++p) {
+				const int dr = pixels[i][0] - palette[p][0];
+				const int dg = pixels[i][1] - palette[p][1];
+				const int db = pixels[i][2] - palette[p][2];
+				const int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+
+	// Little-endian: color0, color1, then 2 bits per pixel, first pixel in the lowest bits
+	out[0] = static_cast<unsigned char>(color0 & 0xFF);
+	out[1] = static_cast<unsigned char>(color0 >> 8);
+	out[2] = static_cast<unsigned char>(color1 & 0xFF);
+	out[3] = static_cast<unsigned char>(color1 >> 8);
+	for (int b = 0; b < 4; ++b)
+		out[4 + b] = static_cast<unsigned char>((indices >> (b * 8)) & 0xFF);
+}
+
+size_t BC1Size(int width, int height) {
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+std::vector<unsigned char> CompressBC1(const Image& image, ThreadPool* pool) {
+	const int blocksX = (image.width + 3) / 4;
+	const int blocksY = (image.height + 3) / 4;
+	std::vector<unsigned char> blocks(BC1Size(image.width, image.height));
+
+	const auto compressRows = [&](size_t begin, size_t end) {
+		unsigned char pixels[16][4];
+		for (size_t by = begin; by < end; ++by) {
+			for (int bx = 0; bx < blocksX; ++bx) {
+				for (int i = 0; i < 16; ++i) {
+					const int x = std::min(bx * 4 + (i & 3), image.width - 1);
+					const int y = std::min(static_cast<int>(by) * 4 + (i >> 2), image.height - 1);
+					std::memcpy(pixels[i], &image.pixels[(static_cast<size_t>(y) * image.width + x) * 4], 4);
+				}
+				compressBlock(pixels, &blocks[(by * blocksX + bx) * 8]);
+			}
+		}
+	};
+
+	if (pool)
+		pool->ParallelFor(blocksY, compressRows, 16);
+	else
+		compressRows(0, blocksY);
+	return blocks;
+}
+
+// ===| Texture Manager |=======================================================================
+
+static size_t rgba8Size(int width, int height) {
+	return static_cast<size_t>(width) * height * 4;
+}
+
+static void levelSize(int width, int height, int level, int& levelWidth, int& levelHeight) {
+	levelWidth = std::max(width >> level, 1);
+	levelHeight = std::max(height >> level, 1);
+}
+
+TextureManager::TextureManager(ThreadPool& pool, bool compress)
+	: pool(pool), format(compress && glExt.textureCompressionS3TC ? TextureFormat::BC1 : TextureFormat::RGBA8) {
+	const unsigned char pixel[4] = { 255, 255, 255, 255 };
+	glGenTextures(1, &white);
+	glState.BindTexture(0, GL_TEXTURE_2D, white);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+TextureManager::~TextureManager() {
+	for (Entry& entry : entries) {
+		// Pool tasks only touch their own data, but the pool must not outlive what they return into
+		if (entry.pending.valid())
+			entry.pending.wait();
+		glState.OnTextureDeleted(entry.texture);
+		glDeleteTextures(1, &entry.texture);
+	}
+	glState.OnTextureDeleted(white);
+	glDeleteTextures(1, &white);
+}
+
+unsigned int TextureManager::Start(std::function<bool(Image&)> source) {
+	Entry entry;
+	glGenTextures(1, &entry.texture);
+	glState.BindTexture(0, GL_TEXTURE_2D, entry.texture);
+
+	// Placeholder until the image arrives; Allocate() respecifies every level
+	const unsigned char pixel[4] = { 255, 255, 255, 255 };
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	const TextureFormat format = this->format;
+	ThreadPool* pool = &this->pool;
+	entry.pending = this->pool.Submit([source, format, pool]() {
+		const auto start = std::chrono::steady_clock::now();
+		Prepared prepared;
+		Image image;
+		if (!source(image))
+			return prepared;
+
+		prepared.width = image.width;
+		prepared.height = image.height;
+		std::vector<Image> mips = BuildMipChain(std::move(image));
+		for (Image& level : mips) {
+			if (format == TextureFormat::BC1)
+				prepared.levels.push_back(CompressBC1(level, pool));
+			else
+				prepared.levels.push_back(std::move(level.pixels));
+		}
+		prepared.ok = true;
+		prepared.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return prepared;
+	});
+
+	++stats.textures;
+	entries.push_back(std::move(entry));
+	return entries.back().texture;
+}
+
+unsigned int TextureManager::Load(const std::string& path) {
+	return Start([path](Image& image) { return LoadImageFile(path, image); });
+}
+
+unsigned int TextureManager::Generate(int size, uint32_t seed) {
+	return Start([size, seed](Image& image) {
+		image = MakePatternImage(size, seed);
+		return true;
+	});
+}
+
+void TextureManager::Allocate(Entry& entry, Prepared& prepared, UploadQueue& uploads) {
+	entry.levelCount = static_cast<int>(prepared.levels.size());
+	const int coarsest = entry.levelCount - 1;
+	entry.baseLevel = coarsest;
+	entry.levelUploads.assign(entry.levelCount, 0);
+
+	glState.BindTexture(0, GL_TEXTURE_2D, entry.texture);
+	glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, coarsest);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, coarsest);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	// Storage for every level; only the coarsest gets its data here, a handful of bytes
+	for (int level = 0; level < entry.levelCount; ++level) {
+		int width, height;
+		levelSize(prepared.width, prepared.height, level, width, height);
+		const void* data = level == coarsest ? prepared.levels[level].data() : NULL;
+		if (format == TextureFormat::BC1) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0,
+				static_cast<GLsizei>(prepared.levels[level].size()), data);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		}
+		stats.vramBytes += prepared.levels[level].size();
+		stats.uncompressedBytes += rgba8Size(width, height);
+	}
+
+	for (int level = coarsest - 1; level >= 0; --level) {
+		int width, height;
+		levelSize(prepared.width, prepared.height, level, width, height);
+		stats.stagedBytes += prepared.levels[level].size();
+		entry.levelUploads[level] = format == TextureFormat::BC1
+			? uploads.UploadCompressedTexture2D(entry.texture, level, width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, std::move(prepared.levels[level]))
+			: uploads.UploadTexture2D(entry.texture, level, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 4, std::move(prepared.levels[level]));
+	}
+	stats.prepareMilliseconds += prepared.milliseconds;
+}
+
+void TextureManager::Update(UploadQueue& uploads) {
+	for (Entry& entry : entries) {
+		if (entry.pending.valid()) {
+			if (entry.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			Prepared prepared = entry.pending.get();
+			if (!prepared.ok) {
+				++stats.failed;
+				continue;   // stays white
+			}
+			Allocate(entry, prepared, uploads);
+		}
+		if (entry.resident || entry.levelCount == 0)
+			continue;
+
+		// Levels complete in queue order, coarsest first: step down while the next one is in
+		const int base = entry.baseLevel;
+		while (entry.baseLevel > 0 && uploads.Ready(entry.levelUploads[entry.baseLevel - 1]))
+			--entry.baseLevel;
+		if (entry.baseLevel != base) {
+			glState.BindTexture(0, GL_TEXTURE_2D, entry.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.baseLevel);
+		}
+		if (entry.baseLevel == 0) {
+			entry.resident = true;
+			++stats.resident;
+		}
+	}
+
+	if (stats.readyFrame < 0 && Idle())
+		stats.readyFrame = frame;
+	++frame;
+}
+
+bool TextureManager::Idle() const {
+	return stats.resident + stats.failed == stats.textures;
+}
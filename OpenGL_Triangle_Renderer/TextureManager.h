@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "UploadQueue.h"
+
+class ThreadPool;
+
+// ===| Images |================================================================================
+
+// Tightly packed RGBA8 pixels, bottom row first: the order GL expects for texture rows
+struct Image {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// Binary PPM (P6, 8-bit), the format headless frames are written in; alpha is set to 255
+bool LoadImageFile(const std::string& path, Image& image);
+// size x size pattern (tinted checkerboard with rings), different for every seed
+Image MakePatternImage(int size, uint32_t seed);
+
+// 2x2 box-filtered levels down to 1x1; odd edges repeat their last pixel. levels[0] is image.
+std::vector<Image> BuildMipChain(Image image);
+
+// ===| BC1 Compression |=======================================================================
+//
+// BC1 (DXT1) stores each 4x4 block as two RGB565 endpoints and a 2-bit index per pixel into the
+// four colors interpolated between them: 8 bytes per 16 pixels, an eighth of RGBA8. Endpoints
+// are the block's extreme colors along its principal axis. Alpha is dropped.
+
+size_t BC1Size(int width, int height);
+// Blocks row by row, partial edge blocks padded by repeating edge pixels. With a pool, rows of
+// blocks are compressed in parallel (safe from a pool task).
+std::vector<unsigned char> CompressBC1(const Image& image, ThreadPool* pool = NULL);
+
+// ===| Texture Manager |=======================================================================
+//
+// Turns image sources into mipmapped GL textures without stalling the frame:
+//   1. Load()/Generate() create the GL texture at once, as a 1x1 white placeholder, and send the
+//      decode, mip generation and (when the driver has S3TC) BC1 compression to the pool,
+//   2. Update() picks up finished images, allocates every level, writes the tiny coarsest one
+//      directly and queues the rest on the upload queue, coarsest first, so their data goes
+//      through its mapped pixel unpack buffer a budgeted slice per frame,
+//   3. as level uploads complete, GL_TEXTURE_BASE_LEVEL is lowered to the finest level present,
+//      so a texture sharpens over a few frames and is never sampled where data is missing.
+// Texture names never change, so they can be handed to draws before the data exists.
+
+enum class TextureFormat : uint8_t {
+	RGBA8,
+	BC1
+};
+
+struct TextureStats {
+	unsigned int textures = 0;         // loaded or generated, the white placeholder excluded
+	unsigned int resident = 0;         // every level uploaded
+	unsigned int failed = 0;
+	size_t vramBytes = 0;              // storage of every level in the format actually used
+	size_t uncompressedBytes = 0;      // what the same levels take as RGBA8
+	size_t stagedBytes = 0;            // level data sent through the mapped staging buffer
+	double prepareMilliseconds = 0.0;  // decode + mips + compression, summed over pool tasks
+	long readyFrame = -1;              // Update() call that found every texture resident
+};
+
+class TextureManager {
+public:
+	// BC1 is used when compress is set and the driver supports it, RGBA8 otherwise
+	TextureManager(ThreadPool& pool, bool compress);
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// 1x1 opaque white: for untextured draws, since the shaders always sample unit 0
+	unsigned int White() const { return white; }
+
+	// Both return a texture that is white until its image is ready
+	unsigned int Load(const std::string& path);
+	unsigned int Generate(int size, uint32_t seed);
+
+	// Once per frame on the GL thread, before uploads.Update()
+	void Update(UploadQueue& uploads);
+	bool Idle() const;
+
+	TextureFormat Format() const { return format; }
+	const TextureStats& Stats() const { return stats; }
+
+private:
+	struct Prepared {
+		bool ok = false;
+		int width = 0;
+		int height = 0;
+		std::vector<std::vector<unsigned char>> levels;   // finest first, in format
+		double milliseconds = 0.0;
+	};
+
+	struct Entry {
+		unsigned int texture = 0;
+		std::future<Prepared> pending;   // valid until the pool is done
+		int levelCount = 0;
+		int baseLevel = 0;               // finest level the GPU has
+		std::vector<UploadId> levelUploads;
+		bool resident = false;
+	};
+
+	unsigned int Start(std::function<bool(Image&)> source);
+	void Allocate(Entry& entry, Prepared& prepared, UploadQueue& uploads);
+
+	ThreadPool& pool;
+	TextureFormat format;
+	unsigned int white = 0;
+	std::vector<Entry> entries;
+	long frame = 0;
+	TextureStats stats;
+};
@@ -0,0 +1,84 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+		workers.emplace_back(&ThreadPool::WorkerMain, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push(std::move(task));
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::WorkerMain() {
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t minBatch) {
+	if (count == 0)
+		return;
+
+	// A few batches per thread so uneven batches still balance out
+	const size_t threads = workers.size() + 1;
+	const size_t batchSize = std::max(std::max<size_t>(minBatch, 1), (count + threads * 4 - 1) / (threads * 4));
+	const size_t batchCount = (count + batchSize - 1) / batchSize;
+
+	struct Shared {
+		std::atomic<size_t> nextBatch{ 0 };
+		std::atomic<size_t> doneBatches{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+
+	auto runBatches = [shared, &body, count, batchSize, batchCount]() {
+		size_t batch;
+		while ((batch = shared->nextBatch.fetch_add(1)) < batchCount) {
+			size_t begin = batch * batchSize;
+			body(begin, std::min(count, begin + batchSize));
+			if (shared->doneBatches.fetch_add(1) + 1 == batchCount) {
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				shared->done.notify_all();
+			}
+		}
+	};
+
+	const size_t helpers = std::min(workers.size(), batchCount - 1);
+	for (size_t i = 0; i < helpers; ++i)
+		Enqueue(runBatches);
+
+	runBatches();
+
+	std::unique_lock<std::mutex> lock(shared->mutex);
+	shared->done.wait(lock, [&]() { return shared->doneBatches.load() == batchCount; });
+}
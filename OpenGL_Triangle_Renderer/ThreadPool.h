@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ===| Thread Pool |===========================================================================
+//
+// Fixed set of worker threads for CPU-side work (file loading, parsing, culling, ...).
+// Never touches GL: only the thread that owns the context may issue GL calls.
+
+class ThreadPool {
+public:
+	// 0 = one worker per hardware thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	template <class F>
+	auto Submit(F&& task) -> std::future<decltype(task())> {
+		typedef decltype(task()) Result;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> result = packaged->get_future();
+		Enqueue([packaged]() { (*packaged)(); });
+		return result;
+	}
+
+	// Splits [0, count) into batches of at least minBatch items and runs body(begin, end) on the
+	// workers. The calling thread takes batches too, so this is safe to call from a worker.
+	void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t minBatch = 1);
+
+private:
+	void Enqueue(std::function<void()> task);
+	void WorkerMain();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+// ===| Triple Buffer |=========================================================================
+//
+// Lock-free handoff of the newest value from one writer thread to one reader thread. Of the
+// three slots the writer owns one (back), the reader owns one (front) and the third (middle)
+// holds the newest published value. Publishing swaps back with middle, taking a new back; the
+// reader swaps front with middle only when middle holds something it has not seen. Both are a
+// single atomic exchange, so neither side ever waits, the writer never overwrites what the
+// reader is looking at, and the reader skips straight to the newest value when several were
+// published in between. Slots are reused as they are, so vectors inside keep their capacity.
+
+template <class T>
+class TripleBuffer {
+public:
+	TripleBuffer() = default;
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// Writer: the slot to fill next, holding whatever was published into it before
+	T& Back() { return slots[back]; }
+	// Writer: makes Back() the newest value
+	void Publish() {
+		back = middle.exchange(back | Fresh, std::memory_order_acq_rel) & Index;
+	}
+
+	// Reader: moves to the newest value if one was published since; true when it did
+	bool Update() {
+		if (!(middle.load(std::memory_order_relaxed) & Fresh))
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & Index;
+		return true;
+	}
+	// Reader: the value Update() last moved to
+	const T& Front() const { return slots[front]; }
+
+private:
+	static const unsigned int Index = 3;
+	static const unsigned int Fresh = 4;   // middle was published and not yet taken
+
+	T slots[3];
+	alignas(64) std::atomic<unsigned int> middle{ 1 };
+	alignas(64) unsigned int back = 0;     // writer only
+	alignas(64) unsigned int front = 2;    // reader only
+};
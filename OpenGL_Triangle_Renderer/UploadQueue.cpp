@@ -0,0 +1,239 @@
+#include "UploadQueue.h"
+#include "FrameHistory.h"
+#include "Mesh.h"
+#include "StateCache.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// ===| Upload Queue |==========================================================================
+
+UploadQueue::UploadQueue(size_t frameBudgetBytes, int stagingFrames)
+	: frameBudget(std::max<size_t>(frameBudgetBytes, 4096)),
+	// Slack for the alignment padding between pieces, so a full frame never outgrows a segment
+	staging(new StreamingBuffer(GL_COPY_READ_BUFFER, frameBudget + 4096, stagingFrames, StreamPolicy::Wait)),
+	ready(1, false) {
+}
+
+UploadQueue::~UploadQueue() {
+	for (FencedBatch& batch : fenced)
+		glDeleteSync(batch.fence);
+}
+
+UploadId UploadQueue::Enqueue(Job job) {
+	job.id = nextId++;
+	ready.push_back(false);
+	jobs.push_back(std::move(job));
+	return jobs.back().id;
+}
+
+UploadId UploadQueue::UploadBuffer(unsigned int buffer, size_t offset, std::vector<unsigned char> data) {
+	Job job;
+	job.kind = JobKind::Buffer;
+	job.object = buffer;
+	job.offset = offset;
+	job.data = std::move(data);
+	return Enqueue(std::move(job));
+}
+
+UploadId UploadQueue::UploadTexture2D(unsigned int texture, int level, int width, int height, GLenum format, GLenum type,
+	unsigned int bytesPerPixel, std::vector<unsigned char> data) {
+	Job job;
+	job.kind = JobKind::Texture;
+	job.object = texture;
+	job.level = level;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.type = type;
+	job.rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+	job.data = std::move(data);
+	return Enqueue(std::move(job));
+}
+
+UploadId UploadQueue::UploadCompressedTexture2D(unsigned int texture, int level, int width, int height, GLenum format,
+	unsigned int blockBytes, std::vector<unsigned char> data) {
+	Job job;
+	job.kind = JobKind::CompressedTexture;
+	job.object = texture;
+	job.level = level;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.rowBytes = static_cast<size_t>((width + 3) / 4) * blockBytes;
+	job.rowHeight = 4;
+	job.data = std::move(data);
+	return Enqueue(std::move(job));
+}
+
+bool UploadQueue::Ready(UploadId id) const {
+	return id < ready.size() && ready[id];
+}
+
+size_t UploadQueue::PendingBytes() const {
+	size_t bytes = 0;
+	for (const Job& job : jobs)
+		bytes += job.data.size() - job.done;
+	return bytes;
+}
+
+void UploadQueue::Issue(Job& job, size_t stagingOffset, size_t bytes) {
+	if (job.kind == JobKind::Buffer) {
+		glState.BindBuffer(GL_COPY_READ_BUFFER, staging->Buffer());
+		glState.BindBuffer(GL_COPY_WRITE_BUFFER, job.object);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, job.offset + job.done, bytes);
+		return;
+	}
+
+	// Whole rows only, so every piece is a rectangle of the level
+	const int firstRow = static_cast<int>(job.done / job.rowBytes);
+	const int rows = static_cast<int>(bytes / job.rowBytes);
+	const int y = firstRow * job.rowHeight;
+	const int height = std::min(rows * job.rowHeight, job.height - y);
+	const void* source = reinterpret_cast<const void*>(static_cast<uintptr_t>(stagingOffset));
+
+	glState.BindTexture(0, GL_TEXTURE_2D, job.object);
+	glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->Buffer());
+	if (job.kind == JobKind::CompressedTexture) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, job.width, height, job.format, static_cast<GLsizei>(bytes), source);
+	}
+	else {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, job.width, height, job.format, job.type, source);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	// Left bound, every later client-memory texture upload would read from the staging buffer
+	glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadQueue::Update() {
+	const auto start = std::chrono::steady_clock::now();
+	UploadFrameStats frame;
+
+	// Earlier batches the GPU has finished with
+	while (!fenced.empty()) {
+		GLsync fence = fenced.front().fence;
+		const GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		for (UploadId id : fenced.front().ids)
+			ready[id] = true;
+		frame.completed += static_cast<unsigned int>(fenced.front().ids.size());
+		glDeleteSync(fence);
+		fenced.pop_front();
+	}
+
+	// Plan this frame's pieces: front of the queue first, whole rows for textures, at least one
+	// piece per frame even when a single row exceeds the budget
+	struct Piece {
+		Job* job;
+		size_t bytes;
+	};
+	std::vector<Piece> pieces;
+	size_t planned = 0;
+	for (Job& job : jobs) {
+		const size_t remaining = job.data.size() - job.done;
+		size_t bytes = std::min(remaining, frameBudget - planned);
+		if (job.kind != JobKind::Buffer) {
+			bytes = bytes / job.rowBytes * job.rowBytes;
+			if (bytes == 0 && planned == 0)
+				bytes = job.rowBytes;
+		}
+		else {
+			bytes &= ~size_t(3);   // keep copies 4-byte aligned; the final piece takes the tail
+			if (bytes == 0 && planned == 0)
+				bytes = std::min<size_t>(remaining, 4);
+			if (remaining - bytes < 4)
+				bytes = remaining;
+		}
+		if (bytes == 0)
+			break;
+		pieces.push_back({ &job, bytes });
+		planned += bytes;
+		if (planned >= frameBudget)
+			break;
+	}
+
+	if (!pieces.empty()) {
+		// One mapping per frame; 4-byte aligned pieces keep texture rows and buffer copies legal
+		size_t stagingBase = 0;
+		size_t mappedBytes = 0;
+		for (const Piece& piece : pieces)
+			mappedBytes += (piece.bytes + 3) & ~size_t(3);
+		unsigned char* mapped = static_cast<unsigned char*>(staging->Map(mappedBytes, 4, &stagingBase));
+		if (mapped) {
+			size_t offset = 0;
+			for (const Piece& piece : pieces) {
+				std::memcpy(mapped + offset, piece.job->data.data() + piece.job->done, piece.bytes);
+				offset += (piece.bytes + 3) & ~size_t(3);
+			}
+			staging->Unmap();
+
+			offset = 0;
+			FencedBatch batch;
+			for (const Piece& piece : pieces) {
+				Issue(*piece.job, stagingBase + offset, piece.bytes);
+				piece.job->done += piece.bytes;
+				offset += (piece.bytes + 3) & ~size_t(3);
+				if (piece.job->done == piece.job->data.size())
+					batch.ids.push_back(piece.job->id);
+			}
+			frame.bytes = planned;
+			frame.pieces = static_cast<unsigned int>(pieces.size());
+
+			// Finished jobs free their data now; their fence is what the caller waits on
+			while (!jobs.empty() && jobs.front().done == jobs.front().data.size())
+				jobs.pop_front();
+			if (!batch.ids.empty()) {
+				batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				fenced.push_back(std::move(batch));
+			}
+		}
+	}
+	staging->EndFrame();
+
+	frame.pendingBytes = PendingBytes();
+	frame.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastFrame = frame;
+	AppendHistory(history, frame);
+}
+
+// ===| Async Mesh |============================================================================
+
+GpuMesh UploadMeshAsync(UploadQueue& queue, const Mesh& mesh, const VertexLayout& layout, UploadId ids[2]) {
+	GpuMesh gpuMesh;
+	gpuMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+	gpuMesh.indexType = ChooseIndexType(mesh.VertexCount());
+	gpuMesh.vertexCount = mesh.VertexCount();
+
+	std::vector<unsigned char> vertices = PackVertices(layout, mesh.Streams());
+	std::vector<unsigned char> indices(mesh.indices.size() * IndexTypeSize(gpuMesh.indexType));
+	if (gpuMesh.indexType == GL_UNSIGNED_SHORT) {
+		for (size_t i = 0; i < mesh.indices.size(); ++i) {
+			const uint16_t index = static_cast<uint16_t>(mesh.indices[i]);
+			std::memcpy(&indices[i * 2], &index, sizeof(index));
+		}
+	}
+	else {
+		std::memcpy(indices.data(), mesh.indices.data(), indices.size());
+	}
+
+	// Storage only; the contents arrive through the queue
+	glGenVertexArrays(1, &gpuMesh.VAO);
+	glState.BindVertexArray(gpuMesh.VAO);
+	glGenBuffers(1, &gpuMesh.VBO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), NULL, GL_STATIC_DRAW);
+	layout.Apply();
+	glGenBuffers(1, &gpuMesh.EBO);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), NULL, GL_STATIC_DRAW);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	ids[0] = queue.UploadBuffer(gpuMesh.VBO, 0, std::move(vertices));
+	ids[1] = queue.UploadBuffer(gpuMesh.EBO, 0, std::move(indices));
+	return gpuMesh;
+}
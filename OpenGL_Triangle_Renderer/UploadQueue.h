@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "StreamingBuffer.h"
+
+struct GpuMesh;
+struct Mesh;
+class VertexLayout;
+
+// ===| Upload Queue |==========================================================================
+//
+// Moves buffer and texture data to the GPU a little every frame instead of all at once. Each
+// Update() copies at most frameBudget bytes of queued data into the current segment of a mapped
+// staging ring (a StreamingBuffer, so the CPU writes while the GPU still reads older segments)
+// and issues GPU-side copies from it: glCopyBufferSubData for buffers, glTexSubImage2D from a
+// pixel unpack buffer for textures. Large resources are split across frames. When the last piece
+// of a resource has been issued, a glFenceSync marks it; the resource is Ready() once the fence
+// has signaled, checked without ever waiting.
+//
+// Everything runs on the GL thread; data is handed over by value, so it can be produced on the
+// thread pool and queued whenever it arrives.
+
+typedef uint32_t UploadId;   // 0 is never a valid id
+
+struct UploadFrameStats {
+	size_t bytes = 0;             // staged and copied this frame
+	unsigned int pieces = 0;      // copy commands issued
+	unsigned int completed = 0;   // resources that became ready
+	size_t pendingBytes = 0;      // still queued after this frame
+	double milliseconds = 0.0;    // CPU time spent in Update()
+};
+
+class UploadQueue {
+public:
+	explicit UploadQueue(size_t frameBudgetBytes, int stagingFrames = 3);
+	~UploadQueue();
+
+	UploadQueue(const UploadQueue&) = delete;
+	UploadQueue& operator=(const UploadQueue&) = delete;
+
+	// Copies data into buffer at offset; the buffer must already have the storage
+	UploadId UploadBuffer(unsigned int buffer, size_t offset, std::vector<unsigned char> data);
+	// Tightly packed rows into one mip level of a GL_TEXTURE_2D that already has its storage
+	UploadId UploadTexture2D(unsigned int texture, int level, int width, int height, GLenum format, GLenum type,
+		unsigned int bytesPerPixel, std::vector<unsigned char> data);
+	// Same for a block-compressed level: rows are rows of 4x4 blocks of blockBytes each
+	UploadId UploadCompressedTexture2D(unsigned int texture, int level, int width, int height, GLenum format,
+		unsigned int blockBytes, std::vector<unsigned char> data);
+
+	// Issues this frame's share of the queue and notices finished resources; once per frame
+	void Update();
+	bool Ready(UploadId id) const;
+	bool Idle() const { return jobs.empty() && fenced.empty(); }
+	size_t PendingBytes() const;
+	size_t Submitted() const { return nextId - 1; }
+
+	void SetFrameBudget(size_t bytes) { frameBudget = bytes; }
+	size_t FrameBudget() const { return frameBudget; }
+
+	const UploadFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<UploadFrameStats>& History() const { return history; }
+	void ClearHistory() { history.clear(); }
+
+private:
+	enum class JobKind { Buffer, Texture, CompressedTexture };
+
+	struct Job {
+		UploadId id = 0;
+		JobKind kind = JobKind::Buffer;
+		unsigned int object = 0;
+		size_t offset = 0;            // buffers: destination offset
+		int level = 0;
+		int width = 0;
+		int height = 0;
+		GLenum format = 0;
+		GLenum type = 0;
+		size_t rowBytes = 0;          // textures: bytes per row (of pixels or blocks)
+		int rowHeight = 1;            // pixels per row: 4 for block-compressed data
+		std::vector<unsigned char> data;
+		size_t done = 0;              // bytes already issued
+	};
+
+	struct FencedBatch {
+		GLsync fence = nullptr;
+		std::vector<UploadId> ids;
+	};
+
+	UploadId Enqueue(Job job);
+	void Issue(Job& job, size_t stagingOffset, size_t bytes);
+
+	size_t frameBudget;
+	std::unique_ptr<StreamingBuffer> staging;
+	std::deque<Job> jobs;
+	std::deque<FencedBatch> fenced;
+	std::vector<bool> ready;      // by id
+	UploadId nextId = 1;
+
+	UploadFrameStats lastFrame;
+	std::vector<UploadFrameStats> history;
+};
+
+// Creates mesh's buffers and VAO right away with uninitialized storage and queues its vertex
+// and index data; ids receive the two uploads, and the mesh may be drawn once both are Ready()
+GpuMesh UploadMeshAsync(UploadQueue& queue, const Mesh& mesh, const VertexLayout& layout, UploadId ids[2]);
@@ -0,0 +1,200 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ===| Vertex Layout |=========================================================================
+
+unsigned int AttribFormatSize(AttribFormat format) {
+	switch (format) {
+	case AttribFormat::Float3:      return 12;
+	case AttribFormat::Half4:       return 8;
+	case AttribFormat::UNorm8x4:    return 4;
+	case AttribFormat::Float2:      return 8;
+	case AttribFormat::Half2:       return 4;
+	}
+	return 0;
+}
+
+VertexLayout& VertexLayout::Add(unsigned int location, AttribFormat format) {
+	VertexAttribute attribute;
+	attribute.location = location;
+	attribute.format = format;
+	attribute.offset = stride;
+	attributes.push_back(attribute);
+
+	// Every format is a multiple of 4 bytes, so attributes stay 4-byte aligned
+	stride += AttribFormatSize(format);
+	return *this;
+}
+
+const VertexAttribute* VertexLayout::Find(unsigned int location) const {
+	for (const VertexAttribute& attribute : attributes) {
+		if (attribute.location == location)
+			return &attribute;
+	}
+	return nullptr;
+}
+
+void VertexLayout::Apply(size_t baseOffset) const {
+	for (const VertexAttribute& attribute : attributes) {
+		const void* pointer = (void*)(baseOffset + attribute.offset);
+		glEnableVertexAttribArray(attribute.location);
+
+		switch (attribute.format) {
+		case AttribFormat::Float3:
+			glVertexAttribPointer(attribute.location, 3, GL_FLOAT, GL_FALSE, stride, pointer);
+			break;
+		case AttribFormat::Half4:
+			glVertexAttribPointer(attribute.location, 3, GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+			break;
+		case AttribFormat::UNorm8x4:
+			glVertexAttribPointer(attribute.location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, pointer);
+			break;
+		case AttribFormat::Float2:
+			glVertexAttribPointer(attribute.location, 2, GL_FLOAT, GL_FALSE, stride, pointer);
+			break;
+		case AttribFormat::Half2:
+			glVertexAttribPointer(attribute.location, 2, GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+			break;
+		}
+	}
+}
+
+VertexLayout VertexLayout::Float() {
+	VertexLayout layout;
+	layout.Add(ATTRIB_POSITION, AttribFormat::Float3).Add(ATTRIB_COLOR, AttribFormat::Float3);
+	return layout;
+}
+
+VertexLayout VertexLayout::Packed() {
+	VertexLayout layout;
+	layout.Add(ATTRIB_POSITION, AttribFormat::Half4).Add(ATTRIB_COLOR, AttribFormat::UNorm8x4);
+	return layout;
+}
+
+// ===| Packing |===============================================================================
+
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	const uint32_t absBits = bits & 0x7FFFFFFFu;
+
+	if (absBits >= 0x7F800000u)                        // Inf / NaN
+		return static_cast<uint16_t>(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+	if (absBits >= 0x477FF000u)                        // rounds past the largest half: Inf
+		return static_cast<uint16_t>(sign | 0x7C00u);
+
+	if (absBits < 0x38800000u) {                       // half denormal or zero
+		if (absBits < 0x33000000u)
+			return static_cast<uint16_t>(sign);
+		const uint32_t mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
+		const int shift = 126 - static_cast<int>(absBits >> 23);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1u)))
+			++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Normal: rebias the exponent, round the mantissa to nearest even
+	uint32_t half = ((absBits - 0x38000000u) >> 13);
+	const uint32_t remainder = absBits & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+		++half;
+	return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1Fu;
+	const uint32_t mantissa = value & 0x3FFu;
+
+	uint32_t bits;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		}
+		else {
+			float f = std::ldexp(static_cast<float>(mantissa), -24);
+			std::memcpy(&bits, &f, sizeof(bits));
+			bits |= sign;
+		}
+	}
+	else if (exponent == 31) {
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	}
+	else {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static uint32_t unorm(float value, float scale) {
+	return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * scale));
+}
+
+uint32_t PackUNorm8x4(float r, float g, float b, float a) {
+	// Byte order in memory is r, g, b, a (little-endian)
+	return unorm(r, 255.0f) | (unorm(g, 255.0f) << 8) | (unorm(b, 255.0f) << 16) | (unorm(a, 255.0f) << 24);
+}
+
+static void packAttribute(AttribFormat format, const float* src, unsigned char* dst) {
+	switch (format) {
+	case AttribFormat::Float3:
+		std::memcpy(dst, src, 3 * sizeof(float));
+		break;
+	case AttribFormat::Half4: {
+		const uint16_t half[4] = { FloatToHalf(src[0]), FloatToHalf(src[1]), FloatToHalf(src[2]), FloatToHalf(1.0f) };
+		std::memcpy(dst, half, sizeof(half));
+		break;
+	}
+	case AttribFormat::UNorm8x4: {
+		const uint32_t packed = PackUNorm8x4(src[0], src[1], src[2], 1.0f);
+		std::memcpy(dst, &packed, sizeof(packed));
+		break;
+	}
+	case AttribFormat::Float2:
+		std::memcpy(dst, src, 2 * sizeof(float));
+		break;
+	case AttribFormat::Half2: {
+		const uint16_t half[2] = { FloatToHalf(src[0]), FloatToHalf(src[1]) };
+		std::memcpy(dst, half, sizeof(half));
+		break;
+	}
+	}
+}
+
+void PackVertices(const VertexLayout& layout, const VertexStreams& streams, unsigned char* dst) {
+	const unsigned int stride = layout.Stride();
+	std::memset(dst, 0, stride * streams.count);
+
+	for (const VertexAttribute& attribute : layout.Attributes()) {
+		const float* src = nullptr;
+		size_t components = 3;
+		switch (attribute.location) {
+		case ATTRIB_POSITION: src = streams.positions; break;
+		case ATTRIB_COLOR:    src = streams.colors; break;
+		case ATTRIB_TEXCOORD: src = streams.texcoords; components = 2; break;
+		}
+		if (src == nullptr)
+			continue;
+
+		unsigned char* out = dst + attribute.offset;
+		for (size_t i = 0; i < streams.count; ++i, out += stride, src += components)
+			packAttribute(attribute.format, src, out);
+	}
+}
+
+std::vector<unsigned char> PackVertices(const VertexLayout& layout, const VertexStreams& streams) {
+	std::vector<unsigned char> packed(static_cast<size_t>(layout.Stride()) * streams.count);
+	PackVertices(layout, streams, packed.data());
+	return packed;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===| Vertex Layout |=========================================================================
+//
+// Describes one interleaved vertex buffer: which attribute sits at which offset in what format.
+// The same description packs the CPU-side float data and sets up glVertexAttribPointer, so the
+// two can never disagree.
+
+// Attribute locations shared with the shaders (layout(location = N) in vertexShader.glsl)
+enum AttribLocation : unsigned int {
+	ATTRIB_POSITION = 0,
+	ATTRIB_COLOR = 1,
+	ATTRIB_INSTANCE_OFFSET_SCALE = 3,
+	ATTRIB_INSTANCE_COLOR = 4,
+	ATTRIB_TEXCOORD = 5
+};
+
+enum class AttribFormat : uint8_t {
+	Float3,          // 12 bytes, GL_FLOAT
+	Half4,           //  8 bytes, GL_HALF_FLOAT (3 used, padded to keep 4-byte alignment)
+	UNorm8x4,        //  4 bytes, GL_UNSIGNED_BYTE normalized
+	Float2,          //  8 bytes, GL_FLOAT
+	Half2            //  4 bytes, GL_HALF_FLOAT
+};
+
+struct VertexAttribute {
+	unsigned int location = 0;
+	AttribFormat format = AttribFormat::Float3;
+	unsigned int offset = 0;
+};
+
+class VertexLayout {
+public:
+	// Appends an attribute at the end of the vertex
+	VertexLayout& Add(unsigned int location, AttribFormat format);
+
+	unsigned int Stride() const { return stride; }
+	const std::vector<VertexAttribute>& Attributes() const { return attributes; }
+	const VertexAttribute* Find(unsigned int location) const;
+
+	// Enables and points every attribute at the currently bound GL_ARRAY_BUFFER
+	void Apply(size_t baseOffset = 0) const;
+
+	// position + color as 32-bit floats: the original 24 bytes per vertex
+	static VertexLayout Float();
+	// half-float position + normalized byte color: 12 bytes per vertex
+	static VertexLayout Packed();
+
+private:
+	std::vector<VertexAttribute> attributes;
+	unsigned int stride = 0;
+};
+
+unsigned int AttribFormatSize(AttribFormat format);
+
+// ===| Packing |===============================================================================
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+uint32_t PackUNorm8x4(float r, float g, float b, float a);
+
+// Float source streams, 3 floats per vertex each (2 for texcoords); null streams are skipped (the
+// attribute keeps whatever default the format gives zero bytes)
+struct VertexStreams {
+	size_t count = 0;
+	const float* positions = nullptr;
+	const float* colors = nullptr;
+	const float* texcoords = nullptr;
+};
+
+// Interleaves and converts the streams into layout.Stride() * streams.count bytes at dst
+void PackVertices(const VertexLayout& layout, const VertexStreams& streams, unsigned char* dst);
+std::vector<unsigned char> PackVertices(const VertexLayout& layout, const VertexStreams& streams);
@@ -0,0 +1,97 @@
+#include "WindowEvents.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+#include <thread>
+
+// ===| Window Events |=========================================================================
+
+static double milliseconds(std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+WindowEvents::WindowEvents(GLFWwindow* window, int stallMilliseconds)
+	: window(window), stallMilliseconds(std::max(stallMilliseconds, 0)) {
+	previousUser = glfwGetWindowUserPointer(window);
+	glfwSetWindowUserPointer(window, this);
+	previousKey = glfwSetKeyCallback(window, keyCallback);
+	previousResize = glfwSetFramebufferSizeCallback(window, resizeCallback);
+}
+
+WindowEvents::~WindowEvents() {
+	glfwSetKeyCallback(window, previousKey);
+	glfwSetFramebufferSizeCallback(window, previousResize);
+	glfwSetWindowUserPointer(window, previousUser);
+}
+
+void WindowEvents::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	(void)scancode;
+	(void)mods;
+	static_cast<WindowEvents*>(glfwGetWindowUserPointer(window))->Post(WindowEventType::Key, key, action);
+}
+
+// Replaces framebuffer_size_callback: the viewport is set by whoever holds the context
+void WindowEvents::resizeCallback(GLFWwindow* window, int width, int height) {
+	static_cast<WindowEvents*>(glfwGetWindowUserPointer(window))->Post(WindowEventType::Resize, width, height);
+}
+
+// Key and resize events are dropped when the queue is full; Close is not, its caller retries it
+bool WindowEvents::Post(WindowEventType type, int a, int b) {
+	WindowEvent event;
+	event.type = type;
+	event.a = a;
+	event.b = b;
+	event.posted = Clock::now();
+	if (queue.TryPush(event)) {
+		++pump.events;
+		return true;
+	}
+	if (type != WindowEventType::Close)
+		++pump.dropped;
+	return false;
+}
+
+void WindowEvents::Pump(bool wait) {
+	const Clock::time_point start = Clock::now();
+	if (wait)
+		glfwWaitEventsTimeout(0.01);
+	else
+		glfwPollEvents();
+
+	if (stallMilliseconds > 0 && start - lastStall >= std::chrono::milliseconds(100)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(stallMilliseconds));
+		lastStall = start;
+		++pump.stalls;
+	}
+
+	// A full queue leaves closePosted unset, so the next pump posts Close again
+	if (!closePosted && glfwWindowShouldClose(window))
+		closePosted = Post(WindowEventType::Close, 0, 0);
+
+	++pump.pumps;
+}
+
+bool WindowEvents::Pop(WindowEvent& event) {
+	if (!queue.TryPop(event))
+		return false;
+	++current.events;
+	current.maxLatencyMilliseconds = std::max(current.maxLatencyMilliseconds, milliseconds(Clock::now() - event.posted));
+	return true;
+}
+
+void WindowEvents::EndFrame() {
+	const Clock::time_point now = Clock::now();
+	if (lastFrameEnd != Clock::time_point()) {
+		current.intervalMilliseconds = milliseconds(now - lastFrameEnd);
+		lastFrame = current;
+		AppendHistory(history, current);
+	}
+	lastFrameEnd = now;
+	current = EventFrameStats();
+}
+
+void WindowEvents::ClearHistory() {
+	history.clear();
+	lastFrameEnd = Clock::time_point();
+	current = EventFrameStats();
+}
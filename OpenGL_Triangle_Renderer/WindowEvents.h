@@ -0,0 +1,102 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SpscQueue.h"
+
+// ===| Window Events |=========================================================================
+//
+// Moves window events from the thread that owns the window to the thread that renders.
+// GLFW only lets the thread that created the window process its events, and a slow event
+// (a resize, a window drag, a busy compositor) holds that thread up. With a render thread the
+// context lives there and the main thread only pumps events: the callbacks turn them into
+// WindowEvents and push them into a lock-free SPSC queue, and the render thread drains it at
+// the start of every frame. Neither side ever waits for the other.
+// The same class works on one thread too: RenderLoop then pumps and drains in turn, which is
+// what the render thread is measured against. Either way every render frame records its
+// interval, so hitches (frames far longer than the median) show whether events stalled it.
+
+enum class WindowEventType : uint8_t {
+	Key,
+	Resize,
+	Close
+};
+
+struct WindowEvent {
+	WindowEventType type = WindowEventType::Key;
+	int a = 0;   // Key: the key; Resize: framebuffer width
+	int b = 0;   // Key: the action; Resize: framebuffer height
+	std::chrono::steady_clock::time_point posted;
+};
+
+struct EventFrameStats {
+	unsigned int events = 0;             // drained at the start of this frame
+	double maxLatencyMilliseconds = 0.0; // longest time one of them waited in the queue
+	double intervalMilliseconds = 0.0;   // render time since the previous frame
+};
+
+struct EventPumpStats {
+	size_t pumps = 0;
+	size_t events = 0;
+	size_t dropped = 0;                  // key/resize, queue full: the render thread is far behind
+	size_t stalls = 0;                   // injected slow events
+};
+
+class WindowEvents {
+public:
+	// Installs key and framebuffer size callbacks on window that post to the queue.
+	// stallMilliseconds: at most every 100 ms, one Pump() takes this much longer, standing in for
+	// a slow window event (0 = never).
+	WindowEvents(GLFWwindow* window, int stallMilliseconds = 0);
+	~WindowEvents();
+
+	WindowEvents(const WindowEvents&) = delete;
+	WindowEvents& operator=(const WindowEvents&) = delete;
+
+	// Event thread: processes the window's events, waiting up to a few ms for one when wait is
+	// set (glfwPostEmptyEvent wakes it), and posts Close once the window should close
+	void Pump(bool wait);
+
+	// Render thread: the next event, if any
+	bool Pop(WindowEvent& event);
+	// Render thread: after the frame is presented
+	void EndFrame();
+
+	// Read once the render thread is done with the run
+	const EventPumpStats& PumpStats() const { return pump; }
+	const EventFrameStats& LastFrameStats() const { return lastFrame; }
+	const std::vector<EventFrameStats>& History() const { return history; }
+	// Render thread, before a run: also restarts the frame interval
+	void ClearHistory();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	static void resizeCallback(GLFWwindow* window, int width, int height);
+	// True when the event was queued
+	bool Post(WindowEventType type, int a, int b);
+
+	GLFWwindow* window;
+	int stallMilliseconds;
+	GLFWkeyfun previousKey = NULL;
+	GLFWframebuffersizefun previousResize = NULL;
+	void* previousUser = NULL;
+
+	SpscQueue<WindowEvent, 256> queue;
+
+	// Event thread only
+	bool closePosted = false;
+	Clock::time_point lastStall;
+	EventPumpStats pump;
+
+	// Render thread only
+	EventFrameStats current;
+	Clock::time_point lastFrameEnd;
+	EventFrameStats lastFrame;
+	std::vector<EventFrameStats> history;
+};
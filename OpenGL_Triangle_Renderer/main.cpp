@@ -4,25 +4,497 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <atomic>
+#include <thread>
+
+#include "Benchmark.h"
+#include "Culling.h"
+#include "DynamicMesh.h"
+#include "FrameCapture.h"
+#include "FrameHistory.h"
+#include "FramePacer.h"
+#include "GLExtensions.h"
+#include "Headless.h"
+#include "ImageDiff.h"
+#include "Instancing.h"
+#include "Lod.h"
+#include "MathUtil.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MeshOptimizer.h"
+#include "MeshStreamImporter.h"
+#include "OcclusionCuller.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "ShaderManager.h"
+#include "Simulation.h"
+#include "SoftwareRasterizer.h"
+#include "StateCache.h"
+#include "TextureManager.h"
+#include "ThreadPool.h"
+#include "UploadQueue.h"
+#include "VertexLayout.h"
+#include "WindowEvents.h"
 
 const int SCR_WIDTH = 750;
 const int SCR_HEIGHT = 750;
 
-// ===| Load Shader Programs |==================================================================
+// ===| Command Line Options |==================================================================
+
+struct RenderOptions {
+	bool headless = false;         // --headless : no window, render into an FBO (EGL surfaceless)
+	bool osmesa = false;           // --osmesa   : headless through OSMesa instead of EGL
+	int frameCount = 0;            // --frames N : stop after N frames (0 = until the window closes)
+	int width = SCR_WIDTH;         // --size WxH : offscreen target size
+	int height = SCR_HEIGHT;
+	std::string outputDir;         // --output DIR : write each headless frame as DIR/frame_NNNNN.ppm
+	CaptureFormat captureFormat = CaptureFormat::Frames;  // --capture-raw F | --capture-y4m F | --capture-pipe CMD
+	std::string captureTarget;     // the file or command of the --capture-* option given
+	int captureRing = 3;           // --capture-ring N : pixel pack buffers frames are read back through
+	int captureFps = 60;           // --capture-fps N : frame rate in the Y4M header
+	PacingMode pacing = PacingMode::Driver;  // --pacing driver|uncapped|vsync|limit
+	double targetFps = 60.0;       // --target-fps N : frame rate --pacing limit holds
+	int framesInFlight = 0;        // --frames-in-flight N : frames the CPU may run ahead of the GPU (0 = no limit)
+	bool renderThread = false;     // --render-thread : render on a thread of its own, events stay on the main thread
+	int eventStallMs = 0;          // --event-stall MS : make one event pump every 100 ms take MS longer
+	bool simThread = false;        // --sim-thread : step the animation at a fixed rate on its own thread
+	double simRate = 60.0;         // --sim-rate HZ : simulation steps per second
+	int benchmarkFrames = 0;       // --benchmark N : time N frames and report statistics as JSON
+	int warmupFrames = 10;         // --warmup N : frames excluded from the benchmark statistics
+	std::string benchmarkOut;      // --benchmark-out FILE : JSON destination (default: stdout)
+	std::string shaderCacheDir = "./shader_cache";  // --shader-cache DIR / --no-shader-cache
+	int stressPrograms = 0;        // --shader-stress N : also build N shader variants at startup
+	bool packedVertices = true;    // --vertex-format packed|float
+	std::string meshName = "triangle";  // --mesh triangle|grid|flower
+	int gridSize = 64;             // --grid-size N : N x N quads for the grid mesh
+	bool shuffleTriangles = false; // --shuffle-triangles : randomize triangle order before optimizing
+	bool optimizeMesh = true;      // --no-mesh-optimize : keep the index order as generated
+	bool meshStats = false;        // --mesh-stats : print vertex cache statistics
+	int instanceCount = 0;         // --instances N : draw N copies of the mesh with one instanced draw
+	int instanceSweepMax = 0;      // --instance-sweep MAX : benchmark 1, 10, ... MAX instances
+	bool dynamic = false;          // --dynamic : regenerate the mesh vertices every frame and stream them
+	StreamPolicy streamPolicy = StreamPolicy::Wait;  // --stream-policy wait|orphan
+	bool stateCache = true;        // --no-state-cache : issue every bind, even redundant ones
+	int objectCount = 0;           // --objects N : draw N separate objects through the render queue
+	int objectPrograms = 8;        // --object-programs N : shader variants spread over the objects
+	bool sortQueue = true;         // --no-sort : draw queued objects in submission order
+	int recordBuffers = 0;         // --record N : record queued draws into N command buffers on the pool
+	float cameraZoom = 1.0f;       // --camera-zoom Z : zoom into the object scene and pan around it
+	bool cull = false;             // --cull : frustum cull objects through a BVH before queueing them
+	CullSimd cullSimd = BestCullSimd();  // --cull-simd scalar|sse|avx2
+	int cullBenchObjects = 0;      // --cull-bench N : CPU-only culling benchmark over N objects, no GL
+	int objectLayers = 1;          // --object-layers N : objects stacked behind each other per grid cell
+	bool occlusion = false;        // --occlusion : occlusion queries + conditional rendering for objects
+	bool lod = false;              // --lod : simplified mesh levels for objects, chosen by screen-space error
+	float lodPixelError = 1.0f;    // --lod-error PX : largest error, in pixels, a level may show
+	std::string meshFile;          // --mesh-file F : draw the mesh from a binary mesh file
+	std::string convertSource;     // --convert-mesh IN OUT : OBJ/PLY to binary mesh file, no GL
+	std::string convertTarget;
+	std::string importFile;        // --import F : stream an ascii OBJ/PLY file into GPU buffers and draw it
+	int importWindowMB = 64;       // --import-window MB : file bytes parsed per streaming step
+	bool weld = true;              // --no-weld : keep duplicate vertices when importing
+	int importBenchMaxMB = 0;      // --import-bench MAX_MB : import synthetic OBJ files of 10 MB .. MAX_MB
+	bool asyncUpload = false;      // --async-upload : upload the mesh through the upload queue while frames run
+	int uploadBudgetKB = 1024;     // --upload-budget KB : bytes the upload queue may move per frame
+	int textureCount = 0;          // --textures N : generated textures on the mesh, or spread over the objects
+	std::string textureFile;       // --texture F : binary PPM image used as the first texture
+	int textureSize = 1024;        // --texture-size N : generated textures are N x N
+	bool compressTextures = true;  // --no-texture-compression : RGBA8 even when the driver has BC1
+	bool software = false;         // --software : rasterize the mesh on the CPU, no GL context at all
+	CullSimd rasterSimd = BestCullSimd();  // --raster-simd scalar|sse|avx2
+	bool rasterBench = false;      // --raster-bench : software rasterizer vs GL throughput on a few scenes
+	std::string goldenDir;         // --golden DIR : render the golden scenes and compare them with DIR/<scene>.ppm
+	bool goldenUpdate = false;     // --golden-update : write the references instead of comparing
+	std::string goldenScene;       // --golden-scene NAME : only run this golden scene
+	int goldenTolerance = 2;       // --golden-tolerance N : largest channel difference that still matches
+	int goldenMaxPixels = 0;       // --golden-max-pixels N : pixels allowed past the tolerance
+};
 
-std::string LoadShaderProgram(const std::string& filename) {
-	std::string shaderStr = "";
-	std::string line = "";
+static void printUsage() {
+	std::cout << "Usage: OpenGL_Triangle_Renderer [options]\n"
+		<< "  --headless         Render offscreen without a window (EGL surfaceless context)\n"
+		<< "  --osmesa           Use OSMesa instead of EGL for the headless context\n"
+		<< "  --frames N         Stop after N frames (headless default: 1)\n"
+		<< "  --size WxH         Offscreen framebuffer size (default: 750x750)\n"
+		<< "  --output DIR       Write headless frames to DIR as PPM images\n"
+		<< "  --capture-raw F    Capture every frame to F as raw RGB24 (asynchronous readback)\n"
+		<< "  --capture-y4m F    Capture every frame to F as a Y4M video (4:2:0)\n"
+		<< "  --capture-pipe CMD Capture every frame as raw RGB24 into the stdin of shell command CMD\n"
+		<< "  --capture-ring N   Pixel pack buffers in the readback ring, 2 to 8 (default: 3)\n"
+		<< "  --capture-fps N    Frame rate written into the Y4M header (default: 60)\n"
+		<< "  --pacing MODE      driver (default: swap interval untouched), uncapped, vsync or limit\n"
+		<< "  --target-fps N     Frame rate --pacing limit holds by sleeping, then spinning (default: 60)\n"
+		<< "  --frames-in-flight N  Fence every frame and let at most N be queued on the GPU (default: no limit)\n"
+		<< "  --render-thread    Render on a dedicated thread; the main thread only handles window events\n"
+		<< "  --event-stall MS   Simulate a slow window event: every 100 ms one event pump takes MS longer\n"
+		<< "  --sim-thread       Step the animation (dynamic mesh, camera) on its own thread; frames interpolate\n"
+		<< "  --sim-rate HZ      Simulation steps per second for --sim-thread (default: 60)\n"
+		<< "  --benchmark N      Time N frames (CPU + GPU) and report statistics as JSON\n"
+		<< "  --warmup N         Frames run before benchmark timing starts (default: 10)\n"
+		<< "  --benchmark-out F  Write the benchmark JSON to F instead of stdout\n"
+		<< "  --shader-cache DIR Directory for cached program binaries (default: ./shader_cache)\n"
+		<< "  --no-shader-cache  Always compile shaders from source\n"
+		<< "  --shader-stress N  Build N extra shader variants at startup and report the build time\n"
+		<< "  --vertex-format F  packed (half positions, byte colors; default) or float\n"
+		<< "  --mesh NAME        triangle (default), grid or flower\n"
+		<< "  --grid-size N      Grid mesh resolution in quads per side (default: 64)\n"
+		<< "  --shuffle-triangles  Randomize triangle order before optimization\n"
+		<< "  --no-mesh-optimize Skip vertex cache and vertex fetch optimization\n"
+		<< "  --mesh-stats       Print ACMR/ATVR before and after optimization\n"
+		<< "  --instances N      Draw N copies of the mesh with a single instanced draw call\n"
+		<< "  --instance-sweep M Benchmark 1, 10, 100, ... M instances and report triangles/sec\n"
+		<< "  --dynamic          Animate the mesh on the CPU and stream its vertices every frame\n"
+		<< "  --stream-policy P  When a stream segment is still in use: wait (default) or orphan\n"
+		<< "  --no-state-cache   Issue every GL bind/state call, even when nothing changes\n"
+		<< "  --objects N        Draw N separate objects (mixed meshes/programs) through the render queue\n"
+		<< "  --object-programs N  Shader variants used by the objects (default: 8)\n"
+		<< "  --no-sort          Draw queued objects in submission order instead of sorting by key\n"
+		<< "  --record N         Record queued draws into N command buffers on worker threads, then replay\n"
+		<< "  --camera-zoom Z    Zoom the object scene by Z and pan across it (default: 1)\n"
+		<< "  --cull             Frustum cull objects (SIMD sphere tests under a BVH) before drawing\n"
+		<< "  --cull-simd S      scalar, sse or avx2 (default: widest supported)\n"
+		<< "  --cull-bench N     Benchmark culling N synthetic objects on the CPU only, then exit\n"
+		<< "  --object-layers N  Stack N objects behind each other in every grid cell (default: 1)\n"
+		<< "  --occlusion        Skip hidden objects using occlusion queries and conditional rendering\n"
+		<< "  --lod              Draw objects from a chain of simplified meshes picked by screen-space error\n"
+		<< "  --lod-error PX     Largest projected error a simplified level may show (default: 1 pixel)\n"
+		<< "  --mesh-file F      Draw the mesh stored in binary mesh file F (see --convert-mesh)\n"
+		<< "  --convert-mesh I O Convert OBJ/PLY file I to binary mesh file O in the --vertex-format, then exit\n"
+		<< "  --import F         Stream an ascii OBJ/PLY file into GPU buffers on all cores and draw it\n"
+		<< "  --import-window MB File bytes parsed per streaming step (default: 64)\n"
+		<< "  --no-weld          Keep duplicate vertices when importing\n"
+		<< "  --import-bench MB  Import synthetic OBJ files of 10, 100, ... MB up to MB and report MB/s, then exit\n"
+		<< "  --async-upload     Upload the mesh a budgeted slice per frame through mapped staging buffers\n"
+		<< "  --upload-budget KB Bytes the upload queue may move per frame (default: 1024)\n"
+		<< "  --textures N       Generate N mipmapped textures on the pool and stream them in through the upload queue\n"
+		<< "  --texture F        Load binary PPM image F as the first texture\n"
+		<< "  --texture-size N   Size of the generated textures (default: 1024)\n"
+		<< "  --no-texture-compression  Store textures as RGBA8 even when BC1 (S3TC) is supported\n"
+		<< "  --software         Rasterize the mesh on the CPU (tiled, multi-threaded, SIMD) without a GPU\n"
+		<< "  --raster-simd S    scalar, sse or avx2 for the software rasterizer (default: widest supported)\n"
+		<< "  --raster-bench     Compare software and GL rasterization throughput (Mtri/s, Mpix/s), then exit\n"
+		<< "  --golden DIR       Render the golden scenes offscreen and compare them with the images in DIR\n"
+		<< "  --golden-update    Write the golden scenes to DIR as the new references instead\n"
+		<< "  --golden-scene N   Only run golden scene N\n"
+		<< "  --golden-tolerance N  Largest channel difference a pixel may show and still match (default: 2)\n"
+		<< "  --golden-max-pixels N Pixels allowed past the tolerance before a scene fails (default: 0)\n";
+}
 
-	std::ifstream myFile(filename.c_str());
+static bool ParseOptions(int argc, char** argv, RenderOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
 
-	if (myFile.is_open()) {
-		while (std::getline(myFile, line)) {      // Storing each line of a file until EOF
-			shaderStr += line + '\n';             // Append each line of program (fix: use +=)
+		if (arg == "--headless") {
+			options.headless = true;
+		}
+		else if (arg == "--osmesa") {
+			options.headless = true;
+			options.osmesa = true;
+		}
+		else if (arg == "--frames" && hasValue) {
+			options.frameCount = std::atoi(argv[++i]);
+		}
+		else if (arg == "--size" && hasValue) {
+			if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+				std::cout << "Invalid --size, expected WxH\n";
+				return false;
+			}
+		}
+		else if (arg == "--output" && hasValue) {
+			options.outputDir = argv[++i];
+		}
+		else if ((arg == "--capture-raw" || arg == "--capture-y4m" || arg == "--capture-pipe") && hasValue) {
+			options.captureFormat = arg == "--capture-raw" ? CaptureFormat::Raw
+				: arg == "--capture-y4m" ? CaptureFormat::Y4M : CaptureFormat::Pipe;
+			options.captureTarget = argv[++i];
+		}
+		else if (arg == "--capture-ring" && hasValue) {
+			options.captureRing = std::min(std::max(2, std::atoi(argv[++i])), 8);
+		}
+		else if (arg == "--capture-fps" && hasValue) {
+			options.captureFps = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--pacing" && hasValue) {
+			const std::string mode = argv[++i];
+			if (mode == "driver")
+				options.pacing = PacingMode::Driver;
+			else if (mode == "uncapped")
+				options.pacing = PacingMode::Uncapped;
+			else if (mode == "vsync")
+				options.pacing = PacingMode::Vsync;
+			else if (mode == "limit")
+				options.pacing = PacingMode::Limit;
+			else {
+				std::cout << "Invalid --pacing, expected driver, uncapped, vsync or limit\n";
+				return false;
+			}
+		}
+		else if (arg == "--target-fps" && hasValue) {
+			options.targetFps = std::max(1.0, std::atof(argv[++i]));
+		}
+		else if (arg == "--frames-in-flight" && hasValue) {
+			options.framesInFlight = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--render-thread") {
+			options.renderThread = true;
+		}
+		else if (arg == "--event-stall" && hasValue) {
+			options.eventStallMs = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--sim-thread") {
+			options.simThread = true;
+		}
+		else if (arg == "--sim-rate" && hasValue) {
+			options.simRate = std::max(1.0, std::atof(argv[++i]));
+		}
+		else if (arg == "--benchmark" && hasValue) {
+			options.benchmarkFrames = std::atoi(argv[++i]);
+		}
+		else if (arg == "--warmup" && hasValue) {
+			options.warmupFrames = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--benchmark-out" && hasValue) {
+			options.benchmarkOut = argv[++i];
+		}
+		else if (arg == "--shader-cache" && hasValue) {
+			options.shaderCacheDir = argv[++i];
+		}
+		else if (arg == "--no-shader-cache") {
+			options.shaderCacheDir.clear();
+		}
+		else if (arg == "--shader-stress" && hasValue) {
+			options.stressPrograms = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--vertex-format" && hasValue) {
+			const std::string format = argv[++i];
+			if (format != "packed" && format != "float") {
+				std::cout << "Invalid --vertex-format, expected packed or float\n";
+				return false;
+			}
+			options.packedVertices = format == "packed";
+		}
+		else if (arg == "--mesh" && hasValue) {
+			options.meshName = argv[++i];
+			if (options.meshName != "triangle" && options.meshName != "grid" && options.meshName != "flower") {
+				std::cout << "Invalid --mesh, expected triangle, grid or flower\n";
+				return false;
+			}
+		}
+		else if (arg == "--grid-size" && hasValue) {
+			options.gridSize = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--shuffle-triangles") {
+			options.shuffleTriangles = true;
+		}
+		else if (arg == "--no-mesh-optimize") {
+			options.optimizeMesh = false;
+		}
+		else if (arg == "--mesh-stats") {
+			options.meshStats = true;
+		}
+		else if (arg == "--instances" && hasValue) {
+			options.instanceCount = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--instance-sweep" && hasValue) {
+			options.instanceSweepMax = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--dynamic") {
+			options.dynamic = true;
+		}
+		else if (arg == "--stream-policy" && hasValue) {
+			const std::string policy = argv[++i];
+			if (policy != "wait" && policy != "orphan") {
+				std::cout << "Invalid --stream-policy, expected wait or orphan\n";
+				return false;
+			}
+			options.streamPolicy = policy == "orphan" ? StreamPolicy::Orphan : StreamPolicy::Wait;
+		}
+		else if (arg == "--no-state-cache") {
+			options.stateCache = false;
+		}
+		else if (arg == "--objects" && hasValue) {
+			options.objectCount = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--object-programs" && hasValue) {
+			options.objectPrograms = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--no-sort") {
+			options.sortQueue = false;
+		}
+		else if (arg == "--record" && hasValue) {
+			options.recordBuffers = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--camera-zoom" && hasValue) {
+			options.cameraZoom = std::max(0.01f, static_cast<float>(std::atof(argv[++i])));
+		}
+		else if (arg == "--cull") {
+			options.cull = true;
+		}
+		else if (arg == "--cull-simd" && hasValue) {
+			const std::string simd = argv[++i];
+			if (simd != "scalar" && simd != "sse" && simd != "avx2") {
+				std::cout << "Invalid --cull-simd, expected scalar, sse or avx2\n";
+				return false;
+			}
+			options.cullSimd = simd == "avx2" ? CullSimd::AVX2 : simd == "sse" ? CullSimd::SSE : CullSimd::Scalar;
+		}
+		else if (arg == "--cull-bench" && hasValue) {
+			options.cullBenchObjects = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--object-layers" && hasValue) {
+			options.objectLayers = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--occlusion") {
+			options.occlusion = true;
+		}
+		else if (arg == "--lod") {
+			options.lod = true;
+		}
+		else if (arg == "--lod-error" && hasValue) {
+			options.lodPixelError = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+		}
+		else if (arg == "--mesh-file" && hasValue) {
+			options.meshFile = argv[++i];
 		}
-		myFile.close();
+		else if (arg == "--import" && hasValue) {
+			options.importFile = argv[++i];
+		}
+		else if (arg == "--import-window" && hasValue) {
+			options.importWindowMB = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--no-weld") {
+			options.weld = false;
+		}
+		else if (arg == "--import-bench" && hasValue) {
+			options.importBenchMaxMB = std::max(10, std::atoi(argv[++i]));
+		}
+		else if (arg == "--async-upload") {
+			options.asyncUpload = true;
+		}
+		else if (arg == "--upload-budget" && hasValue) {
+			options.uploadBudgetKB = std::max(4, std::atoi(argv[++i]));
+		}
+		else if (arg == "--textures" && hasValue) {
+			options.textureCount = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--texture" && hasValue) {
+			options.textureFile = argv[++i];
+		}
+		else if (arg == "--texture-size" && hasValue) {
+			options.textureSize = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--no-texture-compression") {
+			options.compressTextures = false;
+		}
+		else if (arg == "--software") {
+			options.headless = true;
+			options.software = true;
+		}
+		else if (arg == "--raster-simd" && hasValue) {
+			const std::string simd = argv[++i];
+			if (simd != "scalar" && simd != "sse" && simd != "avx2") {
+				std::cout << "Invalid --raster-simd, expected scalar, sse or avx2\n";
+				return false;
+			}
+			options.rasterSimd = simd == "avx2" ? CullSimd::AVX2 : simd == "sse" ? CullSimd::SSE : CullSimd::Scalar;
+		}
+		else if (arg == "--raster-bench") {
+			options.headless = true;
+			options.rasterBench = true;
+		}
+		else if (arg == "--golden" && hasValue) {
+			options.goldenDir = argv[++i];
+		}
+		else if (arg == "--golden-update") {
+			options.goldenUpdate = true;
+		}
+		else if (arg == "--golden-scene" && hasValue) {
+			options.goldenScene = argv[++i];
+		}
+		else if (arg == "--golden-tolerance" && hasValue) {
+			options.goldenTolerance = std::min(std::max(0, std::atoi(argv[++i])), 255);
+		}
+		else if (arg == "--golden-max-pixels" && hasValue) {
+			options.goldenMaxPixels = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--convert-mesh" && i + 2 < argc) {
+			options.convertSource = argv[++i];
+			options.convertTarget = argv[++i];
+		}
+		else {
+			printUsage();
+			return false;
+		}
+	}
+
+	// Mesh files and imports go straight to the GPU; animating a mesh needs its float vertices
+	if ((!options.meshFile.empty() || !options.importFile.empty()) && options.dynamic) {
+		std::cout << "--mesh-file and --import cannot be combined with --dynamic\n";
+		return false;
+	}
+
+	// Only the plain mesh path knows to wait for the upload before drawing
+	if (options.asyncUpload && (options.objectCount > 0 || options.dynamic || options.instanceSweepMax > 0
+		|| !options.meshFile.empty() || !options.importFile.empty())) {
+		std::cout << "--async-upload only applies to the generated mesh, without --objects, --dynamic, --instance-sweep, --mesh-file or --import\n";
+		return false;
 	}
-	return shaderStr;
+
+	// The software rasterizer draws the generated mesh, instanced or not, and nothing else
+	if (options.software && (options.objectCount > 0 || options.dynamic || options.instanceSweepMax > 0
+		|| !options.meshFile.empty() || !options.importFile.empty() || options.asyncUpload
+		|| options.textureCount > 0 || !options.textureFile.empty() || !options.captureTarget.empty()
+		|| options.pacing != PacingMode::Driver || options.framesInFlight > 0 || options.renderThread || options.eventStallMs > 0 || options.simThread)) {
+		std::cout << "--software only draws the generated mesh, without --objects, --dynamic, --instance-sweep, --mesh-file, --import, --async-upload, textures, --capture-*, --pacing, --frames-in-flight, --render-thread, --event-stall or --sim-thread\n";
+		return false;
+	}
+
+	// Only the dynamic mesh and the object scene's camera move
+	if (options.simThread && !options.dynamic && options.objectCount == 0) {
+		std::cout << "--sim-thread needs --dynamic or --objects, nothing else is animated\n";
+		return false;
+	}
+
+	// Vsync is the swap waiting for the display; headless frames are never swapped
+	if (options.pacing == PacingMode::Vsync && options.headless) {
+		std::cout << "--pacing vsync needs a window; use --pacing limit to hold a frame rate headless\n";
+		return false;
+	}
+
+	// Both go through the same readback ring
+	if (!options.captureTarget.empty() && !options.outputDir.empty()) {
+		std::cout << "--output and --capture-raw/-y4m/-pipe cannot be combined\n";
+		return false;
+	}
+
+	if (options.goldenUpdate && options.goldenDir.empty()) {
+		std::cout << "--golden-update needs --golden DIR\n";
+		return false;
+	}
+
+	// A benchmark runs its warmup plus the timed frames, then stops
+	if (options.benchmarkFrames > 0)
+		options.frameCount = options.warmupFrames + options.benchmarkFrames;
+
+	// A headless run has no window to close, so it needs a frame budget
+	if (options.headless && options.frameCount == 0)
+		options.frameCount = 1;
+
+	return true;
 }
 
 static void processInput(GLFWwindow* window)
@@ -35,6 +507,7 @@ static void processInput(GLFWwindow* window)
 
 static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+	(void)window;
 	// make sure the viewport matches the new window dimensions; note that width and 
 	// height will be significantly larger than specified on retina displays.
 	glViewport(0, 0, width, height);
@@ -42,27 +515,53 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 // ===| OpenGL Version Info |==================================================================
 
-static void getOpenGLVerInfo() {
-	std::cout << "Vendor: " << glGetString(GL_VENDOR) << "\n";
-	std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
-	std::cout << "Version: " << glGetString(GL_VERSION) << "\n";
-	std::cout << "Shading language: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << "\n";
+static std::string jsonString(const GLubyte* value) {
+	std::string str = "\"";
+	for (const char* c = reinterpret_cast<const char*>(value); c && *c; ++c) {
+		if (*c == '"' || *c == '\\')
+			str += '\\';
+		str += *c;
+	}
+	return str + "\"";
+}
+
+static std::string getOpenGLVerInfoJson() {
+	return "  \"vendor\": " + jsonString(glGetString(GL_VENDOR)) + ",\n"
+		+ "  \"renderer\": " + jsonString(glGetString(GL_RENDERER)) + ",\n"
+		+ "  \"version\": " + jsonString(glGetString(GL_VERSION));
 }
 
 // ===| Init GLFW, GLAD and Create new window |=================================================
 
-static GLFWwindow* Initialize() {
+static GLFWwindow* Initialize(const RenderOptions& options) {
+	// Headless: GLFW's null platform needs no display server; the context comes from
+	// EGL (surfaceless, e.g. Mesa llvmpipe) or OSMesa and renders into an FBO instead
+	if (options.headless) {
+#ifdef GLFW_PLATFORM_NULL
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+	}
+
 	//Initialize glfw
-	glfwInit();
+	if (!glfwInit()) {
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return NULL;
+	}
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+	if (options.headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.osmesa ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API);
+	}
+
 	GLFWwindow* window = glfwCreateWindow(650, 650, "OpenGL Triangle Renderer", NULL, NULL);
 	if (window == NULL) {
-		std::cout << "Failed to create new window";
+		std::cout << "Failed to create new window" << std::endl;
 		glfwTerminate();
+		return NULL;
 	}
 
 	glfwMakeContextCurrent(window);
@@ -72,168 +571,1658 @@ static GLFWwindow* Initialize() {
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
 		std::cout << "Failed to initialize GLAD" << std::endl;
+		glfwTerminate();
+		return NULL;
 	}
+	LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+	glState.Invalidate();
+	glState.SetBypass(!options.stateCache);
 
 	return window;
 }
 
 // ===| Creating and linking Linker, Fragment Shaders to a Shader program |======================
 
-static unsigned int CreateLinkShader() {
-	std::string vertexShaderSourceStr = LoadShaderProgram("./shaders/vertexShader.glsl");
-	std::string fragmentShaderSourceStr = LoadShaderProgram("./shaders/fragmentShader.glsl");
+static unsigned int CreateLinkShader(ShaderManager& shaders, int stressPrograms, int objectPrograms) {
+	size_t mainProgram = shaders.Add("default", "./shaders/vertexShader.glsl", "./shaders/fragmentShader.glsl");
 
-	const char* vertexShaderSource = vertexShaderSourceStr.c_str();
-	const char* fragmentShaderSource = fragmentShaderSourceStr.c_str();
+	// Same shader, separate programs: switching between them costs what a real material switch does
+	for (int i = 0; i < objectPrograms; ++i) {
+		shaders.Add("object" + std::to_string(i), "./shaders/vertexShader.glsl", "./shaders/fragmentShader.glsl",
+			"#define OBJECT_VARIANT " + std::to_string(i) + "\n");
+	}
 
-	// Vertex shader 
-	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	// Startup stress test: distinct variants so neither our cache nor the driver's dedupes them
+	for (int i = 0; i < stressPrograms; ++i) {
+		shaders.Add("stress" + std::to_string(i), "./shaders/vertexShader.glsl", "./shaders/fragmentShader.glsl",
+			"#define STRESS_VARIANT " + std::to_string(i) + "\n");
+	}
 
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
+	const bool built = shaders.BuildAll();
 
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << "\n";
+	if (stressPrograms > 0) {
+		std::cout << "Built " << shaders.ProgramCount() << " programs in " << shaders.LastBuildMilliseconds()
+			<< " ms (" << shaders.LastBuildCacheHits() << " from cache, parallel compile "
+			<< (glExt.parallelShaderCompile ? "on" : "off") << ")\n";
 	}
 
-	// Fragment shader
-	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragmentShader);
+	// A program that failed to build draws nothing, which a run must not pass off as its output
+	return built ? shaders.Program(mainProgram) : 0;
+}
+
+// ===| Build Mesh |=============================================================================
+
+static Mesh BuildMesh(const RenderOptions& options) {
+	Mesh mesh = options.meshName == "grid" ? MakeGridMesh(options.gridSize)
+		: options.meshName == "flower" ? MakeFlowerMesh(options.gridSize / 2, options.gridSize * 2)
+		: MakeTriangleMesh();
 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::SHADER::COMPILATION_FAILED\n" << infoLog << "\n";
+	if (options.shuffleTriangles) {
+		// Simulates authored/exported meshes whose triangle order ignores the vertex cache
+		const size_t triangleCount = mesh.TriangleCount();
+		std::mt19937 rng(1234);
+		for (size_t t = triangleCount; t > 1; --t) {
+			const size_t other = rng() % t;
+			for (int k = 0; k < 3; ++k)
+				std::swap(mesh.indices[(t - 1) * 3 + k], mesh.indices[other * 3 + k]);
+		}
 	}
 
-	// Linking the shaders
-	unsigned int shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);     // Attaching vertex shader with shader program
-	glAttachShader(shaderProgram, fragmentShader);   // Attaching fragment shader with shader program
-	glLinkProgram(shaderProgram);                    // Linking the above attached shaders with the program
+	const VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.VertexCount());
+	if (options.optimizeMesh) {
+		OptimizeVertexCache(mesh.indices, mesh.VertexCount());
+		OptimizeVertexFetch(mesh);
+	}
 
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::SHADER::LINKING_FAILED\n" << infoLog << "\n";
+	if (options.meshStats) {
+		const VertexCacheStats after = AnalyzeVertexCache(mesh.indices, mesh.VertexCount());
+		std::cout << "Mesh '" << options.meshName << "': " << mesh.VertexCount() << " vertices, "
+			<< mesh.TriangleCount() << " triangles, "
+			<< (ChooseIndexType(mesh.VertexCount()) == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices\n"
+			<< "  ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr << " (FIFO 16)\n";
 	}
+	return mesh;
+}
+
+// ===| Generate and Bind VAO, VBO, EBO |========================================================
 
-	// Deleting individual shaders after linking
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+static GpuMesh GenerateBindArrayBuffer(const Mesh& mesh, const VertexLayout& layout, const LodChain* lods = NULL) {
+	// Interleaved vertices in the layout's packed format plus a 16/32-bit element buffer,
+	// all recorded in the mesh's VAO
+	if (!lods)
+		return UploadMesh(mesh, layout);
 
-	return shaderProgram;
+	// The simplified levels follow the authored indices in the same element buffer; plain
+	// draws of the mesh still see only level 0
+	GpuMesh gpuMesh = UploadMesh(mesh, lods->indices, layout);
+	gpuMesh.indexCount = static_cast<GLsizei>(lods->levels[0].indexCount);
+	return gpuMesh;
 }
 
-// ===| Generate and Bind VAO, VBO |=============================================================
+// Maps a binary mesh file and uploads it as is, reporting how close the load came to disk speed
+static bool LoadMeshFile(const std::string& path, GpuMesh& gpuMesh) {
+	const auto start = std::chrono::steady_clock::now();
+	MeshFile file;
+	if (!file.Open(path))
+		return false;
+	gpuMesh = UploadMeshFile(file);
+	glFinish();
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-static unsigned int GenerateBindArrayBuffer(unsigned int* VBO1, unsigned int* VBO2) {
-	//Stores in CPU
-	const std::vector<float> vertexCoords = {
-		// x     y     z  
-		-0.5f, -0.2f, 0.0f,
-		0.5f, -0.2f, 0.0f,
-		0.0f, 0.5f, 0.0f
-	};
+	const double megabytes = file.FileBytes() / (1024.0 * 1024.0);
+	std::cout << "Mesh file " << path << ": " << file.Header().vertexCount << " vertices, "
+		<< file.Header().indexCount / 3 << " triangles, " << megabytes << " MB loaded in " << ms << " ms ("
+		<< (ms > 0.0 ? megabytes * 1000.0 / ms : 0.0) << " MB/s)\n";
+	return true;
+}
 
-	const std::vector<float> vertexColors = {
-		// r    g    b
-		1.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 1.0f
-	};
+static void printTextureStats(const TextureManager& textures) {
+	const TextureStats& stats = textures.Stats();
+	std::cout << "Textures: " << stats.resident << " of " << stats.textures << " resident as "
+		<< (textures.Format() == TextureFormat::BC1 ? "BC1" : "RGBA8") << ", " << stats.vramBytes / (1024.0 * 1024.0)
+		<< " MB of video memory (" << stats.uncompressedBytes / (1024.0 * 1024.0) << " MB as RGBA8), "
+		<< stats.stagedBytes / (1024.0 * 1024.0) << " MB staged, prepared in " << stats.prepareMilliseconds
+		<< " ms of pool time, all resident at frame " << stats.readyFrame << "\n";
+}
+
+static void printCaptureStats(const FrameCapture& capture) {
+	const CaptureStats stats = capture.Stats();
+	unsigned int maxLatency = 0;
+	for (const CaptureFrameStats& frame : capture.History())
+		maxLatency = std::max(maxLatency, frame.latencyFrames);
+	std::cout << "Captured " << stats.framesWritten << " frames as " << CaptureFormatName(capture.Format()) << ", "
+		<< stats.bytesWritten / (1024.0 * 1024.0) << " MB in " << stats.writeMilliseconds << " ms of writer time; "
+		<< capture.RingSize() << " buffer ring, at most " << maxLatency << " frames of latency, "
+		<< stats.stalls << " stalled frames" << (stats.failed ? ", FAILED" : "") << "\n";
+}
+
+static void printPacingStats(const FramePacer& pacer, size_t skipFrames) {
+	const PacingJitter jitter = pacer.Jitter(skipFrames);
+	std::cout << "Pacing " << PacingModeName(pacer.Mode());
+	if (jitter.targetMilliseconds > 0.0)
+		std::cout << " (target " << jitter.targetMilliseconds << " ms)";
+	if (pacer.BoundsFramesInFlight())
+		std::cout << ", " << pacer.MaxFramesInFlight() << " frames in flight";
+	std::cout << ": " << jitter.frames << " frames, mean interval " << jitter.meanInterval << " ms, jitter "
+		<< jitter.stdDev << " ms std dev, mean error " << jitter.meanError << " ms, " << jitter.missed << " missed\n";
+}
+
+// Render frames longer than twice the median: what a stall on the event side shows up as
+struct EventHitches {
+	std::vector<double> intervals;
+	std::vector<double> latencies;
+	double medianInterval = 0.0;
+	size_t hitches = 0;
+};
 
-	//Transfer memory to GPU
-
-	// Generate and bind VAO
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-
-	// Generate, bind, enable vertex atrribute and sending data for VBOs
-	// For VBO1 : Coordinates
-	glGenBuffers(1, VBO1);
-	glBindBuffer(GL_ARRAY_BUFFER, *VBO1);
-	glBufferData(
-		GL_ARRAY_BUFFER,
-		vertexCoords.size() * sizeof(float),
-		vertexCoords.data(),
-		GL_STATIC_DRAW
-	);
-
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-	// For VBO2 : Colors
-	glGenBuffers(1, VBO2);
-	glBindBuffer(GL_ARRAY_BUFFER, *VBO2);
-	glBufferData(
-		GL_ARRAY_BUFFER,
-		vertexColors.size() * sizeof(float),
-		vertexColors.data(),
-		GL_STATIC_DRAW
-	);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	
-
-	//Unbind and disable after completion
-	glBindVertexArray(0);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-
-	return VAO;
+static EventHitches findEventHitches(const WindowEvents& events, size_t skipFrames) {
+	EventHitches result;
+	const std::vector<EventFrameStats>& history = events.History();
+	for (size_t i = std::min(skipFrames, history.size()); i < history.size(); ++i) {
+		result.intervals.push_back(history[i].intervalMilliseconds);
+		if (history[i].events > 0)
+			result.latencies.push_back(history[i].maxLatencyMilliseconds);
+	}
+	result.medianInterval = SummarizeSamples(result.intervals).median;
+	for (double interval : result.intervals) {
+		if (interval > 2.0 * result.medianInterval)
+			++result.hitches;
+	}
+	return result;
+}
+
+static void printEventStats(const WindowEvents& events, const RenderOptions& options) {
+	const EventHitches hitches = findEventHitches(events, options.benchmarkFrames > 0 ? options.warmupFrames : 0);
+	const SampleStats intervals = SummarizeSamples(hitches.intervals);
+	const EventPumpStats& pump = events.PumpStats();
+	std::cout << "Events on the " << (options.renderThread ? "main thread, rendering on its own" : "render thread")
+		<< ": " << pump.events << " events (" << pump.dropped << " dropped), " << pump.stalls << " slow pumps; "
+		<< intervals.count << " frames, interval median " << intervals.median << " ms, max " << intervals.max
+		<< " ms, " << hitches.hitches << " hitches (over twice the median), event latency max "
+		<< SummarizeSamples(hitches.latencies).max << " ms\n";
+}
+
+static void printSimulationStats(const Simulation& simulation, size_t skipFrames) {
+	std::vector<double> stepMs;
+	for (const SimStepStats& step : simulation.StepHistory())
+		stepMs.push_back(step.stepMilliseconds);
+	size_t frames = 0, fresh = 0, stale = 0;
+	const std::vector<SimFrameStats>& history = simulation.History();
+	for (size_t i = std::min(skipFrames, history.size()); i < history.size(); ++i, ++frames) {
+		fresh += history[i].fresh ? 1 : 0;
+		stale += history[i].stale ? 1 : 0;
+	}
+	std::cout << "Simulation at " << simulation.Rate() << " Hz on its own thread: " << simulation.Stats().steps
+		<< " steps (" << simulation.Stats().skipped << " skipped), step median " << SummarizeSamples(stepMs).median
+		<< " ms; " << frames << " frames, " << fresh << " with a new step, " << stale << " stale\n";
+}
+
+static void printImportStats(const std::string& path, const ImportStats& stats) {
+	std::cout << "Imported " << path << ": " << stats.weldedVertices << " vertices (" << stats.sourceVertices
+		<< " before welding), " << stats.triangles << " triangles, " << stats.fileBytes / (1024.0 * 1024.0) << " MB in "
+		<< stats.totalMilliseconds << " ms (" << stats.MegabytesPerSecond() << " MB/s; parse " << stats.parseMilliseconds
+		<< " ms, weld " << stats.mergeMilliseconds << " ms, upload " << stats.uploadMilliseconds << " ms, "
+		<< stats.windows << " windows, peak window memory " << stats.peakWindowBytes / (1024.0 * 1024.0) << " MB)\n";
 }
 
 // ===| Main Loop |===========================================================================
 
-static void RenderLoop(GLFWwindow* window, unsigned int shaderProgram, unsigned int VAO) {
+// Everything RenderLoop() draws
+struct RenderScene {
+	unsigned int shaderProgram = 0;
+	const GpuMesh* mesh = NULL;
+	GLsizei instanceCount = 0;        // 0 = plain draw, otherwise one instanced draw
+	DynamicMesh* dynamicMesh = NULL;  // when set, drawn instead of mesh with per-frame vertices
+	const std::vector<SceneObject>* objects = NULL;  // when set, drawn through queue instead
+	RenderQueue* queue = NULL;
+	ThreadPool* recordPool = NULL;    // when set, the queue is recorded on it into commandBuffers
+	std::vector<CommandBuffer>* commandBuffers = NULL;
+	float cameraZoom = 1.0f;
+	BoundingVolumeHierarchy* bvh = NULL;   // when set, objects outside the camera are not queued
+	std::vector<uint32_t>* visible = NULL;
+	OcclusionCuller* occlusion = NULL;     // when set, objects found hidden last time are not drawn
+	LodSelector* lod = NULL;               // when set, objects draw the LOD level their size calls for
+	UploadQueue* uploads = NULL;           // when set, updated every frame
+	UploadId meshUploads[2] = {};          // when set, mesh is drawn once both uploads are ready
+	TextureManager* textures = NULL;       // when set, updated every frame ahead of uploads
+	FrameCapture* capture = NULL;          // when set, every frame is read back through it
+	FramePacer* pacer = NULL;              // when set, decides when frames start and end
+	WindowEvents* events = NULL;           // when set, window events arrive through it
+	Simulation* simulation = NULL;         // when set, the dynamic mesh and camera come from it
+	unsigned int texture = 0;              // bound on unit 0 for mesh draws
+};
+
+// Zoomed in, the camera circles so different objects come into view every frame
+static Mat4 SceneCamera(const RenderScene& scene, double time) {
+	const float range = 1.0f - 1.0f / scene.cameraZoom;
+	float panX = 0.0f, panY = 0.0f;
+	if (scene.simulation) {
+		panX = scene.simulation->PanX();
+		panY = scene.simulation->PanY();
+	}
+	else {
+		CameraPan(time, panX, panY);
+	}
+	return Mat4::Camera2D(range * panX, range * panY, scene.cameraZoom);
+}
+
+// Drains the events that arrived since the last frame; true once the window should close
+static bool handleWindowEvents(WindowEvents& events) {
+	bool close = false;
+	WindowEvent event;
+	while (events.Pop(event)) {
+		if (event.type == WindowEventType::Resize)
+			glViewport(0, 0, event.a, event.b);
+		else if (event.type == WindowEventType::Close || (event.a == GLFW_KEY_ESCAPE && event.b == GLFW_PRESS))
+			close = true;
+	}
+	return close;
+}
+
+static void RenderLoop(GLFWwindow* window, const RenderScene& scene,
+	const RenderOptions& options, const OffscreenTarget* offscreen, FrameTimer* timer) {
+
+	glState.ClearHistory();
+	if (scene.queue)
+		scene.queue->ClearHistory();
+	if (scene.bvh)
+		scene.bvh->ClearHistory();
+	if (scene.occlusion)
+		scene.occlusion->ClearHistory();
+	if (scene.lod)
+		scene.lod->ClearHistory();
+	if (scene.uploads)
+		scene.uploads->ClearHistory();
+	if (scene.pacer)
+		scene.pacer->ClearHistory();
+	if (scene.events)
+		scene.events->ClearHistory();
+	if (scene.simulation)
+		scene.simulation->ClearHistory();
 
-	while (!glfwWindowShouldClose(window)) {
+	int frame = 0;
+	bool closing = false;
+	while (!closing && (scene.events || !glfwWindowShouldClose(window)) && (options.frameCount == 0 || frame < options.frameCount)) {
 
-		processInput(window);
+		if (timer) timer->BeginFrame();
+		if (scene.pacer)
+			scene.pacer->BeginFrame();
+
+		if (scene.events)
+			closing = handleWindowEvents(*scene.events);
+		else
+			processInput(window);
+		// Never waits: the newest published step, interpolated to now
+		if (scene.simulation)
+			scene.simulation->Sample();
 
 		// render
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (scene.textures)
+			scene.textures->Update(*scene.uploads);
+		if (scene.uploads)
+			scene.uploads->Update();
+		if (timer) timer->Mark(FrameSection::Clear);
 
 		// draw our first triangle
-		glUseProgram(shaderProgram);
-		glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		if (scene.objects) {
+			const Mat4 camera = SceneCamera(scene, glfwGetTime());
+			if (scene.bvh) {
+				scene.bvh->Cull(Frustum::FromMatrix(camera), *scene.visible);
+			}
+			else if (scene.occlusion && scene.visible->size() != scene.objects->size()) {
+				scene.visible->resize(scene.objects->size());
+				std::iota(scene.visible->begin(), scene.visible->end(), 0u);
+			}
+
+			const std::vector<uint32_t>* drawList = scene.bvh || scene.occlusion ? scene.visible : NULL;
+			if (scene.occlusion) {
+				scene.occlusion->CollectResults();
+				drawList = &scene.occlusion->Filter(*scene.visible);
+			}
+
+			scene.queue->Begin();
+			SubmitObjects(*scene.queue, *scene.objects, camera, drawList, scene.occlusion, scene.lod);
+			if (scene.lod)
+				scene.lod->EndFrame();
+			if (scene.recordPool)
+				scene.queue->Execute(*scene.recordPool, *scene.commandBuffers);
+			else
+				scene.queue->Execute();
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+			if (scene.occlusion) {
+				scene.occlusion->IssueQueries(*scene.objects, *scene.visible, camera);
+				scene.occlusion->EndFrame();
+			}
+		}
+		else if (scene.dynamicMesh) {
+			glState.UseProgram(scene.shaderProgram);
+			glState.BindTexture(0, GL_TEXTURE_2D, scene.texture);
+			if (scene.simulation)
+				scene.dynamicMesh->Update(scene.simulation->Positions());
+			else
+				scene.dynamicMesh->Update(glfwGetTime());
+			glState.BindVertexArray(scene.dynamicMesh->VAO());
+			scene.dynamicMesh->Draw(scene.instanceCount);
+			scene.dynamicMesh->EndFrame();
+		}
+		else if (!scene.meshUploads[0] || (scene.uploads->Ready(scene.meshUploads[0]) && scene.uploads->Ready(scene.meshUploads[1]))) {
+			glState.UseProgram(scene.shaderProgram);
+			glState.BindTexture(0, GL_TEXTURE_2D, scene.texture);
+			glState.BindVertexArray(scene.mesh->VAO); // binding every frame keeps things organized; the state cache drops it when nothing changed
+			if (scene.instanceCount > 0)
+				DrawMeshInstanced(*scene.mesh, scene.instanceCount);
+			else
+				DrawMesh(*scene.mesh);
+		}
+		if (timer) timer->Mark(FrameSection::Draw);
+
+		if (timer) timer->EndGpuFrame();
+		if (scene.capture)
+			scene.capture->Capture(offscreen ? offscreen->FBO : 0);
+		if (offscreen) {
+			// No window to present to: the frame stays in the FBO, optionally captured. Benchmarks
+			// finish each frame instead, like a swap would throttle, so frames cannot queue up
+			// without bound and the CPU frame time covers the rendering. A capture or a limit on
+			// frames in flight already bounds them: both wait for a frame a few frames back.
+			if (timer && !scene.capture && !(scene.pacer && scene.pacer->BoundsFramesInFlight()))
+				glFinish();
+		}
+		else {
+			glfwSwapBuffers(window);
+		}
+		// Before polling, so the next frame starts with the freshest input
+		if (scene.pacer)
+			scene.pacer->EndFrame();
+		if (!scene.events)
+			glfwPollEvents();
+		else if (!options.renderThread)
+			scene.events->Pump(false);
+		if (timer) {
+			timer->Mark(FrameSection::Present);
+			timer->EndFrame();
+		}
+		if (scene.events)
+			scene.events->EndFrame();
+		glState.EndFrame();
+		++frame;
 	}
+
+	glFinish();
 }
 
-// =================================================================================================
+// Runs RenderLoop on a thread of its own, which takes the context along. This thread keeps the
+// window, as GLFW requires, and does nothing but pump its events into scene.events until the
+// loop is done; a slow event then holds up only this thread, not the frame being drawn.
+static void RunRenderLoop(GLFWwindow* window, const RenderScene& scene,
+	const RenderOptions& options, const OffscreenTarget* offscreen, FrameTimer* timer) {
+
+	if (!options.renderThread) {
+		RenderLoop(window, scene, options, offscreen, timer);
+		return;
+	}
+
+	std::atomic<bool> done(false);
+	glfwMakeContextCurrent(NULL);
+	std::thread renderThread([&]() {
+		glfwMakeContextCurrent(window);
+		RenderLoop(window, scene, options, offscreen, timer);
+		glfwMakeContextCurrent(NULL);
+		done.store(true, std::memory_order_release);
+		glfwPostEmptyEvent();
+	});
+	while (!done.load(std::memory_order_acquire))
+		scene.events->Pump(true);
+	renderThread.join();
+	glfwMakeContextCurrent(window);
+}
+
+// ===| Benchmark Reports |===================================================================
+
+static double trianglesPerFrame(const RenderScene& scene) {
+	if (scene.objects) {
+		// What the queue was actually given, after culling and LOD selection
+		const std::vector<RenderQueueStats>& history = scene.queue->History();
+		double triangles = 0.0;
+		for (const RenderQueueStats& stats : history)
+			triangles += static_cast<double>(stats.triangles);
+		return history.empty() ? 0.0 : triangles / history.size();
+	}
+	return static_cast<double>(scene.mesh->indexCount / 3) * std::max<GLsizei>(scene.instanceCount, 1);
+}
+
+static std::string throughputJson(const FrameTimer& timer, const RenderScene& scene) {
+	const GLsizei instanceCount = scene.objects ? static_cast<GLsizei>(scene.objects->size()) : scene.instanceCount;
+	const double triangles = trianglesPerFrame(scene) * timer.RecordedFrames();
+	const double gpuSeconds = timer.TotalGpuSeconds();
+	const double cpuSeconds = timer.TotalCpuSeconds();
+
+	std::ostringstream out;
+	out << "  \"instances\": " << std::max<GLsizei>(instanceCount, 1) << ",\n"
+		<< "  \"triangles_per_frame\": " << static_cast<uint64_t>(trianglesPerFrame(scene)) << ",\n"
+		<< "  \"gpu_triangles_per_second\": " << (gpuSeconds > 0.0 ? triangles / gpuSeconds : 0.0) << ",\n"
+		<< "  \"cpu_triangles_per_second\": " << (cpuSeconds > 0.0 ? triangles / cpuSeconds : 0.0);
+	return out.str();
+}
+
+static std::ostream* openBenchmarkOutput(const RenderOptions& options, std::ofstream& file) {
+	if (options.benchmarkOut.empty())
+		return &std::cout;
+
+	file.open(options.benchmarkOut);
+	if (!file.is_open()) {
+		std::cout << "ERROR::BENCHMARK::CANNOT_OPEN_FILE " << options.benchmarkOut << "\n";
+		return NULL;
+	}
+	return &file;
+}
+
+static std::string streamingJson(const StreamingBuffer& stream, size_t warmupFrames) {
+	std::vector<double> bytes, waits, orphans, waitMs;
+	const std::vector<StreamFrameStats>& history = stream.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		bytes.push_back(static_cast<double>(history[i].bytesStreamed));
+		waits.push_back(history[i].fenceWaits);
+		orphans.push_back(history[i].orphans);
+		waitMs.push_back(history[i].waitMilliseconds);
+	}
+
+	std::ostringstream out;
+	out << "  \"stream_bytes_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(bytes));
+	out << ",\n  \"stream_fence_waits_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(waits));
+	out << ",\n  \"stream_orphans_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(orphans));
+	out << ",\n  \"stream_fence_wait_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(waitMs));
+	return out.str();
+}
+
+static std::string stateCacheJson(size_t warmupFrames) {
+	std::vector<double> issued, elided;
+	const std::vector<StateCounters>& history = glState.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		issued.push_back(history[i].issued);
+		elided.push_back(history[i].elided);
+	}
+
+	std::ostringstream out;
+	out << "  \"state_cache\": " << (glState.Bypass() ? "false" : "true") << ",\n";
+	out << "  \"state_calls_issued_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(issued));
+	out << ",\n  \"state_calls_elided_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(elided));
+	return out.str();
+}
+
+static std::string queueJson(const RenderQueue& queue, size_t warmupFrames) {
+	std::vector<double> triangles, unsorted, sorted, sortMs;
+	const std::vector<RenderQueueStats>& history = queue.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		triangles.push_back(static_cast<double>(history[i].triangles));
+		unsorted.push_back(history[i].stateChangesUnsorted);
+		sorted.push_back(history[i].stateChangesSorted);
+		sortMs.push_back(history[i].sortMilliseconds);
+	}
+
+	std::ostringstream out;
+	out << "  \"queue_sorted\": " << (queue.Sorting() ? "true" : "false") << ",\n";
+	out << "  \"queue_items\": " << queue.LastFrameStats().items << ",\n";
+	out << "  \"queue_triangles_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(triangles));
+	out << ",\n";
+	out << "  \"queue_state_changes_unsorted_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(unsorted));
+	out << ",\n  \"queue_state_changes_sorted_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(sorted));
+	out << ",\n  \"queue_sort_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(sortMs));
+
+	if (queue.LastFrameStats().commandBuffers > 0) {
+		std::vector<double> recordMs, replayMs;
+		for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+			recordMs.push_back(history[i].recordMilliseconds);
+			replayMs.push_back(history[i].replayMilliseconds);
+		}
+		out << ",\n  \"command_buffers\": " << queue.LastFrameStats().commandBuffers;
+		out << ",\n  \"command_bytes_per_frame\": " << queue.LastFrameStats().commandBytes;
+		out << ",\n  \"queue_record_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(recordMs));
+		out << ",\n  \"queue_replay_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(replayMs));
+	}
+	return out.str();
+}
+
+static std::string cullJson(const BoundingVolumeHierarchy& bvh, size_t warmupFrames) {
+	std::vector<double> visible, culled, nodes, tested, ms;
+	const std::vector<CullFrameStats>& history = bvh.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		visible.push_back(static_cast<double>(history[i].visible));
+		culled.push_back(static_cast<double>(history[i].culled));
+		nodes.push_back(static_cast<double>(history[i].nodesVisited));
+		tested.push_back(static_cast<double>(history[i].objectsTested));
+		ms.push_back(history[i].milliseconds);
+	}
+
+	std::ostringstream out;
+	out << "  \"cull_simd\": \"" << CullSimdName(bvh.Simd()) << "\",\n";
+	out << "  \"bvh_nodes\": " << bvh.NodeCount() << ",\n";
+	out << "  \"cull_visible_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(visible));
+	out << ",\n  \"cull_culled_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(culled));
+	out << ",\n  \"cull_nodes_visited_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(nodes));
+	out << ",\n  \"cull_objects_tested_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(tested));
+	out << ",\n  \"cull_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(ms));
+	return out.str();
+}
+
+static std::string occlusionJson(const OcclusionCuller& occlusion, size_t warmupFrames) {
+	std::vector<double> candidates, skipped, conditional, issued;
+	const std::vector<OcclusionFrameStats>& history = occlusion.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		candidates.push_back(static_cast<double>(history[i].candidates));
+		skipped.push_back(static_cast<double>(history[i].skipped));
+		conditional.push_back(static_cast<double>(history[i].conditional));
+		issued.push_back(static_cast<double>(history[i].queriesIssued));
+	}
+
+	std::ostringstream out;
+	out << "  \"occlusion_candidates_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(candidates));
+	out << ",\n  \"occlusion_skipped_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(skipped));
+	out << ",\n  \"occlusion_conditional_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(conditional));
+	out << ",\n  \"occlusion_queries_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(issued));
+	return out.str();
+}
+
+static std::string uploadJson(const UploadQueue& uploads, size_t warmupFrames) {
+	// Frames from the start of the run until everything queued was on the GPU, warmup included
+	const std::vector<UploadFrameStats>& history = uploads.History();
+	size_t completed = 0;
+	long readyFrame = -1;
+	for (size_t i = 0; i < history.size() && readyFrame < 0; ++i) {
+		completed += history[i].completed;
+		if (completed == uploads.Submitted())
+			readyFrame = static_cast<long>(i);
+	}
+
+	std::vector<double> bytes, ms;
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		bytes.push_back(static_cast<double>(history[i].bytes));
+		ms.push_back(history[i].milliseconds);
+	}
+
+	std::ostringstream out;
+	out << "  \"upload_budget_bytes\": " << uploads.FrameBudget() << ",\n";
+	out << "  \"upload_ready_frame\": " << readyFrame << ",\n";
+	out << "  \"upload_bytes_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(bytes));
+	out << ",\n  \"upload_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(ms));
+	return out.str();
+}
 
-int main() {
+static std::string textureJson(const TextureManager& textures) {
+	const TextureStats& stats = textures.Stats();
+	std::ostringstream out;
+	out << "  \"texture_format\": \"" << (textures.Format() == TextureFormat::BC1 ? "bc1" : "rgba8") << "\",\n"
+		<< "  \"textures\": " << stats.textures << ",\n"
+		<< "  \"textures_resident\": " << stats.resident << ",\n"
+		<< "  \"texture_ready_frame\": " << stats.readyFrame << ",\n"
+		<< "  \"texture_vram_bytes\": " << stats.vramBytes << ",\n"
+		<< "  \"texture_rgba8_bytes\": " << stats.uncompressedBytes << ",\n"
+		<< "  \"texture_vram_saved_bytes\": " << stats.uncompressedBytes - stats.vramBytes << ",\n"
+		<< "  \"texture_staged_bytes\": " << stats.stagedBytes << ",\n"
+		<< "  \"texture_prepare_ms\": " << stats.prepareMilliseconds;
+	return out.str();
+}
+
+static std::string captureJson(const FrameCapture& capture, size_t warmupFrames) {
+	const CaptureStats stats = capture.Stats();
+	const std::vector<CaptureFrameStats>& history = capture.History();
+	std::vector<double> issueMs, stallMs;
+	unsigned int maxLatency = 0;
+	size_t maxBacklog = 0;
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		issueMs.push_back(history[i].issueMilliseconds);
+		stallMs.push_back(history[i].stallMilliseconds);
+		maxLatency = std::max(maxLatency, history[i].latencyFrames);
+		maxBacklog = std::max(maxBacklog, history[i].backlog);
+	}
+
+	std::ostringstream out;
+	out << "  \"capture_format\": \"" << CaptureFormatName(capture.Format()) << "\",\n";
+	out << "  \"capture_ring\": " << capture.RingSize() << ",\n";
+	out << "  \"capture_frames_written\": " << stats.framesWritten << ",\n";
+	out << "  \"capture_mb_written\": " << stats.bytesWritten / (1024.0 * 1024.0) << ",\n";
+	out << "  \"capture_write_ms_per_frame\": " << (stats.framesWritten > 0 ? stats.writeMilliseconds / stats.framesWritten : 0.0) << ",\n";
+	out << "  \"capture_stalls\": " << stats.stalls << ",\n";
+	out << "  \"capture_max_latency_frames\": " << maxLatency << ",\n";
+	out << "  \"capture_max_backlog\": " << maxBacklog << ",\n";
+	out << "  \"capture_issue_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(issueMs));
+	out << ",\n  \"capture_stall_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(stallMs));
+	return out.str();
+}
+
+static std::string pacingJson(const FramePacer& pacer, size_t warmupFrames) {
+	const PacingJitter jitter = pacer.Jitter(warmupFrames);
+	const std::vector<PacingFrameStats>& history = pacer.History();
+	std::vector<double> intervals, sleepMs, spinMs, lateMs, fenceWaitMs;
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		intervals.push_back(history[i].intervalMilliseconds);
+		sleepMs.push_back(history[i].sleepMilliseconds);
+		spinMs.push_back(history[i].spinMilliseconds);
+		lateMs.push_back(history[i].lateMilliseconds);
+		fenceWaitMs.push_back(history[i].fenceWaitMilliseconds);
+	}
+
+	std::ostringstream out;
+	out << "  \"pacing_mode\": \"" << PacingModeName(pacer.Mode()) << "\",\n";
+	out << "  \"pacing_frames_in_flight\": " << pacer.MaxFramesInFlight() << ",\n";
+	out << "  \"pacing_target_ms\": " << jitter.targetMilliseconds << ",\n";
+	out << "  \"pacing_jitter_ms\": " << jitter.stdDev << ",\n";
+	out << "  \"pacing_mean_error_ms\": " << jitter.meanError << ",\n";
+	out << "  \"pacing_missed_frames\": " << jitter.missed << ",\n";
+	out << "  \"pacing_interval_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(intervals));
+	if (pacer.Mode() == PacingMode::Limit) {
+		out << ",\n  \"pacing_sleep_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(sleepMs));
+		out << ",\n  \"pacing_spin_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(spinMs));
+		out << ",\n  \"pacing_late_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(lateMs));
+	}
+	if (pacer.BoundsFramesInFlight()) {
+		out << ",\n  \"pacing_fence_wait_ms\": ";
+		WriteStatsJson(out, SummarizeSamples(fenceWaitMs));
+	}
+	return out.str();
+}
+
+static std::string eventJson(const WindowEvents& events, const RenderOptions& options) {
+	const EventHitches hitches = findEventHitches(events, options.warmupFrames);
+	const EventPumpStats& pump = events.PumpStats();
+
+	std::ostringstream out;
+	out << "  \"event_render_thread\": " << (options.renderThread ? "true" : "false") << ",\n";
+	out << "  \"event_stall_ms\": " << options.eventStallMs << ",\n";
+	out << "  \"event_count\": " << pump.events << ",\n";
+	out << "  \"event_dropped\": " << pump.dropped << ",\n";
+	out << "  \"event_slow_pumps\": " << pump.stalls << ",\n";
+	out << "  \"event_hitches\": " << hitches.hitches << ",\n";
+	out << "  \"event_frame_interval_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(hitches.intervals));
+	out << ",\n  \"event_latency_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(hitches.latencies));
+	return out.str();
+}
+
+// Only after Simulation::Stop(): the step history belongs to the simulation thread until then
+static std::string simulationJson(const Simulation& simulation, size_t warmupFrames) {
+	std::vector<double> stepMs, lateMs, alpha, sampleMs;
+	for (const SimStepStats& step : simulation.StepHistory()) {
+		stepMs.push_back(step.stepMilliseconds);
+		lateMs.push_back(step.lateMilliseconds);
+	}
+	size_t fresh = 0, stale = 0;
+	const std::vector<SimFrameStats>& history = simulation.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		alpha.push_back(history[i].alpha);
+		sampleMs.push_back(history[i].sampleMilliseconds);
+		fresh += history[i].fresh ? 1 : 0;
+		stale += history[i].stale ? 1 : 0;
+	}
+
+	std::ostringstream out;
+	out << "  \"sim_rate_hz\": " << simulation.Rate() << ",\n";
+	out << "  \"sim_steps\": " << simulation.Stats().steps << ",\n";
+	out << "  \"sim_skipped_steps\": " << simulation.Stats().skipped << ",\n";
+	out << "  \"sim_fresh_frames\": " << fresh << ",\n";
+	out << "  \"sim_stale_frames\": " << stale << ",\n";
+	out << "  \"sim_step_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(stepMs));
+	out << ",\n  \"sim_step_late_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(lateMs));
+	out << ",\n  \"sim_sample_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(sampleMs));
+	out << ",\n  \"sim_alpha\": ";
+	WriteStatsJson(out, SummarizeSamples(alpha));
+	return out.str();
+}
+
+static std::string lodJson(const LodSelector& lod, size_t warmupFrames) {
+	std::vector<double> reduced, switches, full, selected;
+	const std::vector<LodFrameStats>& history = lod.History();
+	for (size_t i = std::min(warmupFrames, history.size()); i < history.size(); ++i) {
+		reduced.push_back(static_cast<double>(history[i].reduced));
+		switches.push_back(static_cast<double>(history[i].switches));
+		full.push_back(static_cast<double>(history[i].fullTriangles));
+		selected.push_back(static_cast<double>(history[i].selectedTriangles));
+	}
+
+	std::ostringstream out;
+	out << "  \"lod_reduced_objects_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(reduced));
+	out << ",\n  \"lod_switches_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(switches));
+	out << ",\n  \"lod_full_triangles_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(full));
+	out << ",\n  \"lod_selected_triangles_per_frame\": ";
+	WriteStatsJson(out, SummarizeSamples(selected));
+	return out.str();
+}
+
+static void WriteBenchmarkReport(FrameTimer& timer, const RenderOptions& options, const RenderScene& scene) {
+	timer.Finish();
+
+	std::string info = getOpenGLVerInfoJson() + ",\n  \"headless\": " + (options.headless ? "true" : "false")
+		+ ",\n" + throughputJson(timer, scene)
+		+ ",\n" + stateCacheJson(options.warmupFrames);
+	if (scene.queue)
+		info += ",\n" + queueJson(*scene.queue, options.warmupFrames);
+	if (scene.bvh)
+		info += ",\n" + cullJson(*scene.bvh, options.warmupFrames);
+	if (scene.occlusion)
+		info += ",\n" + occlusionJson(*scene.occlusion, options.warmupFrames);
+	if (scene.lod)
+		info += ",\n" + lodJson(*scene.lod, options.warmupFrames);
+	if (scene.uploads)
+		info += ",\n" + uploadJson(*scene.uploads, options.warmupFrames);
+	if (scene.textures)
+		info += ",\n" + textureJson(*scene.textures);
+	if (scene.dynamicMesh)
+		info += ",\n" + streamingJson(scene.dynamicMesh->Stream(), options.warmupFrames);
+	if (scene.capture)
+		info += ",\n" + captureJson(*scene.capture, options.warmupFrames);
+	if (scene.pacer)
+		info += ",\n" + pacingJson(*scene.pacer, options.warmupFrames);
+	if (scene.events)
+		info += ",\n" + eventJson(*scene.events, options);
+	if (scene.simulation)
+		info += ",\n" + simulationJson(*scene.simulation, options.warmupFrames);
+
+	std::ofstream file;
+	std::ostream* out = openBenchmarkOutput(options, file);
+	if (out)
+		timer.WriteJson(*out, info);
+}
+
+// Runs the benchmark once per instance count (1, 10, 100, ... up to maxInstances) and reports
+// how triangle throughput scales
+static void RunInstanceSweep(GLFWwindow* window, const RenderScene& baseScene,
+	const RenderOptions& options, const OffscreenTarget* offscreen) {
+
+	RenderOptions sweepOptions = options;
+	sweepOptions.outputDir.clear();
+	if (sweepOptions.benchmarkFrames <= 0)
+		sweepOptions.benchmarkFrames = 10;
+	sweepOptions.frameCount = sweepOptions.warmupFrames + sweepOptions.benchmarkFrames;
+
+	std::ofstream file;
+	std::ostream* out = openBenchmarkOutput(options, file);
+	if (!out)
+		return;
+
+	*out << "{\n" << getOpenGLVerInfoJson() << ",\n  \"sweep\": [";
+	for (size_t count = 1; count <= static_cast<size_t>(options.instanceSweepMax); count *= 10) {
+		InstanceBuffer instances = CreateInstanceBuffer(*baseScene.mesh, MakeInstanceGrid(count));
+		if (baseScene.dynamicMesh)
+			baseScene.dynamicMesh->AttachInstances(instances.buffer);
+
+		RenderScene scene = baseScene;
+		scene.instanceCount = instances.count;
+		scene.capture = NULL;
+
+		FrameTimer timer(sweepOptions.warmupFrames);
+		RunRenderLoop(window, scene, sweepOptions, offscreen, &timer);
+		timer.Finish();
+		DestroyInstanceBuffer(instances);
+
+		*out << (count == 1 ? "\n" : ",\n") << "{\n" << throughputJson(timer, scene)
+			<< ",\n  \"gpu_frame_ms\": ";
+		WriteStatsJson(*out, SummarizeSamples(timer.GpuFrameMs()));
+		*out << ",\n  \"cpu_frame_ms\": ";
+		WriteStatsJson(*out, SummarizeSamples(timer.CpuFrameMs()));
+		*out << "\n}";
+		out->flush();
+	}
+	*out << "\n]\n}\n";
+}
+
+// CPU-only: culls objectCount random spheres against a turning perspective camera with every
+// test path, checks they agree and reports their times. Needs no GL context.
+static int RunCullBenchmark(const RenderOptions& options) {
+	const size_t objectCount = static_cast<size_t>(options.cullBenchObjects);
+	const int frames = options.benchmarkFrames > 0 ? options.benchmarkFrames : 30;
+
+	BoundsSoA bounds;
+	bounds.Resize(objectCount);
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+	for (size_t i = 0; i < objectCount; ++i)
+		bounds.Set(i, position(rng), position(rng), position(rng), radius(rng));
+
+	BoundingVolumeHierarchy bvh;
+	const auto buildStart = std::chrono::steady_clock::now();
+	bvh.Build(bounds);
+	const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+	std::vector<CullSimd> paths = { CullSimd::Scalar };
+	if (BestCullSimd() != CullSimd::Scalar)
+		paths.push_back(CullSimd::SSE);
+	if (BestCullSimd() == CullSimd::AVX2)
+		paths.push_back(CullSimd::AVX2);
+
+	std::vector<std::vector<double>> flatMs(paths.size());
+	std::vector<double> bvhMs, visibleCounts;
+	std::vector<uint32_t> visible(objectCount);
+	std::vector<uint32_t> bvhVisible;
+	size_t mismatches = 0;
+
+	const Mat4 projection = Mat4::Perspective(1.0472f, 1.0f, 0.1f, 1000.0f);
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	for (int frame = 0; frame < frames; ++frame) {
+		const float angle = frame * 6.2831853f / frames;
+		const float eye[3] = { 0.0f, 0.0f, 0.0f };
+		const float target[3] = { std::cos(angle), 0.2f, std::sin(angle) };
+		const Frustum frustum = Frustum::FromMatrix(projection * Mat4::LookAt(eye, target, up));
+
+		size_t reference = 0;
+		for (size_t p = 0; p < paths.size(); ++p) {
+			const auto start = std::chrono::steady_clock::now();
+			const size_t count = CullSpheres(paths[p], frustum, bounds, 0, objectCount, NULL, visible.data());
+			flatMs[p].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			if (p == 0)
+				reference = count;
+			else if (count != reference)
+				++mismatches;
+		}
+
+		bvh.Cull(frustum, bvhVisible);
+		bvhMs.push_back(bvh.LastFrameStats().milliseconds);
+		visibleCounts.push_back(static_cast<double>(bvhVisible.size()));
+		if (bvhVisible.size() != reference)
+			++mismatches;
+	}
+
+	if (mismatches > 0)
+		std::cout << "ERROR::CULLING::MISMATCH " << mismatches << " results disagree with the scalar path\n";
 
-	GLFWwindow* window = Initialize();
+	std::ofstream file;
+	std::ostream* out = openBenchmarkOutput(options, file);
+	if (!out)
+		return 1;
 
-	unsigned int shaderProgram = CreateLinkShader();
+	*out << "{\n  \"objects\": " << objectCount << ",\n  \"frames\": " << frames
+		<< ",\n  \"bvh_nodes\": " << bvh.NodeCount() << ",\n  \"bvh_build_ms\": " << buildMs
+		<< ",\n  \"mismatches\": " << mismatches << ",\n  \"visible\": ";
+	WriteStatsJson(*out, SummarizeSamples(visibleCounts));
+	for (size_t p = 0; p < paths.size(); ++p) {
+		*out << ",\n  \"flat_" << CullSimdName(paths[p]) << "_ms\": ";
+		WriteStatsJson(*out, SummarizeSamples(flatMs[p]));
+	}
+	*out << ",\n  \"bvh_" << CullSimdName(bvh.Simd()) << "_ms\": ";
+	WriteStatsJson(*out, SummarizeSamples(bvhMs));
+	*out << "\n}\n";
+	return mismatches > 0 ? 1 : 0;
+}
+
+// CPU-only: imports an OBJ/PLY file, optimizes it like BuildMesh() does and writes it as a binary
+// mesh file in the selected vertex format. Needs no GL context.
+static int RunMeshConversion(const RenderOptions& options) {
+	const auto start = std::chrono::steady_clock::now();
+	Mesh mesh;
+	if (!LoadMeshSource(options.convertSource, mesh))
+		return 1;
+	const auto loaded = std::chrono::steady_clock::now();
+
+	if (options.optimizeMesh) {
+		OptimizeVertexCache(mesh.indices, mesh.VertexCount());
+		OptimizeVertexFetch(mesh);
+	}
+	const VertexLayout layout = options.packedVertices ? VertexLayout::Packed() : VertexLayout::Float();
+	if (!WriteMeshFile(options.convertTarget, mesh, layout))
+		return 1;
+	const auto end = std::chrono::steady_clock::now();
+
+	std::cout << "Converted " << options.convertSource << " -> " << options.convertTarget << ": "
+		<< mesh.VertexCount() << " vertices, " << mesh.TriangleCount() << " triangles, "
+		<< layout.Stride() << " bytes per vertex; import "
+		<< std::chrono::duration<double, std::milli>(loaded - start).count() << " ms, total "
+		<< std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+	return 0;
+}
+
+// A grid of colored quads with every quad writing its own four corners, so welding has three
+// duplicates of each interior vertex to find, and faces using relative indices
+static bool writeSyntheticObj(const std::string& path, size_t targetBytes) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "ERROR::IMPORT_BENCH::CANNOT_WRITE " << path << "\n";
+		return false;
+	}
+
+	const size_t bytesPerQuad = 4 * 58 + 16;
+	const size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(targetBytes / bytesPerQuad))));
+	std::string buffer;
+	char line[128];
+	for (size_t y = 0; y < side; ++y) {
+		for (size_t x = 0; x < side; ++x) {
+			for (int corner = 0; corner < 4; ++corner) {
+				const size_t cx = x + (corner == 1 || corner == 2), cy = y + (corner >= 2);
+				const float u = static_cast<float>(cx) / side, v = static_cast<float>(cy) / side;
+				const int length = std::snprintf(line, sizeof(line), "v %.6f %.6f 0.000000 %.6f %.6f 0.500000\n",
+					-0.9f + 1.8f * u, -0.9f + 1.8f * v, u, v);
+				buffer.append(line, length);
+			}
+			buffer += "f -4 -3 -2 -1\n";
+		}
+		if (buffer.size() > (1u << 20)) {
+			out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+		}
+	}
+	out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	return static_cast<bool>(out);
+}
+
+// Imports synthetic OBJ files of 10, 100, 1000, ... MB up to importBenchMaxMB through the streaming
+// importer and, up to 1 GB, through the serial LoadObj() for comparison
+static int RunImportBenchmark(const RenderOptions& options, ThreadPool& pool) {
+	const VertexLayout layout = options.packedVertices ? VertexLayout::Packed() : VertexLayout::Float();
+	std::vector<size_t> sizes;
+	for (size_t mb = 10; mb < static_cast<size_t>(options.importBenchMaxMB); mb *= 10)
+		sizes.push_back(mb);
+	sizes.push_back(static_cast<size_t>(options.importBenchMaxMB));
+
+	std::ofstream file;
+	std::ostream* out = openBenchmarkOutput(options, file);
+	if (!out)
+		return 1;
+
+	*out << "{\n  \"threads\": " << pool.ThreadCount() + 1 << ",\n  \"window_mb\": " << options.importWindowMB
+		<< ",\n  \"import_sweep\": [";
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		const std::string path = (std::filesystem::temp_directory_path() / ("import_bench_" + std::to_string(sizes[i]) + ".obj")).string();
+		if (!writeSyntheticObj(path, sizes[i] << 20))
+			return 1;
 
-	std::vector<unsigned int> VBOs(2);
-	unsigned int VAO = GenerateBindArrayBuffer(&VBOs[0], &VBOs[1]); // Pass VBO by pointer
+		MeshStreamImporter importer(pool, layout, static_cast<size_t>(options.importWindowMB) << 20);
+		importer.SetWelding(options.weld);
+		GpuMesh gpuMesh;
+		const bool imported = importer.Import(path, gpuMesh);
+		const ImportStats& stats = importer.Stats();
+		DestroyGpuMesh(gpuMesh);
+
+		double serialMBps = 0.0;
+		if (imported && sizes[i] <= 1024) {
+			const auto start = std::chrono::steady_clock::now();
+			Mesh mesh;
+			if (LoadObj(path, mesh)) {
+				GpuMesh serialMesh = UploadMesh(mesh, layout);
+				glFinish();
+				const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				serialMBps = stats.fileBytes / (1024.0 * 1024.0) * 1000.0 / ms;
+				DestroyGpuMesh(serialMesh);
+			}
+		}
+		std::filesystem::remove(path);
+		if (!imported)
+			return 1;
+
+		*out << (i == 0 ? "\n" : ",\n") << "{ \"file_mb\": " << stats.fileBytes / (1024.0 * 1024.0)
+			<< ", \"mb_per_s\": " << stats.MegabytesPerSecond() << ", \"serial_mb_per_s\": " << serialMBps
+			<< ", \"total_ms\": " << stats.totalMilliseconds << ", \"parse_ms\": " << stats.parseMilliseconds
+			<< ", \"weld_ms\": " << stats.mergeMilliseconds << ", \"upload_ms\": " << stats.uploadMilliseconds
+			<< ", \"source_vertices\": " << stats.sourceVertices << ", \"welded_vertices\": " << stats.weldedVertices
+			<< ", \"triangles\": " << stats.triangles << ", \"peak_window_mb\": " << stats.peakWindowBytes / (1024.0 * 1024.0) << " }";
+		out->flush();
+	}
+	*out << "\n]\n}\n";
+	return 0;
+}
 
-	RenderLoop(window, shaderProgram, VAO);
+// ===| Software Rasterizer |===================================================================
+
+static void writeRasterStatsJson(std::ostream& out, const SoftwareRasterizer& raster,
+	const std::vector<double>& frameMs, size_t warmupFrames) {
+	std::vector<double> setupMs, rasterMs;
+	double triangles = 0.0, pixels = 0.0, clipped = 0.0, binned = 0.0;
+	const std::vector<RasterFrameStats>& history = raster.History();
+	for (size_t i = warmupFrames; i < history.size(); ++i) {
+		setupMs.push_back(history[i].setupMilliseconds);
+		rasterMs.push_back(history[i].rasterMilliseconds);
+		triangles += static_cast<double>(history[i].triangles);
+		pixels += static_cast<double>(history[i].pixels);
+		clipped += static_cast<double>(history[i].clipped);
+		binned += static_cast<double>(history[i].binned);
+	}
+	const std::vector<double> timed(frameMs.begin() + std::min(warmupFrames, frameMs.size()), frameMs.end());
+	const double seconds = std::accumulate(timed.begin(), timed.end(), 0.0) / 1000.0;
+	const double frames = static_cast<double>(std::max<size_t>(timed.size(), 1));
+
+	out << "  \"triangles_per_frame\": " << static_cast<uint64_t>(triangles / frames)
+		<< ",\n  \"pixels_per_frame\": " << static_cast<uint64_t>(pixels / frames)
+		<< ",\n  \"clipped_per_frame\": " << clipped / frames
+		<< ",\n  \"bins_per_frame\": " << binned / frames
+		<< ",\n  \"triangles_per_second\": " << (seconds > 0.0 ? triangles / seconds : 0.0)
+		<< ",\n  \"pixels_per_second\": " << (seconds > 0.0 ? pixels / seconds : 0.0)
+		<< ",\n  \"frame_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(timed));
+	out << ",\n  \"setup_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(setupMs));
+	out << ",\n  \"raster_ms\": ";
+	WriteStatsJson(out, SummarizeSamples(rasterMs));
+}
+
+// Renders the mesh path on the CPU only: no GL context is created, so this runs without a GPU
+// or display, and every run (and thread count) produces the same image. The last frame is left
+// in finalFrame when it is given.
+static int RunSoftwareRender(const RenderOptions& options, std::vector<unsigned char>* finalFrame = NULL) {
+	const VertexLayout layout = options.packedVertices ? VertexLayout::Packed() : VertexLayout::Float();
+	const RasterMesh mesh = MakeRasterMesh(BuildMesh(options), layout);
+	const std::vector<InstanceData> instances = MakeInstanceGrid(static_cast<size_t>(options.instanceCount));
+
+	ThreadPool pool;
+	SoftwareRasterizer raster(pool, options.width, options.height);
+	raster.SetSimd(options.rasterSimd);
+	if (!options.outputDir.empty())
+		std::filesystem::create_directories(options.outputDir);
+
+	std::vector<double> frameMs;
+	for (int frame = 0; frame < options.frameCount; ++frame) {
+		const auto start = std::chrono::steady_clock::now();
+		raster.Clear(0.0f, 0.0f, 0.0f, 1.0f);
+		raster.Draw(mesh, instances);
+		raster.Finish();
+		frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		if (!options.outputDir.empty()) {
+			char name[32];
+			std::snprintf(name, sizeof(name), "frame_%05d.ppm", frame);
+			const std::vector<unsigned char> pixels = raster.ReadPixels();
+			WritePPM((std::filesystem::path(options.outputDir) / name).string(), raster.Width(), raster.Height(), pixels.data());
+		}
+	}
+
+	if (options.benchmarkFrames > 0) {
+		std::ofstream file;
+		std::ostream* out = openBenchmarkOutput(options, file);
+		if (!out)
+			return 1;
+		*out << "{\n  \"backend\": \"software\",\n  \"simd\": \"" << CullSimdName(raster.Simd())
+			<< "\",\n  \"threads\": " << pool.ThreadCount() + 1
+			<< ",\n  \"width\": " << raster.Width() << ",\n  \"height\": " << raster.Height()
+			<< ",\n  \"instances\": " << std::max(options.instanceCount, 1) << ",\n";
+		writeRasterStatsJson(*out, raster, frameMs, static_cast<size_t>(options.warmupFrames));
+		*out << "\n}\n";
+	}
+	if (finalFrame)
+		*finalFrame = raster.ReadPixels();
+	return 0;
+}
+
+struct RasterBenchScene {
+	const char* name;
+	Mesh mesh;
+	size_t instances;   // 0 = plain draw
+};
+
+// Draws a few scenes, from fill-bound to setup-bound, with the software rasterizer and with GL,
+// reporting both throughputs and how far the images differ
+static int RunRasterBenchmark(const RenderOptions& options, unsigned int shaderProgram,
+	ThreadPool& pool, const OffscreenTarget& offscreen) {
+
+	const VertexLayout layout = options.packedVertices ? VertexLayout::Packed() : VertexLayout::Float();
+	const size_t warmupFrames = static_cast<size_t>(options.warmupFrames);
+	const size_t frames = warmupFrames + static_cast<size_t>(options.benchmarkFrames > 0 ? options.benchmarkFrames : 20);
+
+	std::vector<RasterBenchScene> scenes;
+	scenes.push_back({ "fill_grid_4", MakeGridMesh(4), 0 });
+	scenes.push_back({ "grid_256", MakeGridMesh(256), 0 });
+	scenes.push_back({ "grid_16_x256", MakeGridMesh(16), 256 });
+	scenes.push_back({ "triangle_x10000", MakeTriangleMesh(), 10000 });
+	scenes.push_back({ "flower_64_256", MakeFlowerMesh(64, 256), 0 });
+
+	SoftwareRasterizer raster(pool, offscreen.width, offscreen.height);
+	raster.SetSimd(options.rasterSimd);
+	TextureManager textures(pool, false);
+	SetDefaultInstanceAttributes();
+	unsigned int query = 0;
+	glGenQueries(1, &query);
+
+	std::ofstream file;
+	std::ostream* out = openBenchmarkOutput(options, file);
+	if (!out)
+		return 1;
+	*out << "{\n" << getOpenGLVerInfoJson() << ",\n  \"simd\": \"" << CullSimdName(raster.Simd())
+		<< "\",\n  \"threads\": " << pool.ThreadCount() + 1 << ",\n  \"width\": " << offscreen.width
+		<< ",\n  \"height\": " << offscreen.height << ",\n  \"scenes\": [";
+
+	for (size_t s = 0; s < scenes.size(); ++s) {
+		RasterBenchScene& scene = scenes[s];
+		OptimizeVertexCache(scene.mesh.indices, scene.mesh.VertexCount());
+		OptimizeVertexFetch(scene.mesh);
+		const RasterMesh rasterMesh = MakeRasterMesh(scene.mesh, layout);
+		const std::vector<InstanceData> instanceData = MakeInstanceGrid(scene.instances);
+		const double triangles = static_cast<double>(scene.mesh.TriangleCount()) * std::max<size_t>(scene.instances, 1);
+
+		std::vector<double> softwareMs;
+		raster.ClearHistory();
+		for (size_t frame = 0; frame < frames; ++frame) {
+			const auto start = std::chrono::steady_clock::now();
+			raster.Clear(0.0f, 0.0f, 0.0f, 1.0f);
+			raster.Draw(rasterMesh, instanceData);
+			raster.Finish();
+			softwareMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		GpuMesh gpuMesh = UploadMesh(scene.mesh, layout);
+		InstanceBuffer instances;
+		if (scene.instances > 0)
+			instances = CreateInstanceBuffer(gpuMesh, instanceData);
+		glState.UseProgram(shaderProgram);
+		glState.BindTexture(0, GL_TEXTURE_2D, textures.White());
+		glState.BindVertexArray(gpuMesh.VAO);
+
+		// Every frame is finished before the next starts, so the time covers the rasterization
+		std::vector<double> glMs;
+		GLuint64 glPixels = 0;
+		for (size_t frame = 0; frame <= frames; ++frame) {
+			const bool counted = frame == frames;   // one extra frame under an occlusion query
+			const auto start = std::chrono::steady_clock::now();
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			if (counted)
+				glBeginQuery(GL_SAMPLES_PASSED, query);
+			if (scene.instances > 0)
+				DrawMeshInstanced(gpuMesh, instances.count);
+			else
+				DrawMesh(gpuMesh);
+			if (counted) {
+				glEndQuery(GL_SAMPLES_PASSED);
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &glPixels);
+			}
+			glFinish();
+			if (!counted)
+				glMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		const std::vector<unsigned char> expected = ReadOffscreenPixels(offscreen);
+		const std::vector<unsigned char> actual = raster.ReadPixels();
+		size_t differing = 0;
+		int maxDifference = 0;
+		for (size_t i = 0; i + 2 < expected.size(); i += 3) {
+			int difference = 0;
+			for (int c = 0; c < 3; ++c)
+				difference = std::max(difference, std::abs(expected[i + c] - actual[i + c]));
+			differing += difference > 0;
+			maxDifference = std::max(maxDifference, difference);
+		}
+
+		glState.BindVertexArray(0);
+		DestroyInstanceBuffer(instances);
+		DestroyGpuMesh(gpuMesh);
+
+		const SampleStats software = SummarizeSamples(std::vector<double>(softwareMs.begin() + warmupFrames, softwareMs.end()));
+		const SampleStats gl = SummarizeSamples(std::vector<double>(glMs.begin() + warmupFrames, glMs.end()));
+		const double softwarePixels = static_cast<double>(raster.LastFrameStats().pixels);
+		const auto perSecond = [](double count, double ms) { return ms > 0.0 ? count / (ms * 1000.0) : 0.0; };
+
+		*out << (s == 0 ? "\n" : ",\n") << "{ \"scene\": \"" << scene.name << "\", \"triangles\": " << static_cast<uint64_t>(triangles)
+			<< ", \"software_ms\": " << software.median << ", \"gl_ms\": " << gl.median
+			<< ", \"software_mtri_s\": " << perSecond(triangles, software.median)
+			<< ", \"gl_mtri_s\": " << perSecond(triangles, gl.median)
+			<< ", \"software_mpix_s\": " << perSecond(softwarePixels, software.median)
+			<< ", \"gl_mpix_s\": " << perSecond(static_cast<double>(glPixels), gl.median)
+			<< ", \"software_pixels\": " << static_cast<uint64_t>(softwarePixels) << ", \"gl_pixels\": " << glPixels
+			<< ", \"differing_pixels\": " << differing << ", \"max_channel_difference\": " << maxDifference << " }";
+		out->flush();
+	}
+	*out << "\n]\n}\n";
+
+	glDeleteQueries(1, &query);
+	return 0;
+}
+
+// ===| Render |================================================================================
+
+// One run of the renderer, from context creation to teardown. Headless runs leave their last
+// frame in finalFrame when it is given.
+static int RunRenderer(const RenderOptions& options, std::vector<unsigned char>* finalFrame) {
+	GLFWwindow* window = Initialize(options);
+	if (window == NULL)
+		return 1;
+
+	OffscreenTarget offscreen;
+	if (options.headless) {
+		if (!CreateOffscreenTarget(offscreen, options.width, options.height)) {
+			glfwTerminate();
+			return 1;
+		}
+	}
+
+	// Before anything else is created, so a capture that cannot open its output ends the run early
+	std::unique_ptr<FrameCapture> capture;
+	if (!options.captureTarget.empty() || (options.headless && !options.outputDir.empty())) {
+		int captureWidth = options.width, captureHeight = options.height;
+		if (!options.headless)
+			glfwGetFramebufferSize(window, &captureWidth, &captureHeight);
+		const bool frames = options.captureTarget.empty();
+		capture.reset(new FrameCapture(captureWidth, captureHeight, frames ? CaptureFormat::Frames : options.captureFormat,
+			frames ? options.outputDir : options.captureTarget, options.captureRing, options.captureFps));
+		if (!capture->Ok()) {
+			capture.reset();
+			if (options.headless)
+				DestroyOffscreenTarget(offscreen);
+			glfwTerminate();
+			return 1;
+		}
+	}
+
+	ThreadPool threadPool;
+	if (options.importBenchMaxMB > 0) {
+		const int result = RunImportBenchmark(options, threadPool);
+		capture.reset();
+		glfwTerminate();
+		return result;
+	}
+
+	ProgramCache programCache(options.shaderCacheDir);
+	std::unique_ptr<ShaderManager> shaders(new ShaderManager(programCache, threadPool));
+	unsigned int shaderProgram = CreateLinkShader(*shaders, options.stressPrograms,
+		options.objectCount > 0 ? options.objectPrograms : 0);
+	if (shaderProgram == 0) {
+		capture.reset();
+		shaders.reset();
+		DestroyOffscreenTarget(offscreen);
+		glfwTerminate();
+		return 1;
+	}
+	if (options.rasterBench) {
+		const int result = RunRasterBenchmark(options, shaderProgram, threadPool, offscreen);
+		capture.reset();
+		shaders.reset();
+		DestroyOffscreenTarget(offscreen);
+		glfwTerminate();
+		return result;
+	}
+
+	// Texcoords only when something samples a real texture; everything else reads the white one
+	const bool textured = options.textureCount > 0 || !options.textureFile.empty();
+	VertexLayout layout = options.packedVertices ? VertexLayout::Packed() : VertexLayout::Float();
+	if (textured)
+		layout.Add(ATTRIB_TEXCOORD, options.packedVertices ? AttribFormat::Half2 : AttribFormat::Float2);
+	const bool meshFromFile = !options.meshFile.empty() || !options.importFile.empty();
+	const Mesh cpuMesh = meshFromFile ? Mesh() : BuildMesh(options);
+	const bool lod = options.lod && options.objectCount > 0;
+	const LodChain meshLods = lod && !meshFromFile ? BuildLodChain(cpuMesh) : LodChain();
+	GpuMesh mesh;
+	bool meshLoaded = true;
+	std::unique_ptr<UploadQueue> uploads;
+	UploadId meshUploads[2] = {};
+	if (options.asyncUpload || textured)
+		uploads.reset(new UploadQueue(static_cast<size_t>(options.uploadBudgetKB) << 10));
+	if (options.asyncUpload) {
+		mesh = UploadMeshAsync(*uploads, cpuMesh, layout, meshUploads);
+	}
+	else if (!options.meshFile.empty()) {
+		meshLoaded = LoadMeshFile(options.meshFile, mesh);
+	}
+	else if (!options.importFile.empty()) {
+		MeshStreamImporter importer(threadPool, layout, static_cast<size_t>(options.importWindowMB) << 20);
+		importer.SetWelding(options.weld);
+		meshLoaded = importer.Import(options.importFile, mesh);
+		if (meshLoaded)
+			printImportStats(options.importFile, importer.Stats());
+	}
+	else {
+		mesh = GenerateBindArrayBuffer(cpuMesh, layout, meshLods.levels.empty() ? NULL : &meshLods);
+	}
+	if (!meshLoaded) {
+		uploads.reset();
+		capture.reset();
+		if (options.headless)
+			DestroyOffscreenTarget(offscreen);
+		DestroyGpuMesh(mesh);
+		shaders.reset();
+		glfwTerminate();
+		return 1;
+	}
+
+	std::unique_ptr<DynamicMesh> dynamicMesh;
+	if (options.dynamic)
+		dynamicMesh.reset(new DynamicMesh(cpuMesh, mesh, layout, options.streamPolicy));
+
+	SetDefaultInstanceAttributes();
+
+	// Started before the object scene is built: the names exist at once, the images follow
+	std::unique_ptr<TextureManager> textures(new TextureManager(threadPool, options.compressTextures));
+	std::vector<unsigned int> textureList;
+	if (!options.textureFile.empty())
+		textureList.push_back(textures->Load(options.textureFile));
+	for (int i = 0; i < options.textureCount; ++i)
+		textureList.push_back(textures->Generate(options.textureSize, static_cast<uint32_t>(i)));
+
+	// Sets the swap interval, so it has to exist before the first frame
+	std::unique_ptr<FramePacer> pacer;
+	if (options.pacing != PacingMode::Driver || options.framesInFlight > 0)
+		pacer.reset(new FramePacer(options.headless ? NULL : window, options.pacing, options.targetFps, options.framesInFlight));
+	// Runs from here on: frames only ever pick up what it has already published
+	std::unique_ptr<Simulation> simulation;
+	if (options.simThread)
+		simulation.reset(new Simulation(dynamicMesh.get(), options.simRate));
+	// Takes over the key and framebuffer size callbacks
+	std::unique_ptr<WindowEvents> events;
+	if (options.renderThread || options.eventStallMs > 0)
+		events.reset(new WindowEvents(window, options.eventStallMs));
+
+	RenderScene scene;
+	scene.shaderProgram = shaderProgram;
+	scene.mesh = &mesh;
+	scene.dynamicMesh = dynamicMesh.get();
+	scene.uploads = uploads.get();
+	std::copy(meshUploads, meshUploads + 2, scene.meshUploads);
+	scene.capture = capture.get();
+	scene.pacer = pacer.get();
+	scene.events = events.get();
+	scene.simulation = simulation.get();
+	scene.textures = textured ? textures.get() : NULL;
+	scene.texture = textured ? textureList.front() : textures->White();
+
+	// Object scene: the main mesh plus a few others, so objects differ in VAO as well as program
+	std::vector<GpuMesh> objectMeshes;
+	std::vector<SceneObject> objects;
+	RenderQueue queue;
+	std::vector<CommandBuffer> commandBuffers(options.recordBuffers);
+	BoundingVolumeHierarchy bvh;
+	std::vector<uint32_t> visibleObjects;
+	GpuMesh occlusionProxy;
+	std::unique_ptr<OcclusionCuller> occlusion;
+	std::unique_ptr<LodSelector> lodSelector;
+	if (options.objectCount > 0) {
+		const std::vector<Mesh> cpuObjectMeshes = { MakeTriangleMesh(), MakeGridMesh(4), MakeGridMesh(16), MakeFlowerMesh(12, 48) };
+		std::vector<LodChain> objectLods;
+		for (const Mesh& objectMesh : cpuObjectMeshes) {
+			objectLods.push_back(lod ? BuildLodChain(objectMesh) : LodChain());
+			objectMeshes.push_back(GenerateBindArrayBuffer(objectMesh, layout, lod ? &objectLods.back() : NULL));
+		}
+
+		std::vector<const GpuMesh*> meshes = { &mesh };
+		for (const GpuMesh& objectMesh : objectMeshes)
+			meshes.push_back(&objectMesh);
+		std::vector<unsigned int> programs;
+		for (int i = 0; i < options.objectPrograms; ++i)
+			programs.push_back(shaders->Program("object" + std::to_string(i)));
+
+		objects = MakeObjectScene(options.objectCount, meshes, programs,
+			textured ? textureList : std::vector<unsigned int>{ textures->White() }, options.objectLayers);
+		queue.SetSorting(options.sortQueue);
+		scene.cameraZoom = options.cameraZoom;
+		scene.objects = &objects;
+		scene.queue = &queue;
+		if (options.recordBuffers > 0) {
+			scene.recordPool = &threadPool;
+			scene.commandBuffers = &commandBuffers;
+		}
+		if (options.cull) {
+			bvh.Build(MakeObjectBounds(objects));
+			bvh.SetSimd(options.cullSimd);
+			scene.bvh = &bvh;
+		}
+		if (options.occlusion) {
+			// The bounding quad of every object mesh, which all lie in [-0.9, 0.9]^2 at z = 0
+			occlusionProxy = UploadMesh(MakeGridMesh(1), layout);
+			occlusion.reset(new OcclusionCuller(objects.size(), occlusionProxy, shaderProgram));
+			scene.occlusion = occlusion.get();
+		}
+		if (lod) {
+			lodSelector.reset(new LodSelector(objects.size(), options.lodPixelError));
+			lodSelector->SetViewportHeight(options.height);
+			lodSelector->Register(&mesh, meshLods);
+			for (size_t i = 0; i < objectMeshes.size(); ++i)
+				lodSelector->Register(&objectMeshes[i], objectLods[i]);
+			scene.lod = lodSelector.get();
+		}
+		scene.visible = &visibleObjects;
+	}
+
+	// A capture that failed to write its frames fails the run, so scripts and CI notice
+	bool captureFailed = false;
+	if (options.instanceSweepMax > 0) {
+		RunInstanceSweep(window, scene, options, options.headless ? &offscreen : NULL);
+	}
+	else {
+		InstanceBuffer instances;
+		if (options.instanceCount > 0) {
+			instances = CreateInstanceBuffer(mesh, MakeInstanceGrid(options.instanceCount));
+			if (dynamicMesh)
+				dynamicMesh->AttachInstances(instances.buffer);
+		}
+		scene.instanceCount = instances.count;
+
+		std::unique_ptr<FrameTimer> timer;
+		if (options.benchmarkFrames > 0)
+			timer.reset(new FrameTimer(options.warmupFrames));
+
+		RunRenderLoop(window, scene, options, options.headless ? &offscreen : NULL, timer.get());
+		if (finalFrame && options.headless)
+			*finalFrame = ReadOffscreenPixels(offscreen);
+		if (capture) {
+			capture->Finish();
+			printCaptureStats(*capture);
+			captureFailed = capture->Stats().failed;
+		}
+		if (pacer)
+			printPacingStats(*pacer, options.benchmarkFrames > 0 ? options.warmupFrames : 0);
+		if (events)
+			printEventStats(*events, options);
+		if (simulation) {
+			simulation->Stop();
+			printSimulationStats(*simulation, options.benchmarkFrames > 0 ? options.warmupFrames : 0);
+		}
+
+		if (timer) {
+			WriteBenchmarkReport(*timer, options, scene);
+			timer.reset();
+		}
+		if (scene.textures)
+			printTextureStats(*scene.textures);
+		DestroyInstanceBuffer(instances);
+	}
+	simulation.reset();
+	dynamicMesh.reset();
+	textures.reset();
+	uploads.reset();
+	capture.reset();
+	pacer.reset();
+	events.reset();
 
 	//Cleanup
+	if (options.headless)
+		DestroyOffscreenTarget(offscreen);
 
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBOs[0]);
-	glDeleteBuffers(1, &VBOs[1]);
-	glDeleteProgram(shaderProgram);
+	occlusion.reset();
+	DestroyGpuMesh(occlusionProxy);
+	for (GpuMesh& objectMesh : objectMeshes)
+		DestroyGpuMesh(objectMesh);
+	DestroyGpuMesh(mesh);
+	shaders.reset();
 	glfwTerminate();
 
-	return 0;
+	return captureFailed ? 1 : 0;
+}
+
+// ===| Golden Images |=========================================================================
+
+// Named scenes for --golden: command line options rendered at a fixed size. None of them pans
+// the camera or animates, so every run renders the same frame.
+struct GoldenScene {
+	const char* name;
+	std::vector<std::string> args;
+};
+
+static std::vector<GoldenScene> goldenScenes() {
+	return {
+		{ "triangle", { "--size", "256x256" } },
+		{ "triangle_float", { "--size", "256x256", "--vertex-format", "float" } },
+		{ "grid", { "--mesh", "grid", "--grid-size", "16", "--size", "320x240" } },
+		{ "flower", { "--mesh", "flower", "--size", "750x750" } },
+		{ "instances", { "--mesh", "grid", "--grid-size", "4", "--instances", "100", "--size", "512x512" } },
+		{ "objects", { "--objects", "500", "--size", "512x512" } },
+		{ "objects_unsorted_recorded", { "--objects", "500", "--no-sort", "--record", "4", "--size", "512x512" } },
+		{ "objects_culled", { "--objects", "500", "--object-layers", "3", "--cull", "--occlusion", "--lod", "--frames", "4", "--size", "512x512" } },
+		{ "textured", { "--mesh", "grid", "--grid-size", "8", "--textures", "2", "--texture-size", "64", "--frames", "60", "--size", "256x256" } },
+		{ "async_upload", { "--mesh", "flower", "--async-upload", "--upload-budget", "64", "--frames", "60", "--size", "256x256" } },
+		{ "software_flower", { "--software", "--mesh", "flower", "--size", "400x400" } },
+		{ "software_instances", { "--software", "--mesh", "grid", "--grid-size", "4", "--instances", "100", "--size", "333x257" } },
+	};
+}
+
+// True when every pixel of an rgb frame is the same color, as when nothing but the clear was drawn
+static bool isUniformFrame(const std::vector<unsigned char>& rgb) {
+	for (size_t i = 3; i + 2 < rgb.size(); i += 3) {
+		if (rgb[i] != rgb[0] || rgb[i + 1] != rgb[1] || rgb[i + 2] != rgb[2])
+			return false;
+	}
+	return true;
+}
+
+// Renders every golden scene (or just --golden-scene) and compares it with its reference image.
+// A failing scene leaves its frame and a diff heatmap next to the references, or in --output.
+static int RunGoldenSuite(const RenderOptions& options) {
+	const std::filesystem::path referenceDir(options.goldenDir);
+	const std::filesystem::path failureDir(options.outputDir.empty() ? options.goldenDir : options.outputDir);
+	if (options.goldenUpdate)
+		std::filesystem::create_directories(referenceDir);
+
+	size_t passed = 0, failed = 0;
+	for (const GoldenScene& golden : goldenScenes()) {
+		if (!options.goldenScene.empty() && options.goldenScene != golden.name)
+			continue;
+
+		// The scene's own options over the defaults; only the shader cache carries over
+		std::vector<std::string> args = { "golden", "--headless" };
+		args.insert(args.end(), golden.args.begin(), golden.args.end());
+		std::vector<char*> argv;
+		for (std::string& arg : args)
+			argv.push_back(&arg[0]);
+		RenderOptions sceneOptions;
+		std::vector<unsigned char> frame;
+		int result = 1;
+		if (ParseOptions(static_cast<int>(argv.size()), argv.data(), sceneOptions)) {
+			sceneOptions.shaderCacheDir = options.shaderCacheDir;
+			result = sceneOptions.software ? RunSoftwareRender(sceneOptions, &frame) : RunRenderer(sceneOptions, &frame);
+		}
+
+		const std::string reference = (referenceDir / (std::string(golden.name) + ".ppm")).string();
+		if (result != 0 || frame.empty()) {
+			std::cout << "ERROR::GOLDEN::RENDER_FAILED " << golden.name << "\n";
+			++failed;
+			continue;
+		}
+		if (options.goldenUpdate) {
+			// Every scene draws something: a blank frame is a broken render, not a reference
+			if (isUniformFrame(frame)) {
+				std::cout << "ERROR::GOLDEN::BLANK_FRAME " << golden.name << ": not updating its reference\n";
+				++failed;
+				continue;
+			}
+			if (!WritePPM(reference, sceneOptions.width, sceneOptions.height, frame.data())) {
+				++failed;
+				continue;
+			}
+			std::cout << "UPDATED " << golden.name << " -> " << reference << "\n";
+			++passed;
+			continue;
+		}
+
+		int width = 0, height = 0;
+		std::vector<unsigned char> expected;
+		if (!ReadPPM(reference, width, height, expected)) {
+			std::cout << "ERROR::GOLDEN::MISSING_REFERENCE " << golden.name << " (run with --golden-update)\n";
+			++failed;
+			continue;
+		}
+		if (width != sceneOptions.width || height != sceneOptions.height) {
+			std::cout << "ERROR::GOLDEN::SIZE_MISMATCH " << golden.name << ": reference is " << width << "x" << height
+				<< ", scene renders " << sceneOptions.width << "x" << sceneOptions.height << "\n";
+			++failed;
+			continue;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		const ImageDiffResult diff = DiffImages(expected, frame, options.goldenTolerance);
+		const double diffMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const bool match = diff.failedPixels <= static_cast<size_t>(options.goldenMaxPixels);
+		std::cout << (match ? "PASS " : "FAIL ") << golden.name << ": " << diff.failedPixels << " of " << diff.pixels
+			<< " pixels past tolerance " << options.goldenTolerance << ", max difference " << diff.maxDifference
+			<< ", mean " << diff.meanDifference << " (diff " << diffMs << " ms, " << CullSimdName(BestCullSimd()) << ")\n";
+		if (match) {
+			++passed;
+			continue;
+		}
+
+		++failed;
+		std::filesystem::create_directories(failureDir);
+		const std::string actualPath = (failureDir / (std::string(golden.name) + ".actual.ppm")).string();
+		const std::string heatmapPath = (failureDir / (std::string(golden.name) + ".diff.ppm")).string();
+		const std::vector<unsigned char> heatmap = MakeDiffHeatmap(expected, frame, options.goldenTolerance);
+		WritePPM(actualPath, width, height, frame.data());
+		WritePPM(heatmapPath, width, height, heatmap.data());
+		std::cout << "  frame -> " << actualPath << ", heatmap -> " << heatmapPath << "\n";
+	}
+
+	if (passed + failed == 0) {
+		std::cout << "ERROR::GOLDEN::UNKNOWN_SCENE " << options.goldenScene << "\n";
+		return 1;
+	}
+	std::cout << "Golden images: " << passed << (options.goldenUpdate ? " updated, " : " passed, ") << failed << " failed\n";
+	return failed > 0 ? 1 : 0;
+}
+
+// The most frames one run of the renderer records, so its histories never trim and the reports
+// can skip the warmup by index (0 = until the window closes)
+static size_t framesPerRun(const RenderOptions& options) {
+	const size_t warmup = static_cast<size_t>(options.warmupFrames);
+	if (options.instanceSweepMax > 0)
+		return warmup + static_cast<size_t>(options.benchmarkFrames > 0 ? options.benchmarkFrames : 10);
+	if (options.rasterBench)
+		return warmup + static_cast<size_t>(options.benchmarkFrames > 0 ? options.benchmarkFrames : 20);
+	return static_cast<size_t>(std::max(options.frameCount, 0));
+}
+
+// =================================================================================================
+
+int main(int argc, char** argv) {
+
+	RenderOptions options;
+	if (!ParseOptions(argc, argv, options))
+		return 1;
+	ReserveHistoryFrames(framesPerRun(options));
+	if (options.cullBenchObjects > 0)
+		return RunCullBenchmark(options);
+	if (!options.convertSource.empty())
+		return RunMeshConversion(options);
+	if (!options.goldenDir.empty())
+		return RunGoldenSuite(options);
+	if (options.software)
+		return RunSoftwareRender(options);
+	return RunRenderer(options, NULL);
 }
\ No newline at end of file
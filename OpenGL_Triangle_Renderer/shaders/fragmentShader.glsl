@@ -1,10 +1,14 @@
 #version 330 core
 
-in vec3 vColor;
+in vec4 vColor;
+in vec2 vTexCoord;
+
+// Unit 0; untextured draws bind the texture manager's 1x1 white texture
+uniform sampler2D uTexture;
 
 out vec4 FragColor;
 
 void main()
 {
-    FragColor = vec4(vColor, 1.0);
+    FragColor = vColor * texture(uTexture, vTexCoord);
 }
@@ -3,10 +3,20 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aColor;
 
-out vec3 vColor;
+// Per-instance attributes (divisor 1). Without an instance buffer these arrays are disabled
+// and the constant values set by SetDefaultInstanceAttributes() apply: no offset, scale 1, white.
+layout(location = 3) in vec4 iOffsetScale;   // xyz: offset, w: uniform scale
+layout(location = 4) in vec4 iColor;         // multiplies the vertex color, alpha used when blending
+
+// Meshes without texcoords leave this disabled: every pixel samples the texture's corner texel
+layout(location = 5) in vec2 aTexCoord;
+
+out vec4 vColor;
+out vec2 vTexCoord;
 
 void main()
 {
-    gl_Position = vec4(aPos, 1.0);
-    vColor = aColor;
+    gl_Position = vec4(aPos * iOffsetScale.w + iOffsetScale.xyz, 1.0);
+    vColor = vec4(aColor * iColor.rgb, iColor.a);
+    vTexCoord = aTexCoord;
 }